@@ -0,0 +1,46 @@
+#include "cmd_util.h"
+
+
+// Assemble a source file into memory, patching only changed lines when it was assembled last
+// asm FILE
+LC3_CMD_FN(assembleFile) {
+    char msg[64];
+
+    if (argc != 1) {
+        LC3_ShowMessage(tui, "provide a file", true);
+        return 1;
+    }
+
+    if (tui->assembly == NULL) {
+        tui->assembly = LC3_CreateAssembly();
+    }
+
+    int32_t n = LC3_Assemble(tui->assembly, sim, argv[0]);
+
+    if (n < 0) {
+        LC3_ShowMessage(tui, sim->error, true);
+        sim->error = NULL;
+        return 1;
+    }
+
+    // Pristine image for restart --keep-image, like read
+    if (tui->image == NULL) {
+        tui->image = lc_malloc(sizeof(LC3_SimImage));
+        (*tui->image) = LC3_CreateImage();
+    }
+
+    LC3_CaptureImage(tui->image, sim);
+
+    if (!LC3_IsAddrDisplayed(tui, sim->reg.PC)) {
+        tui->memViewStart = sim->reg.PC;
+    }
+
+    if (tui->assembly->patched) {
+        snprintf(msg, sizeof(msg), "%d line%s patched", n, (n == 1) ? "" : "s");
+    } else {
+        snprintf(msg, sizeof(msg), "%d lines assembled", n);
+    }
+
+    LC3_ShowMessage(tui, msg, false);
+    return 0;
+}
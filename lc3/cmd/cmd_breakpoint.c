@@ -6,16 +6,22 @@
 // If no locations are provided, PC is assumed
 // b[reak]p[oint] [location] ...
 LC3_CMD_FN(breakpoint) {
-    if (argc == 0) {
-        sim->memory[sim->reg.PC].breakpoint = !sim->memory[sim->reg.PC].breakpoint;
+    if (argc == 0 && tui->worker) {
+        return !LC3_PostWorker(tui->worker, LC3_WORKER_BREAKPOINT, -1);
+    } else if (argc == 0) {
+        LC3_SetBreakpoint(sim, sim->reg.PC, !sim->memory[sim->reg.PC].breakpoint);
+        LC3_MarkDirty(sim, sim->reg.PC);
         return 0;
     }
 
     for (int i = 0; i < argc; i++) {
-        OptInt n = parseVariable(sim, argv[i]);
+        OptInt n = parseLiveVariable(tui, sim, argv[i]);
 
-        if (n.set && inRange(n.value, 0, UINT16_MAX)) {
-            sim->memory[n.value].breakpoint = !sim->memory[n.value].breakpoint;
+        if (n.set && inRange(n.value, 0, UINT16_MAX) && tui->worker) {
+            LC3_PostWorker(tui->worker, LC3_WORKER_BREAKPOINT, n.value);
+        } else if (n.set && inRange(n.value, 0, UINT16_MAX)) {
+            LC3_SetBreakpoint(sim, n.value, !sim->memory[n.value].breakpoint);
+            LC3_MarkDirty(sim, n.value);
         } else {
             LC3_ShowMessage(tui, "invalid location", true);
         }
@@ -0,0 +1,49 @@
+#include "cmd_util.h"
+#include <stdlib.h>
+
+
+// Write simulator state in the background, optionally repeating every N instructions or N seconds
+// c[heck]p[oint] FILE [N/Ns] | off
+LC3_CMD_FN(checkpointSimulator) {
+    if (argc < 1 || argc > 2) {
+        LC3_ShowMessage(tui, "invalid argc", true);
+        return 1;
+    }
+
+    if (tui->checkpoint == NULL) {
+        tui->checkpoint = LC3_CreateCheckpointer();
+    }
+
+    if (strcmp(argv[0], "off") == 0) {
+        LC3_SetAutoCheckpoint(tui->checkpoint, sim, NULL, 0, 0);
+        return 0;
+    }
+
+    if (argc == 1) {
+        return LC3_Checkpoint(tui->checkpoint, sim, argv[0], true);
+    }
+
+    size_t len = strlen(argv[1]);
+
+    if (len > 1 && argv[1][len - 1] == 's') {
+        double seconds = strtod(argv[1], NULL);
+
+        if (seconds <= 0) {
+            LC3_ShowMessage(tui, "invalid interval", true);
+            return 1;
+        }
+
+        LC3_SetAutoCheckpoint(tui->checkpoint, sim, argv[0], 0, seconds);
+    } else {
+        OptInt steps = getNumber(argv[1]);
+
+        if (!steps.set || steps.value <= 0) {
+            LC3_ShowMessage(tui, "invalid interval", true);
+            return 1;
+        }
+
+        LC3_SetAutoCheckpoint(tui->checkpoint, sim, argv[0], steps.value, 0);
+    }
+
+    return 0;
+}
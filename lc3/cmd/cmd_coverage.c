@@ -0,0 +1,49 @@
+#include "cmd_util.h"
+#include "../lc3_cover.h"
+
+
+// Collect coverage of executed instructions and BR directions, show totals or write a report
+// cov[erage] [on/off/reset] | report LISTING [LCOV]
+LC3_CMD_FN(coverageCommands) {
+    if (argc > 0 && strcmp(argv[0], "on") == 0) {
+        if (sim->coverage == NULL) {
+            sim->coverage = LC3_CreateCoverage();
+        }
+
+        return 0;
+    } else if (argc > 0 && strcmp(argv[0], "off") == 0) {
+        if (sim->coverage) {
+            lc_free(sim->coverage);
+            sim->coverage = NULL;
+        }
+
+        return 0;
+    }
+
+    if (sim->coverage == NULL) {
+        LC3_ShowMessage(tui, "coverage is off", true);
+        return 1;
+    }
+
+    if (argc == 0) {
+        char summaryString[96];
+        LC3_CoverageSummary sum = LC3_SummarizeCoverage(sim->coverage, sim);
+        snprintf(summaryString, sizeof(summaryString), "lines: %zu/%zu, branches: %zu/%zu", sum.linesHit, sum.lines, sum.branchesHit, sum.branches);
+        LC3_ShowMessage(tui, summaryString, false);
+    } else if (strcmp(argv[0], "reset") == 0) {
+        memset(sim->coverage, 0, sizeof(LC3_Coverage));
+    } else if (strcmp(argv[0], "report") == 0 && (argc == 2 || argc == 3)) {
+        char lcov[256];
+        snprintf(lcov, sizeof(lcov), "%s.info", argv[1]);
+
+        if (LC3_WriteCoverage(sim->coverage, sim, argv[1], (argc == 3) ? argv[2] : lcov) != 0) {
+            LC3_ShowMessage(tui, "failed to write report", true);
+            return 1;
+        }
+    } else {
+        LC3_ShowMessage(tui, "invalid argument", true);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include "cmd_util.h"
+#include "../lc3_diff.h"
+
+// Values shown per side of a changed range
+#define DIFF_SHOWN (4)
+
+
+// Format up to DIFF_SHOWN values of a range
+static void formatValues(char *buf, size_t n, const LC3_MemoryCell *mem, LC3_DiffRange range) {
+    int len = 0;
+    buf[0] = '\0';
+
+    for (uint32_t i = 0; i < range.len && i < DIFF_SHOWN && (size_t)len < n; i++) {
+        len += snprintf(buf + len, n - len, "%sx%04X", (i > 0) ? " " : "", (uint16_t)mem[(uint16_t)(range.start + i)].value);
+    }
+
+    if (range.len > DIFF_SHOWN && (size_t)len < n) {
+        snprintf(buf + len, n - len, " ..");
+    }
+}
+
+
+// List changed registers and memory ranges, returns the amount of changed words
+static size_t addDiffLines(StringArray *lines, const LC3_Registers *oldReg, const LC3_Registers *reg, const LC3_MemoryCell *oldMem, const LC3_MemoryCell *mem, const bool *pages) {
+    char name[16], before[64], after[64];
+    size_t words = 0;
+
+    for (int i = 0; i < 8; i++) {
+        if (oldReg->reg[i] != reg->reg[i]) {
+            snprintf(name, sizeof(name), "R%d", i);
+            addLine(lines, "%-13s x%04X -> x%04X", name, (uint16_t)oldReg->reg[i], (uint16_t)reg->reg[i]);
+        }
+    }
+
+    if (oldReg->PC != reg->PC) {
+        addLine(lines, "%-13s x%04X -> x%04X", "PC", oldReg->PC, reg->PC);
+    }
+
+    if (oldReg->PSR != reg->PSR) {
+        addLine(lines, "%-13s x%04X -> x%04X", "PSR", oldReg->PSR, reg->PSR);
+    }
+
+    LC3_DiffRanges ranges = LC3_DiffMemory(oldMem, mem, pages);
+
+    for (size_t i = 0; i < ranges.sz; i++) {
+        LC3_DiffRange range = ranges.ptr[i];
+        words += range.len;
+
+        if (range.len == 1) {
+            snprintf(name, sizeof(name), "x%04X", range.start);
+        } else {
+            snprintf(name, sizeof(name), "x%04X-x%04X", range.start, (uint16_t)(range.start + range.len - 1));
+        }
+
+        formatValues(before, sizeof(before), oldMem, range);
+        formatValues(after, sizeof(after), mem, range);
+        addLine(lines, "%-13s %s -> %s", name, before, after);
+    }
+
+    if (ranges.sz > 0) {
+        addLine(lines, "%zu word%s changed in %zu range%s", words, (words == 1) ? "" : "s", ranges.sz, (ranges.sz == 1) ? "" : "s");
+    }
+
+    lc_free(ranges.ptr);
+    return words;
+}
+
+
+// Compare against the state N instructions ago, using the undo history
+static int diffHistory(StringArray *lines, LC3_SimInstance *sim, size_t steps) {
+    LC3_MemoryCell *old = lc_malloc(LC3_MEM_SIZE * sizeof(LC3_MemoryCell));
+    bool pages[LC3_PAGE_COUNT] = {0};
+
+    memcpy(old, sim->memory, LC3_MEM_SIZE * sizeof(LC3_MemoryCell));
+
+    // Only the pages written by those instructions can differ
+    for (size_t i = sim->history.sz; i > sim->history.sz - steps; i--) {
+        LC3_PrevState state = sim->history.ptr[i - 1];
+        old[state.memoryLocation].value = state.memoryValue;
+        pages[LC3_PAGE(state.memoryLocation)] = true;
+    }
+
+    addDiffLines(lines, &sim->history.ptr[sim->history.sz - steps].reg, &sim->reg, old, sim->memory, pages);
+    lc_free(old);
+    return 0;
+}
+
+
+// Compare against an in-memory snapshot, pages not modified since it was taken are skipped
+static int diffSnapshot(StringArray *lines, LC3_SimInstance *sim, const LC3_SimImage *image) {
+    bool pages[LC3_PAGE_COUNT];
+
+    for (int i = 0; i < LC3_PAGE_COUNT; i++) {
+        pages[i] = LC3_IsDirty(sim, i, image->mark);
+    }
+
+    addDiffLines(lines, &image->state.reg, &sim->reg, image->state.memory, sim->memory, pages);
+    return 0;
+}
+
+
+// Compare against a saved state file
+static int diffFile(StringArray *lines, LC3_SimInstance *sim, const char *filename) {
+    LC3_SimInstance old = LC3_CreateSimInstance();
+    int ret = LC3_LoadSimulatorState(&old, filename);
+
+    if (ret == 0) {
+        addDiffLines(lines, &old.reg, &sim->reg, old.memory, sim->memory, NULL);
+    }
+
+    LC3_DestroySimInstance(old);
+    return ret;
+}
+
+
+// Compare memory and registers to an earlier state
+// diff N | SNAPSHOT | FILE
+LC3_CMD_FN(diffState) {
+    if (argc != 1) {
+        LC3_ShowMessage(tui, "provide an instruction count, snapshot or file", true);
+        return 1;
+    }
+
+    OptInt steps = getNumber(argv[0]);
+    LC3_SimImage *image = LC3_FindSnapshot(tui, argv[0]);
+    StringArray lines = newStringArray();
+    int ret = 0;
+
+    if (steps.set) {
+        if (!inRange(steps.value, 1, sim->history.sz)) {
+            LC3_ShowMessage(tui, "not that many instructions in history", true);
+            freeStringArray(lines);
+            return 1;
+        }
+
+        ret = diffHistory(&lines, sim, steps.value);
+    } else if (image != NULL) {
+        ret = diffSnapshot(&lines, sim, image);
+    } else if ((ret = diffFile(&lines, sim, argv[0])) != 0) {
+        LC3_ShowMessage(tui, "no such snapshot, and failed to load from file", true);
+    }
+
+    if (ret == 0 && lines.sz == 0) {
+        LC3_ShowMessage(tui, "no differences", false);
+    } else if (ret == 0) {
+        LC3_ShowListing(tui, &lines);
+    }
+
+    freeStringArray(lines);
+    return ret;
+}
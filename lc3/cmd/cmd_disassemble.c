@@ -0,0 +1,31 @@
+#include "cmd_util.h"
+
+
+// Disassemble n instructions starting at addr, PC and 16 assumed
+// dis [N1] [N2]
+LC3_CMD_FN(disassemble) {
+    OptInt addr  = (argc > 0) ? parseVariable(sim, argv[0]) : fromInt(sim->reg.PC);
+    OptInt count = (argc > 1) ? parseVariable(sim, argv[1]) : fromInt(16);
+
+    if (!addr.set || !inRange(addr.value, INT16_MIN, UINT16_MAX)) {
+        LC3_ShowMessage(tui, "invalid address", true);
+        return 1;
+    }
+
+    if (!count.set || !inRange(count.value, 1, LC3_MEM_SIZE)) {
+        LC3_ShowMessage(tui, "invalid count", true);
+        return 1;
+    }
+
+    StringArray lines = newStringArray();
+
+    for (int i = 0; i < count.value; i++) {
+        uint16_t at = (uint16_t)(addr.value + i);
+        const char *text = LC3_DisassembleCached(tui->disasm, sim, at, sim->memory[at].value);
+        addLine(&lines, "%cx%04X | x%04X | %s", (at == sim->reg.PC) ? '>' : ' ', at, (uint16_t)sim->memory[at].value, text);
+    }
+
+    LC3_ShowListing(tui, &lines);
+    freeStringArray(lines);
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include "cmd_util.h"
+#include <ctype.h>
+
+
+// Add a single (masked) word to the pattern
+static bool addPatternWord(LC3_FindPattern *pattern, uint16_t value, uint16_t mask) {
+    if (pattern->len >= LC3_FIND_MAX) {
+        return false;
+    }
+
+    pattern->value[pattern->len] = value & mask;
+    pattern->mask[pattern->len]  = mask;
+    pattern->len++;
+    return true;
+}
+
+
+// Parse a quoted string into one word per character, str points after the opening quote
+static const char *parsePatternString(LC3_FindPattern *pattern, const char *str) {
+    for (; *str && *str != '"'; str++) {
+        char c = *str;
+
+        if (c == '\\' && str[1] && getEscaped(str[1]) >= 0) {
+            c = getEscaped(*(++str));
+        }
+
+        if (!addPatternWord(pattern, (uint8_t)c, 0xFFFF)) {
+            return NULL;
+        }
+    }
+
+    return (*str == '"') ? str + 1 : NULL;
+}
+
+
+// Parse a single word, N, N/MASK or ? for any value
+static bool parsePatternWord(LC3_SimInstance *sim, LC3_FindPattern *pattern, char *word) {
+    if (strcmp(word, "?") == 0) {
+        return addPatternWord(pattern, 0, 0);
+    }
+
+    char *slash = strchr(word, '/');
+    OptInt mask = fromInt(0xFFFF);
+
+    if (slash != NULL) {
+        (*slash) = '\0';
+        mask = parseVariable(sim, slash + 1);
+    }
+
+    OptInt value = parseVariable(sim, word);
+
+    if (!value.set || !mask.set || !inRange(value.value, INT16_MIN, UINT16_MAX) || !inRange(mask.value, 0, UINT16_MAX)) {
+        return false;
+    }
+
+    return addPatternWord(pattern, (uint16_t)value.value, (uint16_t)mask.value);
+}
+
+
+// Parse a pattern of words and strings, separated by spaces or commas
+static bool parsePattern(LC3_SimInstance *sim, LC3_FindPattern *pattern, const char *str) {
+    char word[64];
+    pattern->len = 0;
+
+    while (*str) {
+        if (isspace((unsigned char)*str) || *str == ',') {
+            str++;
+        } else if (*str == '"') {
+            if ((str = parsePatternString(pattern, str + 1)) == NULL) {
+                return false;
+            }
+        } else {
+            size_t len = 0;
+
+            for (; *str && !isspace((unsigned char)*str) && *str != ',' && *str != '"'; str++) {
+                if (len + 1 >= sizeof(word)) {
+                    return false;
+                }
+
+                word[len++] = *str;
+            }
+
+            word[len] = '\0';
+
+            if (!parsePatternWord(sim, pattern, word)) {
+                return false;
+            }
+        }
+    }
+
+    return pattern->len > 0;
+}
+
+
+// Search memory for values, masked values, sequences and strings
+// find PATTERN
+LC3_CMD_FN(findPattern) {
+    LC3_FindPattern pattern;
+    char msg[64];
+
+    if (tui->search == NULL) {
+        tui->search = LC3_CreateSearch();
+    }
+
+    if (argc != 1 || !parsePattern(sim, &pattern, argv[0])) {
+        tui->search->hitCount = 0;
+        LC3_ShowMessage(tui, "invalid pattern", true);
+        return 1;
+    }
+
+    LC3_UpdateSearch(tui->search, sim);
+    size_t count = LC3_SearchPattern(tui->search, &pattern);
+
+    if (tui->headless) {
+        StringArray lines = newStringArray();
+        for (size_t i = 0; i < count; addLine(&lines, "x%04X", tui->search->hits[i]), i++);
+        LC3_ShowListing(tui, &lines);
+        freeStringArray(lines);
+    } else if (count > 0) {
+        // Jump to the first hit from the top of the memory view
+        tui->memViewStart = LC3_NextHit(tui->search, (uint16_t)(tui->memViewStart - 1), false);
+    }
+
+    snprintf(msg, sizeof(msg), "%zu match%s", count, (count == 1) ? "" : "es");
+    LC3_ShowMessage(tui, msg, false);
+    return 0;
+}
@@ -4,6 +4,10 @@
 // Stop simulation at current point
 // h[alt]
 LC3_CMD_FN(stopSimulation) {
+    if (tui->worker) {
+        return !LC3_PostWorker(tui->worker, LC3_WORKER_HALT, 0);
+    }
+
     sim->flags |= LC3_SIM_HALTED;
     return 0;
 }
@@ -8,10 +8,10 @@ LC3_CMD_FN(showHelpInfo) {
     const LC3_Command *commands = getCommands(&sz);
 
     if (tui->headless) {
-        for (int i = 0; i < sz; i++) {
-            printf("%s\n", commands[i].info);
-        }
-
+        StringArray lines = newStringArray();
+        for (int i = 0; i < sz; addLine(&lines, "%s", commands[i].info), i++);
+        LC3_ShowListing(tui, &lines);
+        freeStringArray(lines);
         return 0;
     }
 
@@ -28,7 +28,7 @@ LC3_CMD_FN(showHelpInfo) {
             mvprintw(y + i + 1, x, "    %s\n", commands[i].info);
         }
 
-        mvprintw(y + sz + 1, x, "    WHERE [N] is either a [REG] (register string) or number");
+        mvprintw(y + sz + 1, x, "    WHERE [N] is either a [REG] (register string), number or label from the symbol table");
         mvprintw(y + sz + 3, x, "Displayed:");
         mvprintw(y + sz + 4, x, "    Top left               | Memory viewer");
         mvprintw(y + sz + 5, x, "    Top right              | Register status");
@@ -52,5 +52,8 @@ LC3_CMD_FN(showHelpInfo) {
     }
     
     clear();
+
+    // The windows were drawn over
+    tui->render.valid = false;
     return 0;
 }
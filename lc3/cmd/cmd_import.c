@@ -0,0 +1,76 @@
+#include "cmd_util.h"
+#include "../lc3_bulk.h"
+
+
+// Get the format argument, or guess it from the file name
+static LC3_DataFormat dataFormat(int argc, const char **argv, int idx) {
+    return (argc > idx) ? LC3_ParseDataFormat(argv[idx]) : LC3_GuessDataFormat(argv[0]);
+}
+
+
+// Write the words in a file to memory
+// im[port] FILE N [be/le/hex/bin]
+LC3_CMD_FN(importMemory) {
+    char msg[64];
+
+    if (argc < 2 || argc > 3) {
+        LC3_ShowMessage(tui, "provide a file and address", true);
+        return 1;
+    }
+
+    OptInt addr = parseVariable(sim, argv[1]);
+    LC3_DataFormat fmt = dataFormat(argc, argv, 2);
+
+    if (!addr.set || !inRange(addr.value, 0, UINT16_MAX)) {
+        LC3_ShowMessage(tui, "invalid address", true);
+        return 1;
+    }
+
+    if (fmt == LC3_DATA_UNKNOWN) {
+        LC3_ShowMessage(tui, "unknown format, use be, le, hex or bin", true);
+        return 1;
+    }
+
+    int32_t n = LC3_ImportMemory(sim, argv[0], (uint16_t)addr.value, fmt);
+
+    if (n < 0) {
+        LC3_ShowMessage(tui, sim->error, true);
+        sim->error = NULL;
+        return 1;
+    }
+
+    snprintf(msg, sizeof(msg), "%d words imported", n);
+    LC3_ShowMessage(tui, msg, false);
+    return 0;
+}
+
+
+// Write words of memory to a file
+// ex[port] FILE N1 N2 [be/le/hex/bin]
+LC3_CMD_FN(exportMemory) {
+    if (argc < 3 || argc > 4) {
+        LC3_ShowMessage(tui, "provide a file, address and length", true);
+        return 1;
+    }
+
+    OptInt addr = parseVariable(sim, argv[1]);
+    OptInt len  = parseVariable(sim, argv[2]);
+    LC3_DataFormat fmt = dataFormat(argc, argv, 3);
+
+    if (!addr.set || !inRange(addr.value, 0, UINT16_MAX) || !len.set || !inRange(len.value, 1, LC3_MEM_SIZE)) {
+        LC3_ShowMessage(tui, "invalid address or length", true);
+        return 1;
+    }
+
+    if (fmt == LC3_DATA_UNKNOWN) {
+        LC3_ShowMessage(tui, "unknown format, use be, le, hex or bin", true);
+        return 1;
+    }
+
+    if (LC3_ExportMemory(sim, argv[0], (uint16_t)addr.value, (uint32_t)len.value, fmt) != 0) {
+        LC3_ShowMessage(tui, "failed to write file", true);
+        return 1;
+    }
+
+    return 0;
+}
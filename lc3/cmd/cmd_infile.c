@@ -1,4 +1,5 @@
 #include "cmd_util.h"
+#include "../lc3_record.h"
 
 
 // Set input file
@@ -16,8 +17,10 @@ LC3_CMD_FN(setInputFile) {
         return 1;
     }
 
+    size_t from = VQ_SZ(sim->inputs);
     for (int c; fread(&c, 1, 1, fp) == 1; LC3_QueueInput(&sim->inputs, c));
 
     fclose(fp);
+    LC3_RecordQueued(sim, from);
     return 0;
 }
@@ -1,4 +1,5 @@
 #include "cmd_util.h"
+#include "../lc3_record.h"
 
 
 // Queue input for LC3 simulator
@@ -9,6 +10,8 @@ LC3_CMD_FN(giveInput) {
         return 1;
     }
 
+    size_t from = VQ_SZ(sim->inputs);
+
     for (int i = 0; argv[0][i]; i++) {
         if (argv[0][i] == '\\' && ++i && getEscaped(argv[0][i]) > 0) {
             LC3_QueueInput(&sim->inputs, getEscaped(argv[0][i]));
@@ -17,5 +20,6 @@ LC3_CMD_FN(giveInput) {
         }
     }
 
+    LC3_RecordQueued(sim, from);
     return 0;
 }
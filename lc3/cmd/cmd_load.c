@@ -9,6 +9,7 @@ LC3_CMD_FN(loadSimulator) {
 
     if (LC3_LoadSimulatorState(sim, argv[0]) != 0) {
         LC3_ShowMessage(tui, "failed to load from file", true);
+        sim->error = NULL;
         return 1;
     }
 
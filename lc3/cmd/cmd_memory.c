@@ -0,0 +1,45 @@
+#include "cmd_util.h"
+
+// Words per line of the listing
+#define MEMORY_LINE_WORDS (8)
+
+
+// Show n words of memory starting at addr, PC and 16 assumed
+// In JSON mode, the words are put in the response as a hex run instead
+// mem [N1] [N2]
+LC3_CMD_FN(showMemory) {
+    OptInt addr  = (argc > 0) ? parseVariable(sim, argv[0]) : fromInt(sim->reg.PC);
+    OptInt count = (argc > 1) ? parseVariable(sim, argv[1]) : fromInt(16);
+
+    if (!addr.set || !inRange(addr.value, 0, UINT16_MAX)) {
+        LC3_ShowMessage(tui, "invalid address", true);
+        return 1;
+    }
+
+    if (!count.set || !inRange(count.value, 1, LC3_MEM_SIZE - addr.value)) {
+        LC3_ShowMessage(tui, "invalid count", true);
+        return 1;
+    }
+
+    if (tui->json) {
+        tui->json->memAddr = addr.value;
+        tui->json->memCount = count.value;
+        return 0;
+    }
+
+    StringArray lines = newStringArray();
+
+    for (int i = 0; i < count.value; i += MEMORY_LINE_WORDS) {
+        char words[MEMORY_LINE_WORDS * 5 + 1] = {0};
+
+        for (int j = 0; j < MEMORY_LINE_WORDS && i + j < count.value; j++) {
+            snprintf(words + j * 5, 6, " %04X", (uint16_t)sim->memory[addr.value + i + j].value);
+        }
+
+        addLine(&lines, "x%04X |%s", addr.value + i, words);
+    }
+
+    LC3_ShowListing(tui, &lines);
+    freeStringArray(lines);
+    return 0;
+}
@@ -1,9 +1,15 @@
 #include "cmd_util.h"
+#include "../lc3_record.h"
 
 
 // Clear queue'd inputs
 // n[o]in[put]
 LC3_CMD_FN(removeInputs) {
     sim->inputs.hd = sim->inputs.tl = 0;
+
+    if (sim->recorder) {
+        LC3_RecordEvent(sim->recorder, LC3_RECORD_CLEAR, sim->counter, NULL, 0);
+    }
+
     return 0;
 }
@@ -4,10 +4,34 @@
 // Read new file(s) into memory
 // r[ea]d <file> ...
 LC3_CMD_FN(loadExecutable) {
+    const char *error = NULL;
+
     for (int i = 0; i < argc; i++) {
+        sim->error = NULL;
         LC3_LoadExecutable(sim, argv[i]);
+
+        // Files that loaded are reloaded whenever they change on disk, if the reloader could be started
+        if (sim->error == NULL) {
+            tui->reloader = (tui->reloader != NULL) ? tui->reloader : LC3_CreateReloader();
+        }
+
+        if (sim->error == NULL && tui->reloader != NULL) {
+            LC3_WatchFile(tui->reloader, argv[i]);
+        }
+
+        error = (error != NULL) ? error : sim->error;
     }
 
+    sim->error = error;
+
+    // Pristine image for restart --keep-image
+    if (tui->image == NULL) {
+        tui->image = lc_malloc(sizeof(LC3_SimImage));
+        (*tui->image) = LC3_CreateImage();
+    }
+
+    LC3_CaptureImage(tui->image, sim);
+
     if (!LC3_IsAddrDisplayed(tui, sim->reg.PC)) {
         tui->memViewStart = sim->reg.PC;
     }
@@ -0,0 +1,55 @@
+#include "cmd_util.h"
+#include "../lc3_record.h"
+
+
+// Record queued and read input, with the state to replay it from
+// rec[ord] on FILE | off
+LC3_CMD_FN(recordInput) {
+    bool on = (argc == 2 && strcmp(argv[0], "on") == 0);
+
+    if (!on && !(argc == 1 && strcmp(argv[0], "off") == 0)) {
+        LC3_ShowMessage(tui, "expected on FILE or off", true);
+        return 1;
+    }
+
+    // Starting a new recording ends the previous one
+    if (sim->recorder) {
+        int failed = LC3_StopRecording(sim->recorder, sim);
+        sim->recorder = NULL;
+
+        if (failed) {
+            LC3_ShowMessage(tui, "failed to write recording", true);
+            return 1;
+        }
+    }
+
+    if (on && (sim->recorder = LC3_StartRecording(sim, argv[1])) == NULL) {
+        LC3_ShowMessage(tui, "could not open file", true);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+// Rerun a recording from its start, with the input queued at the same instructions
+// replay FILE
+LC3_CMD_FN(replayInput) {
+    char error[128];
+
+    if (argc != 1) {
+        LC3_ShowMessage(tui, "no filename provided", true);
+        return 1;
+    } else if (sim->recorder) {
+        LC3_ShowMessage(tui, "stop recording first", true);
+        return 1;
+    }
+
+    if (LC3_Replay(sim, argv[0], error, sizeof(error)) != 0) {
+        LC3_ShowMessage(tui, error, true);
+        return 1;
+    }
+
+    tui->memViewStart = (LC3_IsAddrDisplayed(tui, sim->reg.PC)) ? tui->memViewStart : sim->reg.PC;
+    return 0;
+}
@@ -1,11 +1,42 @@
 #include "cmd_util.h"
 
 
-// Reset LC3 simulator completely
-// restart
+// Reset LC3 simulator completely, or back to the state right after the last read
+// restart [--keep-image]
 LC3_CMD_FN(restartDevice) {
+    if (argc > 0 && strcmp(argv[0], "--keep-image") == 0) {
+        if (tui->image == NULL) {
+            LC3_ShowMessage(tui, "no program image, read a file first", true);
+            return 1;
+        }
+
+        LC3_RestoreImage(sim, tui->image);
+        tui->memViewStart = (LC3_IsAddrDisplayed(tui, sim->reg.PC)) ? tui->memViewStart : sim->reg.PC;
+        return 0;
+    }
+
+    // Epochs continue where they were, so existing marks stay valid, a running trace, coverage and output stream are kept
+    uint32_t epoch = sim->epoch;
+    struct LC3_Tracer *tracer = sim->tracer;
+    struct LC3_Coverage *coverage = sim->coverage;
+    FILE *stream = sim->stream;
+
+    sim->tracer = NULL;
+    sim->coverage = NULL;
     LC3_DestroySimInstance(*sim);
     (*sim) = LC3_CreateSimInstance();
+    sim->epoch = epoch;
+    sim->tracer = tracer;
+    sim->coverage = coverage;
+    sim->stream = stream;
+    LC3_MarkAllDirty(sim);
+
     tui->sim = sim;
+
+    // The files read before are gone, so they are not reloaded anymore
+    if (tui->reloader != NULL) {
+        LC3_ForgetFiles(tui->reloader);
+    }
+
     return 0;
 }
@@ -1,14 +1,22 @@
 #include "cmd_util.h"
 
+// Instructions between automatic checkpoint checks in headless mode
+#define HEADLESS_RUN_CHUNK (4096)
+
 
 // Start simulation, stops at breakpoint or stop command
 // run
 LC3_CMD_FN(startSimulation) {
     sim->flags &= ~LC3_SIM_HALTED;
 
-    if (tui->headless) {
+    if (tui->headless && (tui->checkpoint == NULL || tui->checkpoint->autoFile == NULL)) {
         LC3_UntilBreakpoint(sim, -1);
     }
 
+    while (tui->headless && !(sim->flags & LC3_SIM_HALTED)) {
+        LC3_UntilBreakpoint(sim, HEADLESS_RUN_CHUNK);
+        LC3_CheckpointTick(tui->checkpoint, sim);
+    }
+
     return 0;
 }
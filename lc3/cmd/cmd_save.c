@@ -1,14 +1,34 @@
 #include "cmd_util.h"
 
 
+// Save simulator state, optionally only the changes since a previous save
+// s[a]v[e] [--delta BASE] FILE
 LC3_CMD_FN(saveSimulator) {
+    const char *base = NULL;
+
+    if (argc == 3 && strcmp(argv[0], "--delta") == 0) {
+        base = argv[1];
+        argc -= 2;
+        argv += 2;
+    }
+
     if (argc != 1) {
         LC3_ShowMessage(tui, "no filename provided", true);
         return 1;
     }
 
-    if (LC3_SaveSimulatorState(sim, argv[0]) != 0) {
+    // Full saves in the TUI are written in the background, unless the writer is busy
+    if (!tui->headless && base == NULL) {
+        tui->checkpoint = tui->checkpoint ? tui->checkpoint : LC3_CreateCheckpointer();
+
+        if (LC3_Checkpoint(tui->checkpoint, sim, argv[0], false) == 0) {
+            return 0;
+        }
+    }
+
+    if (LC3_SaveSimulatorState(sim, argv[0], base) != 0) {
         LC3_ShowMessage(tui, "failed to save to file", true);
+        sim->error = NULL;
         return 1;
     }
 
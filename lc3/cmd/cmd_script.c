@@ -0,0 +1,34 @@
+#include "cmd_util.h"
+
+// How deep scripts may run other scripts, so a script running itself ends
+#define SCRIPT_DEPTH_MAX (16)
+
+
+// Run a file of commands, which is parsed completely before anything runs
+// sc[ript] FILE
+LC3_CMD_FN(runScript) {
+    static int depth = 0;
+
+    if (argc != 1) {
+        LC3_ShowMessage(tui, "provide a file", true);
+        return 1;
+    } else if (depth >= SCRIPT_DEPTH_MAX) {
+        LC3_ShowMessage(tui, "scripts nested too deeply", true);
+        return 1;
+    }
+
+    LC3_Script *script = LC3_CompileScript(argv[0]);
+    int ret = 0;
+
+    if (script->error[0] != '\0') {
+        LC3_ShowMessage(tui, script->error, true);
+        ret = 1;
+    }
+
+    depth++;
+    LC3_RunScript(tui, script);
+    depth--;
+
+    LC3_DestroyScript(script);
+    return ret;
+}
@@ -21,6 +21,7 @@ LC3_CMD_FN(setMemoryValue) {
 
         if (value.set && inRange(value.value, INT16_MIN, UINT16_MAX)) {
             sim->memory[location.value].value = (int16_t)value.value;
+            LC3_MarkDirty(sim, location.value);
         } else {
             LC3_ShowMessage(tui, "invalid value", true);
         }
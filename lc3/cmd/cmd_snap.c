@@ -0,0 +1,32 @@
+#include "cmd_util.h"
+
+
+// Take an in-memory snapshot, or list the snapshots
+// snap [NAME]
+LC3_CMD_FN(snapSimulator) {
+    if (argc > 1) {
+        LC3_ShowMessage(tui, "invalid argc", true);
+        return 1;
+    }
+
+    if (argc == 1) {
+        LC3_TakeSnapshot(tui, argv[0]);
+        return 0;
+    }
+
+    if (tui->snapshots.sz == 0) {
+        LC3_ShowMessage(tui, "no snapshots", false);
+        return 0;
+    }
+
+    StringArray lines = newStringArray();
+
+    for (size_t i = 0; i < tui->snapshots.sz; i++) {
+        const LC3_SimInstance *state = &tui->snapshots.ptr[i].image->state;
+        addLine(&lines, "%-16s PC x%04X, %zu instructions", tui->snapshots.ptr[i].name.ptr, state->reg.PC, state->counter);
+    }
+
+    LC3_ShowListing(tui, &lines);
+    freeStringArray(lines);
+    return 0;
+}
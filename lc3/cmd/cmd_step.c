@@ -4,7 +4,11 @@
 // Execute N simulation steps, stops at breakpoints
 // st[ep] [N]
 LC3_CMD_FN(makeSteps) {
-    OptInt steps = (argc > 0) ? parseVariable(sim, argv[0]) : fromInt(1);
+    OptInt steps = (argc > 0) ? parseLiveVariable(tui, sim, argv[0]) : fromInt(1);
+
+    if (steps.set && tui->worker) {
+        return (steps.value > 0) ? !LC3_PostWorker(tui->worker, LC3_WORKER_STEP, steps.value) : 0;
+    }
 
     if (steps.set) {
         sim->flags &= ~(LC3_SIM_HALTED);
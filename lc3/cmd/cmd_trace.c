@@ -0,0 +1,32 @@
+#include "cmd_util.h"
+#include "../lc3_trace.h"
+
+
+// Record every executed instruction to a binary trace file
+// trace on FILE | off
+LC3_CMD_FN(traceExecution) {
+    bool on = (argc == 2 && strcmp(argv[0], "on") == 0);
+
+    if (!on && !(argc == 1 && strcmp(argv[0], "off") == 0)) {
+        LC3_ShowMessage(tui, "expected on FILE or off", true);
+        return 1;
+    }
+
+    // Starting a new trace ends the previous one
+    if (sim->tracer) {
+        int failed = LC3_StopTrace(sim->tracer);
+        sim->tracer = NULL;
+
+        if (failed) {
+            LC3_ShowMessage(tui, "failed to write trace", true);
+            return 1;
+        }
+    }
+
+    if (on && (sim->tracer = LC3_StartTrace(sim, argv[1])) == NULL) {
+        LC3_ShowMessage(tui, "could not start trace", true);
+        return 1;
+    }
+
+    return 0;
+}
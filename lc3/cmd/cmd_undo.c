@@ -12,6 +12,7 @@ LC3_CMD_FN(undoSteps) {
 
         sim->reg = state.reg;
         sim->memory[state.memoryLocation].value = state.memoryValue;
+        LC3_MarkDirty(sim, state.memoryLocation);
     }
 
     if (!LC3_IsAddrDisplayed(tui, sim->reg.PC)) {
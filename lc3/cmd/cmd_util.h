@@ -14,6 +14,7 @@ typedef struct LC3_Command {
     const char *abbrev;
     LC3_CMD_FN_PTR(func);
     const char *info;
+    bool live;      // Does not need the simulation worker paused, sends it messages instead
 } LC3_Command;
 
 const LC3_Command *getCommands(int *sz);
@@ -23,4 +24,6 @@ OptInt toBase(char digit, uint8_t base);
 OptInt getNumber(const char *str);
 OptInt parseRegister(LC3_SimInstance *sim, const char *str);
 OptInt parseVariable(LC3_SimInstance *sim, const char *var);
+OptInt parseLiveVariable(LC3_TermInterface *tui, LC3_SimInstance *sim, const char *var);
 OptInt fromInt(int n);
+void addLine(StringArray *lines, const char *fmt, ...);
@@ -0,0 +1,830 @@
+#include "lc3_asm.h"
+#include "lc3_util.h"
+#include <ctype.h>
+#include <stdarg.h>
+
+// Most tokens a line can have (label, mnemonic, operands)
+#define MAX_TOKENS (6)
+
+
+// Line and label list functions
+vaAllocFunction(LC3_AsmLines, LC3_AsmLine, newAsmLines, ;, ;)
+vaAppendFunction(LC3_AsmLines, LC3_AsmLine, addAsmLine, ;, ;)
+vaFreeFunction(LC3_AsmLines, LC3_AsmLine, freeAsmLines, lc_free(el.text.ptr), ;, ;)
+vaAllocFunction(LC3_AsmLabels, LC3_AsmLabel, newAsmLabels, ;, ;)
+vaAppendFunction(LC3_AsmLabels, LC3_AsmLabel, addAsmLabel, ;, ;)
+vaFreeFunction(LC3_AsmLabels, LC3_AsmLabel, freeAsmLabels, lc_free(el.name.ptr), ;, ;)
+
+
+// Operand layouts
+typedef enum AsmFormat {
+    ASM_ALU,                        // ADD/AND DR, SR1, SR2/imm5
+    ASM_NOT,                        // NOT DR, SR
+    ASM_BR,                         // BR[n][z][p] LABEL
+    ASM_REG,                        // JMP/JSRR BaseR
+    ASM_FIXED,                      // No operands, always the same word
+    ASM_JSR,                        // JSR LABEL
+    ASM_MEM,                        // LD/LDI/LEA/ST/STI R, LABEL
+    ASM_BASE,                       // LDR/STR R, BaseR, offset6
+    ASM_TRAP,                       // TRAP trapvect8
+    ASM_ORIG,                       // .ORIG address
+    ASM_END,                        // .END
+    ASM_FILL,                       // .FILL value or label
+    ASM_BLKW,                       // .BLKW count
+    ASM_STRINGZ,                    // .STRINGZ "string"
+} AsmFormat;
+
+
+// Mnemonic or directive
+typedef struct AsmOp {
+    const char *name;
+    AsmFormat format;
+    uint16_t base;                  // Bits set regardless of the operands
+    int argc;                       // Amount of operands
+} AsmOp;
+
+
+static const AsmOp asmOps[] = {
+    {"ADD",  ASM_ALU,   0x1000, 3}, {"AND",   ASM_ALU,   0x5000, 3}, {"NOT",  ASM_NOT,   0x903F, 2},
+    {"JMP",  ASM_REG,   0xC000, 1}, {"JSRR",  ASM_REG,   0x4000, 1}, {"RET",  ASM_FIXED, 0xC1C0, 0},
+    {"RTI",  ASM_FIXED, 0x8000, 0}, {"JSR",   ASM_JSR,   0x4800, 1},
+    {"LD",   ASM_MEM,   0x2000, 2}, {"LDI",   ASM_MEM,   0xA000, 2}, {"LEA",  ASM_MEM,   0xE000, 2},
+    {"ST",   ASM_MEM,   0x3000, 2}, {"STI",   ASM_MEM,   0xB000, 2},
+    {"LDR",  ASM_BASE,  0x6000, 3}, {"STR",   ASM_BASE,  0x7000, 3}, {"TRAP", ASM_TRAP,  0xF000, 1},
+    {"GETC", ASM_FIXED, 0xF020, 0}, {"OUT",   ASM_FIXED, 0xF021, 0}, {"PUTS", ASM_FIXED, 0xF022, 0},
+    {"IN",   ASM_FIXED, 0xF023, 0}, {"PUTSP", ASM_FIXED, 0xF024, 0}, {"HALT", ASM_FIXED, 0xF025, 0},
+    {".ORIG", ASM_ORIG, 0, 1}, {".END", ASM_END, 0, 0}, {".FILL", ASM_FILL, 0, 1},
+    {".BLKW", ASM_BLKW, 0, 1}, {".STRINGZ", ASM_STRINGZ, 0, 1},
+};
+
+static const AsmOp brOp = {"BR", ASM_BR, 0x0000, 1};
+
+
+// Tokenized source line
+typedef struct AsmStmt {
+    char *tok[MAX_TOKENS];
+    int count;
+    const char *label;              // Label defined by this line, NULL if none
+    const AsmOp *op;                // NULL for lines without instruction
+    uint16_t cond;                  // Condition bits of BR
+    char **args;                    // Operands of op
+    char buf[LC3_ASM_LINE_MAX];     // Copy of the line the tokens point into
+} AsmStmt;
+
+
+LC3_Assembly *LC3_CreateAssembly() {
+    LC3_Assembly *as = lc_malloc(sizeof(LC3_Assembly));
+
+    as->filename = newString();
+    as->lines    = newAsmLines();
+    as->labels   = newAsmLabels();
+    as->patched  = false;
+    as->error[0] = '\0';
+    return as;
+}
+
+
+void LC3_DestroyAssembly(LC3_Assembly *as) {
+    if (as == NULL) {
+        return;
+    }
+
+    lc_free(as->filename.ptr);
+    freeAsmLines(as->lines);
+    freeAsmLabels(as->labels);
+    lc_free(as);
+}
+
+
+// Set sim->error to a message about line idx
+static void asmError(LC3_Assembly *as, LC3_SimInstance *sim, size_t idx, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+
+    int n = snprintf(as->error, sizeof(as->error), "line %zu: ", idx + 1);
+    vsnprintf(as->error + n, sizeof(as->error) - n, fmt, args);
+    sim->error = as->error;
+
+    va_end(args);
+}
+
+
+static String copyText(const char *str, size_t len) {
+    String ret = newString();
+    for (size_t i = 0; i < len; addchar(&ret, str[i]), i++);
+    return ret;
+}
+
+
+// Split file contents into lines, without line endings
+static LC3_AsmLines splitLines(const char *text, size_t size) {
+    LC3_AsmLines lines = newAsmLines();
+
+    for (size_t start = 0, end = 0; start < size; start = end + 1) {
+        for (end = start; end < size && text[end] != '\n'; end++);
+        size_t len = (end > start && text[end - 1] == '\r') ? end - start - 1 : end - start;
+
+        LC3_AsmLine line = {copyText(text + start, len), 0, 0};
+        addAsmLine(&lines, line);
+    }
+
+    return lines;
+}
+
+
+// Case-insensitive string comparison
+static bool sameName(const char *a, const char *b) {
+    for (; *a && tolower((unsigned char)*a) == tolower((unsigned char)*b); a++, b++);
+    return (*a == '\0' && *b == '\0');
+}
+
+
+// Find mnemonic or directive, BR conditions are put into cond
+static const AsmOp *findOp(const char *name, uint16_t *cond) {
+    for (size_t i = 0; i < sizeof(asmOps) / sizeof(asmOps[0]); i++) {
+        if (sameName(name, asmOps[i].name)) {
+            return &asmOps[i];
+        }
+    }
+
+    if (tolower((unsigned char)name[0]) != 'b' || tolower((unsigned char)name[1]) != 'r') {
+        return NULL;
+    }
+
+    // BR takes its conditions in n, z, p order, none means all of them
+    const char *flags = "nzp", *at = name + 2;
+    (*cond) = 0;
+
+    for (int i = 0; i < 3 && *at; i++) {
+        if (tolower((unsigned char)*at) == flags[i]) {
+            (*cond) |= 0x0800 >> i;
+            at++;
+        }
+    }
+
+    if (*at != '\0') {
+        return NULL;
+    }
+
+    (*cond) = ((*cond) == 0) ? 0x0E00 : (*cond);
+    return &brOp;
+}
+
+
+static bool isLabel(const char *str) {
+    if (!isalpha((unsigned char)str[0]) && str[0] != '_') {
+        return false;
+    }
+
+    for (; *str; str++) {
+        if (!isalnum((unsigned char)*str) && *str != '_') {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+// Split line into tokens, separated by whitespace or commas, ; starts a comment
+static const char *tokenize(AsmStmt *st, const String *line) {
+    if (line->sz >= LC3_ASM_LINE_MAX) {
+        return "line too long";
+    }
+
+    memcpy(st->buf, line->ptr, line->sz + 1);
+    st->count = 0;
+
+    for (char *at = st->buf; *at;) {
+        if (*at == ';') {
+            break;
+        } else if (isspace((unsigned char)*at) || *at == ',') {
+            at++;
+            continue;
+        } else if (st->count == MAX_TOKENS) {
+            return "too many operands";
+        }
+
+        st->tok[st->count++] = at;
+
+        if (*at == '"') {
+            for (at++; *at && *at != '"'; at += (at[0] == '\\' && at[1]) ? 2 : 1);
+
+            if (*at != '"') {
+                return "unterminated string";
+            }
+
+            at++;
+        } else {
+            for (; *at && !isspace((unsigned char)*at) && *at != ',' && *at != ';'; at++);
+        }
+
+        // Terminate the token, a comment right after it ends the line
+        char next = *at;
+        *at = '\0';
+
+        if (next == ';' || next == '\0') {
+            break;
+        }
+
+        at++;
+    }
+
+    return NULL;
+}
+
+
+// Tokenize a line and find its label and instruction
+static const char *parseStmt(AsmStmt *st, const String *line) {
+    const char *err = tokenize(st, line);
+
+    st->label = NULL;
+    st->op    = NULL;
+
+    if (err != NULL || st->count == 0) {
+        return err;
+    }
+
+    int first = 0;
+    st->op = findOp(st->tok[0], &st->cond);
+
+    if (st->op == NULL) {
+        size_t len = strlen(st->tok[0]);
+
+        if (len > 1 && st->tok[0][len - 1] == ':') {
+            st->tok[0][len - 1] = '\0';
+        }
+
+        if (!isLabel(st->tok[0])) {
+            return "invalid label";
+        }
+
+        st->label = st->tok[0];
+        first = 1;
+
+        if (st->count > 1 && (st->op = findOp(st->tok[1], &st->cond)) == NULL) {
+            return "unknown instruction";
+        }
+    }
+
+    if (st->op != NULL && st->count - first - 1 != st->op->argc) {
+        return "wrong number of operands";
+    }
+
+    st->args = st->tok + first + 1;
+    return NULL;
+}
+
+
+// Parse #decimal, xhex, bbinary or plain decimal numbers
+static bool parseNumber(const char *str, int32_t *value) {
+    int base = 10;
+
+    if (str[0] == '#') {
+        str++;
+    } else if (str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
+        base = 16;
+        str += 2;
+    } else if (str[0] == 'x' || str[0] == 'X') {
+        base = 16;
+        str++;
+    } else if ((str[0] == 'b' || str[0] == 'B') && (str[1] == '0' || str[1] == '1' || str[1] == '-')) {
+        base = 2;
+        str++;
+    }
+
+    bool negative = (str[0] == '-');
+    str += (str[0] == '-' || str[0] == '+');
+
+    if (*str == '\0') {
+        return false;
+    }
+
+    int64_t result = 0;
+
+    for (; *str; str++) {
+        int digit = isdigit((unsigned char)*str) ? (*str - '0') : isxdigit((unsigned char)*str) ? (tolower((unsigned char)*str) - 'a' + 10) : base;
+
+        if (digit >= base || result > UINT16_MAX) {
+            return false;
+        }
+
+        result = result * base + digit;
+    }
+
+    (*value) = (int32_t)(negative ? -result : result);
+    return true;
+}
+
+
+static bool parseRegister(const char *str, uint16_t *reg) {
+    if ((str[0] != 'r' && str[0] != 'R') || str[1] < '0' || str[1] > '7' || str[2] != '\0') {
+        return false;
+    }
+
+    (*reg) = str[1] - '0';
+    return true;
+}
+
+
+// Decode the string of .STRINGZ into out (if not NULL), returns the amount of characters
+static size_t decodeString(const char *str, uint16_t *out) {
+    size_t n = 0;
+
+    for (str++; *str != '"'; str++, n++) {
+        char c = *str;
+
+        if (c == '\\') {
+            str++;
+
+            switch (*str) {
+                case 'n':   c = '\n'; break;
+                case 't':   c = '\t'; break;
+                case 'r':   c = '\r'; break;
+                case 'e':   c = '\x1b'; break;
+                case '0':   c = '\0'; break;
+                default:    c = *str; break;
+            }
+        }
+
+        if (out != NULL) {
+            out[n] = (uint8_t)c;
+        }
+    }
+
+    return n;
+}
+
+
+// Amount of words a statement assembles into
+static const char *stmtSize(const AsmStmt *st, uint16_t *size) {
+    int32_t count;
+    (*size) = 0;
+
+    if (st->op == NULL) {
+        return NULL;
+    }
+
+    switch (st->op->format) {
+        case ASM_ORIG:
+        case ASM_END:       break;
+        case ASM_BLKW:      if (!parseNumber(st->args[0], &count) || count < 1 || count > UINT16_MAX) {
+                                return "invalid .BLKW count";
+                            }
+
+                            (*size) = count;
+                            break;
+        case ASM_STRINGZ:   if (st->args[0][0] != '"') {
+                                return "expected a string";
+                            }
+
+                            (*size) = decodeString(st->args[0], NULL) + 1;
+                            break;
+        default:            (*size) = 1;
+                            break;
+    }
+
+    return NULL;
+}
+
+
+static int compareLabels(const void *a, const void *b) {
+    return strcmp(((const LC3_AsmLabel *)a)->name.ptr, ((const LC3_AsmLabel *)b)->name.ptr);
+}
+
+
+static int32_t findLabel(const LC3_AsmLabels *labels, const char *name) {
+    LC3_AsmLabel key = {.name = {.ptr = (char *)name}};
+    const LC3_AsmLabel *found = bsearch(&key, labels->ptr, labels->sz, sizeof(LC3_AsmLabel), compareLabels);
+    return (found != NULL) ? found->addr : -1;
+}
+
+
+// Value of a number or label operand
+static const char *operandValue(const LC3_AsmLabels *labels, const char *str, int32_t *value) {
+    if (parseNumber(str, value)) {
+        return NULL;
+    } else if (!isLabel(str)) {
+        return "invalid operand";
+    } else if (((*value) = findLabel(labels, str)) < 0) {
+        return "undefined label";
+    }
+
+    return NULL;
+}
+
+
+// PC-relative offset to a label, numbers are used as offsets directly
+static const char *pcOffset(const LC3_AsmLabels *labels, const char *str, uint16_t addr, int bits, uint16_t *field) {
+    int32_t offset;
+
+    if (parseNumber(str, &offset)) {
+        ;
+    } else if (!isLabel(str)) {
+        return "invalid operand";
+    } else if ((offset = findLabel(labels, str)) < 0) {
+        return "undefined label";
+    } else {
+        offset -= addr + 1;
+    }
+
+    if (offset < -(1 << (bits - 1)) || offset >= (1 << (bits - 1))) {
+        return "label out of range";
+    }
+
+    (*field) = (uint16_t)offset & ((1 << bits) - 1);
+    return NULL;
+}
+
+
+// Signed immediate operand of the given width
+static const char *immediate(const char *str, int bits, uint16_t *field) {
+    int32_t value;
+
+    if (!parseNumber(str, &value)) {
+        return "invalid immediate";
+    } else if (value < -(1 << (bits - 1)) || value >= (1 << (bits - 1))) {
+        return "immediate out of range";
+    }
+
+    (*field) = (uint16_t)value & ((1 << bits) - 1);
+    return NULL;
+}
+
+
+// Assemble a statement of size words at addr into out
+static const char *encodeStmt(const LC3_AsmLabels *labels, const AsmStmt *st, uint16_t addr, uint16_t size, uint16_t *out) {
+    const AsmOp *op = st->op;
+    char *const *args = st->args;
+    uint16_t r1 = 0, r2 = 0, r3 = 0, field = 0;
+    const char *err = NULL;
+    int32_t value;
+
+    if (op == NULL) {
+        return NULL;
+    }
+
+    switch (op->format) {
+        case ASM_ALU:       if (!parseRegister(args[0], &r1) || !parseRegister(args[1], &r2)) {
+                                return "expected a register";
+                            } else if (parseRegister(args[2], &r3)) {
+                                out[0] = op->base | (r1 << 9) | (r2 << 6) | r3;
+                            } else if ((err = immediate(args[2], 5, &field)) == NULL) {
+                                out[0] = op->base | (r1 << 9) | (r2 << 6) | 0x20 | field;
+                            }
+                            break;
+        case ASM_NOT:       if (!parseRegister(args[0], &r1) || !parseRegister(args[1], &r2)) {
+                                return "expected a register";
+                            }
+
+                            out[0] = op->base | (r1 << 9) | (r2 << 6);
+                            break;
+        case ASM_BR:        if ((err = pcOffset(labels, args[0], addr, 9, &field)) == NULL) {
+                                out[0] = st->cond | field;
+                            }
+                            break;
+        case ASM_REG:       if (!parseRegister(args[0], &r1)) {
+                                return "expected a register";
+                            }
+
+                            out[0] = op->base | (r1 << 6);
+                            break;
+        case ASM_FIXED:     out[0] = op->base;
+                            break;
+        case ASM_JSR:       if ((err = pcOffset(labels, args[0], addr, 11, &field)) == NULL) {
+                                out[0] = op->base | field;
+                            }
+                            break;
+        case ASM_MEM:       if (!parseRegister(args[0], &r1)) {
+                                return "expected a register";
+                            } else if ((err = pcOffset(labels, args[1], addr, 9, &field)) == NULL) {
+                                out[0] = op->base | (r1 << 9) | field;
+                            }
+                            break;
+        case ASM_BASE:      if (!parseRegister(args[0], &r1) || !parseRegister(args[1], &r2)) {
+                                return "expected a register";
+                            } else if ((err = immediate(args[2], 6, &field)) == NULL) {
+                                out[0] = op->base | (r1 << 9) | (r2 << 6) | field;
+                            }
+                            break;
+        case ASM_TRAP:      if (!parseNumber(args[0], &value) || value < 0 || value > 0xFF) {
+                                return "invalid trap vector";
+                            }
+
+                            out[0] = op->base | value;
+                            break;
+        case ASM_FILL:      if ((err = operandValue(labels, args[0], &value)) == NULL && (value < INT16_MIN || value > UINT16_MAX)) {
+                                err = "value out of range";
+                            }
+
+                            out[0] = (uint16_t)value;
+                            break;
+        case ASM_BLKW:      memset(out, 0, size * sizeof(uint16_t));
+                            break;
+        case ASM_STRINGZ:   out[decodeString(args[0], out)] = 0;
+                            break;
+        default:            break;
+    }
+
+    return err;
+}
+
+
+static bool sameText(const String *a, const String *b) {
+    return (a->sz == b->sz) && memcmp(a->ptr, b->ptr, a->sz) == 0;
+}
+
+
+// Source line as shown in the memory view, trimmed and without tabs
+static String debugText(const String *line) {
+    size_t start = 0, end = line->sz;
+
+    for (; start < end && isspace((unsigned char)line->ptr[start]); start++);
+    for (; end > start && isspace((unsigned char)line->ptr[end - 1]); end--);
+
+    String ret = newString();
+    for (size_t i = start; i < end; addchar(&ret, (line->ptr[i] == '\t') ? ' ' : line->ptr[i]), i++);
+    return ret;
+}
+
+
+// Put the words of a line into memory, the source line becomes the debug string of its first word
+static void writeLine(LC3_SimInstance *sim, const LC3_AsmLine *line, const uint16_t *words) {
+    for (uint16_t i = 0; i < line->size; i++) {
+        uint16_t addr = line->addr + i;
+        sim->memory[addr].value = (int16_t)words[addr];
+        LC3_MarkDirty(sim, addr);
+
+        if (i == 0) {
+            LC3_SetDebugString(sim, addr, debugText(&line->text));
+        } else {
+            LC3_ClearDebugString(sim, addr);
+        }
+    }
+}
+
+
+// Pass one: the address and size of every line, and the labels they define
+static bool layoutLines(LC3_Assembly *as, LC3_SimInstance *sim, LC3_AsmLines *lines, LC3_AsmLabels *labels, int32_t *entry) {
+    AsmStmt st;
+    uint32_t loc = 0;
+    bool inBlock = false;
+    (*entry) = -1;
+
+    for (size_t i = 0; i < lines->sz; i++) {
+        LC3_AsmLine *line = &lines->ptr[i];
+        const char *err = parseStmt(&st, &line->text);
+        int32_t orig;
+
+        if (err == NULL) {
+            err = stmtSize(&st, &line->size);
+        }
+
+        if (err == NULL && st.op != NULL && st.op->format == ASM_ORIG) {
+            if (inBlock) {
+                err = "missing .END before .ORIG";
+            } else if (!parseNumber(st.args[0], &orig) || orig < 0 || orig > UINT16_MAX) {
+                err = "invalid .ORIG address";
+            } else {
+                loc = orig;
+                inBlock = true;
+                (*entry) = ((*entry) < 0) ? orig : (*entry);
+            }
+        } else if (err == NULL && st.op != NULL && st.op->format == ASM_END) {
+            inBlock = false;
+        } else if (err == NULL && (st.op != NULL || st.label != NULL) && !inBlock) {
+            err = "outside of .ORIG block";
+        } else if (err == NULL && loc + line->size > LC3_MEM_SIZE) {
+            err = "does not fit in memory";
+        }
+
+        if (err != NULL) {
+            asmError(as, sim, i, "%s", err);
+            return false;
+        }
+
+        line->addr = (uint16_t)loc;
+        loc += line->size;
+
+        if (st.label != NULL) {
+            LC3_AsmLabel label = {copyText(st.label, strlen(st.label)), line->addr};
+            addAsmLabel(labels, label);
+        }
+    }
+
+    qsort(labels->ptr, labels->sz, sizeof(LC3_AsmLabel), compareLabels);
+
+    for (size_t i = 1; i < labels->sz; i++) {
+        if (strcmp(labels->ptr[i - 1].name.ptr, labels->ptr[i].name.ptr) == 0) {
+            snprintf(as->error, sizeof(as->error), "duplicate label %s", labels->ptr[i].name.ptr);
+            sim->error = as->error;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+// Pass two: assemble every line into words, indexed by address
+static bool encodeLines(LC3_Assembly *as, LC3_SimInstance *sim, const LC3_AsmLines *lines, const LC3_AsmLabels *labels, uint16_t *words) {
+    bool *used = lc_malloc(LC3_MEM_SIZE * sizeof(bool));
+    const char *err = NULL;
+    AsmStmt st;
+    size_t i = 0;
+
+    memset(used, 0, LC3_MEM_SIZE * sizeof(bool));
+
+    for (; i < lines->sz && err == NULL; i++) {
+        const LC3_AsmLine *line = &lines->ptr[i];
+
+        if (line->size == 0) {
+            continue;
+        }
+
+        for (uint32_t j = line->addr; j < (uint32_t)line->addr + line->size && err == NULL; j++) {
+            err = used[j] ? "overlaps an earlier line" : NULL;
+            used[j] = true;
+        }
+
+        if (err == NULL && (err = parseStmt(&st, &line->text)) == NULL) {
+            err = encodeStmt(labels, &st, line->addr, line->size, words + line->addr);
+        }
+    }
+
+    if (err != NULL) {
+        asmError(as, sim, i - 1, "%s", err);
+    }
+
+    lc_free(used);
+    return (err == NULL);
+}
+
+
+// Keep breakpoints on the same source lines
+// Lines are matched up by the unchanged start and end of the file, changed lines in between keep their line number
+static void mapBreakpoints(const LC3_SimInstance *sim, const LC3_AsmLines *old, const LC3_AsmLines *lines, bool *breakpoints) {
+    size_t prefix = 0, suffix = 0;
+
+    for (; prefix < old->sz && prefix < lines->sz && sameText(&old->ptr[prefix].text, &lines->ptr[prefix].text); prefix++);
+    for (; suffix < old->sz - prefix && suffix < lines->sz - prefix &&
+           sameText(&old->ptr[old->sz - suffix - 1].text, &lines->ptr[lines->sz - suffix - 1].text); suffix++);
+
+    for (size_t i = 0; i < old->sz; i++) {
+        if (old->ptr[i].size == 0 || !sim->memory[old->ptr[i].addr].breakpoint) {
+            continue;
+        }
+
+        size_t j = (i >= old->sz - suffix) ? i + lines->sz - old->sz : i;
+
+        if (j < lines->sz) {
+            breakpoints[j] = true;
+        }
+    }
+}
+
+
+// Remove the words, debug strings, breakpoints and labels of the previous run
+static void removeProgram(LC3_Assembly *as, LC3_SimInstance *sim) {
+    for (size_t i = 0; i < as->lines.sz; i++) {
+        for (uint16_t j = 0; j < as->lines.ptr[i].size; j++) {
+            uint16_t addr = as->lines.ptr[i].addr + j;
+            sim->memory[addr].value = 0;
+            LC3_SetBreakpoint(sim, addr, false);
+            LC3_ClearDebugString(sim, addr);
+            LC3_MarkDirty(sim, addr);
+        }
+    }
+
+    for (size_t i = 0; i < as->labels.sz; i++) {
+        LC3_RemoveSymbol(sim, as->labels.ptr[i].addr, as->labels.ptr[i].name.ptr);
+    }
+}
+
+
+// Assemble every line, replacing the previous run if it was the same file
+// On success, the lines are swapped with those of the previous run
+static int32_t assembleLines(LC3_Assembly *as, LC3_SimInstance *sim, LC3_AsmLines *lines, bool replace) {
+    LC3_AsmLabels labels = newAsmLabels();
+    uint16_t *words = lc_malloc(LC3_MEM_SIZE * sizeof(uint16_t));
+    int32_t entry;
+
+    if (!layoutLines(as, sim, lines, &labels, &entry) || !encodeLines(as, sim, lines, &labels, words)) {
+        freeAsmLabels(labels);
+        lc_free(words);
+        return -1;
+    }
+
+    bool *breakpoints = lc_malloc(lines->sz + 1);
+    memset(breakpoints, 0, lines->sz + 1);
+
+    if (replace) {
+        mapBreakpoints(sim, &as->lines, lines, breakpoints);
+        removeProgram(as, sim);
+    }
+
+    for (size_t i = 0; i < lines->sz; i++) {
+        writeLine(sim, &lines->ptr[i], words);
+
+        if (breakpoints[i] && lines->ptr[i].size > 0) {
+            LC3_SetBreakpoint(sim, lines->ptr[i].addr, true);
+        }
+    }
+
+    for (size_t i = 0; i < labels.sz; i++) {
+        LC3_AddSymbol(sim, labels.ptr[i].addr, labels.ptr[i].name.ptr);
+    }
+
+    if (entry >= 0) {
+        sim->reg.PC = entry;
+    }
+
+    LC3_AsmLines swap = as->lines;
+    as->lines = (*lines);
+    (*lines) = swap;
+
+    freeAsmLabels(as->labels);
+    as->labels = labels;
+
+    lc_free(breakpoints);
+    lc_free(words);
+    return as->lines.sz;
+}
+
+
+// Re-assemble only the changed lines in place
+// Returns the amount of changed lines, or -1 if a line changed size or labels or does not assemble
+static int32_t patchLines(LC3_Assembly *as, LC3_SimInstance *sim, LC3_AsmLines *lines) {
+    if (lines->sz != as->lines.sz) {
+        return -1;
+    }
+
+    uint16_t *words = lc_malloc(LC3_MEM_SIZE * sizeof(uint16_t));
+    int32_t changed = 0;
+    AsmStmt old, cur;
+
+    for (size_t i = 0; i < lines->sz && changed >= 0; i++) {
+        const LC3_AsmLine *line = &as->lines.ptr[i];
+        uint16_t size;
+
+        if (sameText(&line->text, &lines->ptr[i].text)) {
+            continue;
+        }
+
+        if (parseStmt(&old, &line->text) != NULL || parseStmt(&cur, &lines->ptr[i].text) != NULL || stmtSize(&cur, &size) != NULL) {
+            changed = -1;
+        } else if (size != line->size || (old.label == NULL) != (cur.label == NULL) || (old.label && strcmp(old.label, cur.label) != 0)) {
+            changed = -1;
+        } else if ((old.op && (old.op->format == ASM_ORIG || old.op->format == ASM_END)) || (cur.op && (cur.op->format == ASM_ORIG || cur.op->format == ASM_END))) {
+            changed = -1;
+        } else if (encodeStmt(&as->labels, &cur, line->addr, size, words + line->addr) != NULL) {
+            changed = -1;
+        } else {
+            changed++;
+        }
+    }
+
+    for (size_t i = 0; i < lines->sz && changed > 0; i++) {
+        LC3_AsmLine *line = &as->lines.ptr[i];
+
+        if (!sameText(&line->text, &lines->ptr[i].text)) {
+            String swap = line->text;
+            line->text = lines->ptr[i].text;
+            lines->ptr[i].text = swap;
+            writeLine(sim, line, words);
+        }
+    }
+
+    lc_free(words);
+    return changed;
+}
+
+
+int32_t LC3_Assemble(LC3_Assembly *as, LC3_SimInstance *sim, const char *filename) {
+    size_t size = 0;
+    const uint8_t *data = mapFile(filename, &size);
+
+    if (data == NULL) {
+        sim->error = "failed to read file";
+        return -1;
+    }
+
+    LC3_AsmLines lines = splitLines((const char *)data, size);
+    unmapFile(data, size);
+
+    bool same = (as->filename.sz > 0) && strcmp(as->filename.ptr, filename) == 0;
+    int32_t ret = same ? patchLines(as, sim, &lines) : -1;
+    as->patched = (ret >= 0);
+
+    if (ret < 0) {
+        ret = assembleLines(as, sim, &lines, same);
+    }
+
+    if (ret >= 0 && !same) {
+        clearString(&as->filename);
+        for (; *filename; addchar(&as->filename, *filename), filename++);
+    }
+
+    freeAsmLines(lines);
+    return ret;
+}
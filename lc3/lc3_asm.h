@@ -0,0 +1,55 @@
+#pragma once
+#include "lc3_sim.h"
+
+// Longest source line that can be assembled
+#define LC3_ASM_LINE_MAX (1024)
+
+
+// Source line of the last assembled file
+typedef struct LC3_AsmLine {
+    String text;                    // Source text, without line ending
+    uint16_t addr;                  // Address of the first word assembled from this line
+    uint16_t size;                  // Amount of words assembled from this line
+} LC3_AsmLine;
+
+vaTypedef(LC3_AsmLine, LC3_AsmLines);
+
+
+// Label defined in the last assembled file
+typedef struct LC3_AsmLabel {
+    String name;                    // Label name
+    uint16_t addr;                  // Address it refers to
+} LC3_AsmLabel;
+
+// List of labels, sorted by name
+vaTypedef(LC3_AsmLabel, LC3_AsmLabels);
+
+
+// Assembler state, kept between runs so changed files can be patched into memory
+typedef struct LC3_Assembly {
+    String filename;                // File assembled last, empty before the first run
+    LC3_AsmLines lines;             // Lines of that file
+    LC3_AsmLabels labels;           // Labels of that file
+    bool patched;                   // Whether the last run only patched changed lines
+    char error[128];                // Message of the last error, sim->error points here
+} LC3_Assembly;
+
+
+/*
+ * Allocate assembler state
+ * Should be deallocated using LC3_DestroyAssembly
+ */
+LC3_Assembly *LC3_CreateAssembly();
+
+/*
+ * Deallocate assembler state
+ */
+void LC3_DestroyAssembly(LC3_Assembly *as);
+
+/*
+ * Assemble a source file straight into simulator memory, with the source lines as debug strings and labels as symbols
+ * If the file was assembled last and no line changed size or labels, only the changed lines are re-assembled in place
+ * Otherwise, the words and labels of the previous run are removed first and breakpoints follow their source lines
+ * Returns the amount of assembled lines, or -1 with sim->error set, in which case memory is left untouched
+ */
+int32_t LC3_Assemble(LC3_Assembly *as, LC3_SimInstance *sim, const char *filename);
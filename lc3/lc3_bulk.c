@@ -0,0 +1,208 @@
+#include "lc3_bulk.h"
+#include <ctype.h>
+
+// Words per line of exported hex files
+#define HEX_PER_LINE (8)
+
+
+LC3_DataFormat LC3_ParseDataFormat(const char *name) {
+    static const char *const names[] = {"be", "le", "hex", "bin"};
+
+    for (int i = 0; i < LC3_DATA_UNKNOWN; i++) {
+        if (strcmp(name, names[i]) == 0) {
+            return (LC3_DataFormat)i;
+        }
+    }
+
+    return LC3_DATA_UNKNOWN;
+}
+
+
+LC3_DataFormat LC3_GuessDataFormat(const char *filename) {
+    const char *ext = strrchr(filename, '.');
+
+    if (ext != NULL && strcmp(ext, ".bin") == 0) {
+        return LC3_DATA_BIN;
+    } else if (ext != NULL && (strcmp(ext, ".hex") == 0 || strcmp(ext, ".txt") == 0)) {
+        return LC3_DATA_HEX;
+    }
+
+    return LC3_DATA_BE;
+}
+
+
+// Parse a single hex word, with an optional x or 0x prefix
+static bool parseHexWord(const char *str, size_t len, uint16_t *word) {
+    if (len > 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
+        str += 2;
+        len -= 2;
+    } else if (len > 1 && (str[0] == 'x' || str[0] == 'X')) {
+        str++;
+        len--;
+    }
+
+    if (len == 0 || len > 4) {
+        return false;
+    }
+
+    (*word) = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        if (!isxdigit((unsigned char)str[i])) {
+            return false;
+        }
+
+        int digit = isdigit((unsigned char)str[i]) ? (str[i] - '0') : (tolower((unsigned char)str[i]) - 'a' + 10);
+        (*word) = (uint16_t)(((*word) << 4) | digit);
+    }
+
+    return true;
+}
+
+
+// Parse hex words separated by whitespace or commas, returns the amount of words or -1
+static int32_t parseHex(LC3_SimInstance *sim, const char *text, size_t size, uint16_t *words) {
+    int32_t n = 0;
+
+    for (size_t i = 0; i < size;) {
+        if (text[i] == ';') {
+            for (; i < size && text[i] != '\n'; i++);
+        } else if (isspace((unsigned char)text[i]) || text[i] == ',') {
+            i++;
+        } else {
+            size_t start = i;
+            for (; i < size && !isspace((unsigned char)text[i]) && text[i] != ',' && text[i] != ';'; i++);
+
+            if (n >= LC3_MEM_SIZE) {
+                sim->error = "data does not fit in memory";
+                return -1;
+            }
+
+            if (!parseHexWord(text + start, i - start, &words[n++])) {
+                sim->error = "invalid hex word";
+                return -1;
+            }
+        }
+    }
+
+    return n;
+}
+
+
+// Parse lines of 16 binary digits, spaces within a line are ignored, returns the amount of words or -1
+static int32_t parseBin(LC3_SimInstance *sim, const char *text, size_t size, uint16_t *words) {
+    int32_t n = 0;
+
+    for (size_t i = 0; i < size; i++) {
+        uint16_t word = 0;
+        int digits = 0;
+
+        for (; i < size && text[i] != '\n' && text[i] != ';'; i++) {
+            if (text[i] == '0' || text[i] == '1') {
+                word = (uint16_t)((word << 1) | (text[i] - '0'));
+                digits++;
+            } else if (!isspace((unsigned char)text[i])) {
+                digits = -1;
+                break;
+            }
+        }
+
+        for (; i < size && text[i] != '\n'; i++);
+
+        if (digits == 0) {
+            continue;
+        } else if (digits != 16) {
+            sim->error = "lines should contain 16 binary digits";
+            return -1;
+        } else if (n >= LC3_MEM_SIZE) {
+            sim->error = "data does not fit in memory";
+            return -1;
+        }
+
+        words[n++] = word;
+    }
+
+    return n;
+}
+
+
+int32_t LC3_ImportMemory(LC3_SimInstance *sim, const char *filename, uint16_t addr, LC3_DataFormat fmt) {
+    size_t size = 0;
+    const uint8_t *data = mapFile(filename, &size);
+    int32_t n = -1;
+
+    if (data == NULL) {
+        sim->error = "failed to read file";
+        return -1;
+    }
+
+    uint16_t *words = lc_malloc(LC3_MEM_SIZE * sizeof(uint16_t));
+
+    switch (fmt) {
+        case LC3_DATA_BE:
+        case LC3_DATA_LE:   if (size % 2 != 0) {
+                                sim->error = "file size is not a whole number of words";
+                            } else if (size / 2 > LC3_MEM_SIZE) {
+                                sim->error = "data does not fit in memory";
+                            } else {
+                                n = size / 2;
+                                convertWords(words, data, n, fmt == LC3_DATA_BE);
+                            }
+                            break;
+        case LC3_DATA_HEX:  n = parseHex(sim, (const char *)data, size, words);
+                            break;
+        case LC3_DATA_BIN:  n = parseBin(sim, (const char *)data, size, words);
+                            break;
+        default:            sim->error = "unknown format";
+                            break;
+    }
+
+    if (n >= 0 && (int32_t)addr + n > LC3_MEM_SIZE) {
+        sim->error = "data does not fit in memory";
+        n = -1;
+    }
+
+    for (int32_t i = 0; i < n; i++) {
+        sim->memory[addr + i].value = (int16_t)words[i];
+        LC3_MarkDirty(sim, addr + i);
+    }
+
+    unmapFile(data, size);
+    lc_free(words);
+    return n;
+}
+
+
+int LC3_ExportMemory(const LC3_SimInstance *sim, const char *filename, uint16_t addr, uint32_t len, LC3_DataFormat fmt) {
+    FILE *fp = fopen(filename, "wb");
+
+    if (fp == NULL || len > LC3_MEM_SIZE || fmt == LC3_DATA_UNKNOWN) {
+        if (fp) fclose(fp);
+        return 1;
+    }
+
+    uint16_t *words = lc_malloc(LC3_MEM_SIZE * sizeof(uint16_t));
+
+    for (uint32_t i = 0; i < len; i++) {
+        words[i] = (uint16_t)sim->memory[(uint16_t)(addr + i)].value;
+    }
+
+    if (fmt == LC3_DATA_BE || fmt == LC3_DATA_LE) {
+        convertWords(words, words, len, fmt == LC3_DATA_BE);
+        fwrite(words, sizeof(uint16_t), len, fp);
+    } else if (fmt == LC3_DATA_HEX) {
+        for (uint32_t i = 0; i < len; i++) {
+            fprintf(fp, "%04X%c", words[i], ((i + 1) % HEX_PER_LINE == 0 || i + 1 == len) ? '\n' : ' ');
+        }
+    } else {
+        for (uint32_t i = 0; i < len; i++) {
+            for (int bit = 15; bit >= 0; fputc('0' + ((words[i] >> bit) & 1), fp), bit--);
+            fputc('\n', fp);
+        }
+    }
+
+    lc_free(words);
+    int ret = ferror(fp);
+    ret |= fclose(fp) != 0;
+    return ret;
+}
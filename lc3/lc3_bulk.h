@@ -0,0 +1,35 @@
+#pragma once
+#include "lc3_sim.h"
+
+
+// File formats for memory import and export
+typedef enum LC3_DataFormat {
+    LC3_DATA_BE,                    // Raw 16-bit words, big-endian (like .obj files)
+    LC3_DATA_LE,                    // Raw 16-bit words, little-endian
+    LC3_DATA_HEX,                   // Hexadecimal words separated by whitespace or commas, ; starts a comment
+    LC3_DATA_BIN,                   // One word of 16 binary digits per line (.bin), ; starts a comment
+    LC3_DATA_UNKNOWN,               // Not a format, returned when a name is not recognised
+} LC3_DataFormat;
+
+
+/*
+ * Get the format called name (be, le, hex or bin)
+ */
+LC3_DataFormat LC3_ParseDataFormat(const char *name);
+
+/*
+ * Guess the format of a file from its extension: .bin is bin, .hex and .txt are hex, everything else be
+ */
+LC3_DataFormat LC3_GuessDataFormat(const char *filename);
+
+/*
+ * Write the words in a file to memory, starting at addr
+ * Returns the amount of words written, or -1 with sim->error set if the file could not be read or does not fit
+ */
+int32_t LC3_ImportMemory(LC3_SimInstance *sim, const char *filename, uint16_t addr, LC3_DataFormat fmt);
+
+/*
+ * Write len words of memory starting at addr to a file, wrapping around the end of memory
+ * Returns 0 on success
+ */
+int LC3_ExportMemory(const LC3_SimInstance *sim, const char *filename, uint16_t addr, uint32_t len, LC3_DataFormat fmt);
@@ -0,0 +1,200 @@
+#include "lc3_checkpoint.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "lc3_snap.h"
+
+
+static double secondsSince(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+
+// Flush a file (or directory) to disk
+static int syncPath(const char *path) {
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        return 1;
+    }
+
+    int ret = fsync(fd);
+    close(fd);
+    return ret != 0;
+}
+
+
+// Serialise copy to a temporary file, sync it and move it over the destination
+static int writeCheckpoint(LC3_SimInstance *copy, const char *filename) {
+    size_t len = strlen(filename);
+    char *tmp = lc_malloc(len + 5);
+    memcpy(tmp, filename, len);
+    memcpy(tmp + len, ".tmp", 5);
+
+    int ret = LC3_SaveSnapshot(copy, tmp, NULL) || syncPath(tmp) || rename(tmp, filename) != 0;
+
+    if (ret == 0) {
+        // Make the rename itself durable
+        const char *slash = strrchr(filename, '/');
+
+        if (slash == NULL) {
+            syncPath(".");
+        } else {
+            tmp[slash - filename + (slash == filename)] = '\0';
+            syncPath(tmp);
+        }
+    } else {
+        unlink(tmp);
+    }
+
+    lc_free(tmp);
+    return ret;
+}
+
+
+static void *writerThread(void *arg) {
+    LC3_Checkpointer *cp = arg;
+    pthread_mutex_lock(&cp->lock);
+
+    while (true) {
+        while (!cp->quit && !cp->busy) {
+            pthread_cond_wait(&cp->cond, &cp->lock);
+        }
+
+        if (!cp->busy) {
+            break;
+        }
+
+        // The copy is not touched by anyone else while busy
+        pthread_mutex_unlock(&cp->lock);
+        int result = writeCheckpoint(&cp->copy.state, cp->filename);
+        pthread_mutex_lock(&cp->lock);
+
+        cp->result = result;
+        cp->busy = false;
+        pthread_cond_broadcast(&cp->cond);
+    }
+
+    pthread_mutex_unlock(&cp->lock);
+    return NULL;
+}
+
+
+LC3_Checkpointer *LC3_CreateCheckpointer(void) {
+    LC3_Checkpointer *cp = lc_calloc(1, sizeof(LC3_Checkpointer));
+    cp->copy = LC3_CreateImage();
+
+    pthread_mutex_init(&cp->lock, NULL);
+    pthread_cond_init(&cp->cond, NULL);
+    cp->threaded = pthread_create(&cp->thread, NULL, writerThread, cp) == 0;
+    return cp;
+}
+
+
+void LC3_DestroyCheckpointer(LC3_Checkpointer *cp) {
+    if (cp == NULL) {
+        return;
+    }
+
+    // Any job that is still running finishes first
+    pthread_mutex_lock(&cp->lock);
+    cp->quit = true;
+    pthread_cond_broadcast(&cp->cond);
+    pthread_mutex_unlock(&cp->lock);
+
+    if (cp->threaded) {
+        pthread_join(cp->thread, NULL);
+    }
+
+    pthread_mutex_destroy(&cp->lock);
+    pthread_cond_destroy(&cp->cond);
+    LC3_DestroyImage(cp->copy);
+
+    if (cp->filename) {
+        lc_free(cp->filename);
+    }
+
+    if (cp->autoFile) {
+        lc_free(cp->autoFile);
+    }
+
+    lc_free(cp);
+}
+
+
+int LC3_Checkpoint(LC3_Checkpointer *cp, LC3_SimInstance *sim, const char *filename, bool wait) {
+    pthread_mutex_lock(&cp->lock);
+
+    while (wait && cp->busy) {
+        pthread_cond_wait(&cp->cond, &cp->lock);
+    }
+
+    if (cp->busy) {
+        pthread_mutex_unlock(&cp->lock);
+        return 1;
+    }
+
+    // Pages that were not modified since the previous copy are still up to date
+    LC3_CaptureImage(&cp->copy, sim);
+
+    if (cp->filename) {
+        lc_free(cp->filename);
+    }
+
+    cp->filename = copyCString(filename);
+
+    // Without a writer thread the job is done right away, its result is still picked up later
+    if (!cp->threaded) {
+        cp->result = writeCheckpoint(&cp->copy.state, cp->filename);
+    } else {
+        cp->busy = true;
+        pthread_cond_broadcast(&cp->cond);
+    }
+
+    pthread_mutex_unlock(&cp->lock);
+    return 0;
+}
+
+
+void LC3_SetAutoCheckpoint(LC3_Checkpointer *cp, LC3_SimInstance *sim, const char *filename, size_t steps, double seconds) {
+    if (cp->autoFile) {
+        lc_free(cp->autoFile);
+    }
+
+    cp->autoFile     = filename ? copyCString(filename) : NULL;
+    cp->everySteps   = steps;
+    cp->everySeconds = seconds;
+    cp->lastCounter  = sim->counter;
+    clock_gettime(CLOCK_MONOTONIC, &cp->lastTime);
+}
+
+
+void LC3_CheckpointTick(LC3_Checkpointer *cp, LC3_SimInstance *sim) {
+    if (cp == NULL || cp->autoFile == NULL) {
+        return;
+    }
+
+    bool due = (cp->everySteps > 0 && sim->counter - cp->lastCounter >= cp->everySteps);
+    due = due || (cp->everySeconds > 0 && secondsSince(cp->lastTime) >= cp->everySeconds);
+
+    // If the previous checkpoint is still being written, try again on the next tick
+    if (due && LC3_Checkpoint(cp, sim, cp->autoFile, false) == 0) {
+        cp->lastCounter = sim->counter;
+        clock_gettime(CLOCK_MONOTONIC, &cp->lastTime);
+    }
+}
+
+
+int LC3_CheckpointResult(LC3_Checkpointer *cp) {
+    if (cp == NULL) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&cp->lock);
+    int ret = cp->result;
+    cp->result = 0;
+    pthread_mutex_unlock(&cp->lock);
+    return ret;
+}
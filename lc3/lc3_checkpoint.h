@@ -0,0 +1,61 @@
+#pragma once
+#include <pthread.h>
+#include <time.h>
+#include "lc3_sim.h"
+
+
+// Background checkpoint writer
+typedef struct LC3_Checkpointer {
+    pthread_t thread;               // Writer thread
+    bool threaded;                  // Whether the writer thread started, jobs are written by the caller otherwise
+    pthread_mutex_t lock;           // Protects everything below, except copy while busy
+    pthread_cond_t cond;            // Signals new jobs and finished jobs
+    LC3_SimImage copy;              // Copy of the simulator, taken at an instruction boundary
+    bool busy;                      // Whether the writer thread is serialising copy
+    bool quit;                      // Tells the writer thread to exit
+    char *filename;                 // Destination of the current job
+    int result;                     // Result of the last finished job (0 on success)
+    char *autoFile;                 // Destination for automatic checkpoints, NULL if disabled
+    size_t everySteps;              // Automatic checkpoint interval in instructions (0 if unused)
+    double everySeconds;            // Automatic checkpoint interval in seconds (0 if unused)
+    size_t lastCounter;             // Instruction counter at the last automatic checkpoint
+    struct timespec lastTime;       // Time of the last automatic checkpoint
+} LC3_Checkpointer;
+
+
+/*
+ * Allocate a checkpointer and start its writer thread
+ * If the thread cannot be started, checkpoints are written before LC3_Checkpoint returns
+ * Should be destroyed with LC3_DestroyCheckpointer
+ */
+LC3_Checkpointer *LC3_CreateCheckpointer(void);
+
+/*
+ * Wait for any running job, stop the writer thread and deallocate the checkpointer
+ */
+void LC3_DestroyCheckpointer(LC3_Checkpointer *cp);
+
+/*
+ * Copy the simulator state and write it to filename on the writer thread
+ * Must be called at an instruction boundary, only memory pages changed since the previous copy are copied
+ * The file is written to a temporary file, synced and then renamed, so filename is never left half-written
+ * If the previous checkpoint is still being written, waits for it if wait is true, otherwise returns 1 and does nothing
+ */
+int LC3_Checkpoint(LC3_Checkpointer *cp, LC3_SimInstance *sim, const char *filename, bool wait);
+
+/*
+ * Configure automatic checkpoints to filename, every steps instructions or seconds seconds
+ * Passing NULL as filename disables automatic checkpoints
+ */
+void LC3_SetAutoCheckpoint(LC3_Checkpointer *cp, LC3_SimInstance *sim, const char *filename, size_t steps, double seconds);
+
+/*
+ * Take an automatic checkpoint if the configured interval passed
+ * Should be called regularly at instruction boundaries while the simulator runs, cp may be NULL
+ */
+void LC3_CheckpointTick(LC3_Checkpointer *cp, LC3_SimInstance *sim);
+
+/*
+ * Get the result of the last finished checkpoint (0 on success) and reset it to 0, cp may be NULL
+ */
+int LC3_CheckpointResult(LC3_Checkpointer *cp);
@@ -1,5 +1,7 @@
 #include "lc3_cmd.h"
 #include <ctype.h>
+#include <stdarg.h>
+#include <unistd.h>
 #include "lib/leakcheck/lc.h"
 #include "cmd/cmd_util.h"
 
@@ -99,7 +101,7 @@ OptInt getNumber(const char *str) {
 
 
 // Get register value from register string
-OptInt parseRegister(LC3_SimInstance *sim, const char *str) {
+static OptInt registerValue(const LC3_Registers *reg, const char *str) {
     OptInt ret = {0, false};
     int len = strlen(str);
 
@@ -108,10 +110,10 @@ OptInt parseRegister(LC3_SimInstance *sim, const char *str) {
     }
 
     if (toupper(str[0]) == 'R' && str[1] < '8' && str[1] >= '0') {
-        ret.value = sim->reg.reg[str[1] - '0'];
+        ret.value = reg->reg[str[1] - '0'];
         ret.set = true;
     } else if (toupper(str[0]) == 'P' && toupper(str[1]) == 'C') {
-        ret.value = sim->reg.PC;
+        ret.value = reg->PC;
         ret.set = true;
     }
 
@@ -119,7 +121,20 @@ OptInt parseRegister(LC3_SimInstance *sim, const char *str) {
 }
 
 
-// Get value from variable string (either number or register)
+OptInt parseRegister(LC3_SimInstance *sim, const char *str) {
+    return registerValue(&sim->reg, str);
+}
+
+
+// Get address of a label
+static OptInt symbolValue(LC3_SimInstance *sim, const char *str) {
+    int32_t addr = LC3_FindSymbol(sim, str);
+    OptInt ret = {addr, addr >= 0};
+    return ret;
+}
+
+
+// Get value from variable string (either number, register or label)
 OptInt parseVariable(LC3_SimInstance *sim, const char *var) {
     // Check if it's a number
     OptInt n = getNumber(var);
@@ -127,10 +142,22 @@ OptInt parseVariable(LC3_SimInstance *sim, const char *var) {
     // Check for register
     n = n.set ? n : parseRegister(sim, var);
 
+    // Check for label
+    n = n.set ? n : symbolValue(sim, var);
+
     return n;
 }
 
 
+// Like parseVariable, but registers are read from the displayed view while the simulation worker runs
+// Symbols are only changed while the worker is paused, so they can be read directly
+OptInt parseLiveVariable(LC3_TermInterface *tui, LC3_SimInstance *sim, const char *var) {
+    OptInt n = getNumber(var);
+    n = n.set ? n : registerValue(tui->worker ? &tui->view->reg : &sim->reg, var);
+    return n.set ? n : symbolValue(sim, var);
+}
+
+
 // Turn n into a set OptInt
 OptInt fromInt(int n) {
     OptInt ret = {n, true};
@@ -138,6 +165,20 @@ OptInt fromInt(int n) {
 }
 
 
+// Append a formatted line to a listing (see LC3_ShowListing)
+void addLine(StringArray *lines, const char *fmt, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+
+    String line = newString();
+    for (const char *c = buf; *c; addchar(&line, *c), c++);
+    addString(lines, line);
+}
+
+
 // Check if n is in a certain range
 bool inRange(int n, int min, int max) {
     return ((n >= min) && (n <= max));
@@ -145,6 +186,7 @@ bool inRange(int n, int min, int max) {
 
 
 #include "cmd/cmd_read.c"
+#include "cmd/cmd_asm.c"
 #include "cmd/cmd_breakpoint.c"
 #include "cmd/cmd_set.c"
 #include "cmd/cmd_reg.c"
@@ -165,28 +207,48 @@ bool inRange(int n, int min, int max) {
 #include "cmd/cmd_help.c"
 #include "cmd/cmd_save.c"
 #include "cmd/cmd_load.c"
+#include "cmd/cmd_checkpoint.c"
+#include "cmd/cmd_trace.c"
+#include "cmd/cmd_record.c"
+#include "cmd/cmd_coverage.c"
+#include "cmd/cmd_disassemble.c"
+#include "cmd/cmd_memory.c"
+#include "cmd/cmd_find.c"
+#include "cmd/cmd_snap.c"
+#include "cmd/cmd_diff.c"
+#include "cmd/cmd_import.c"
+#include "cmd/cmd_script.c"
 
 
 static const LC3_Command CMD_MAP[] = {
     // Help and quitting
     {"help",        NULL,   showHelpInfo,       "help                    | Show this message"},
     {"quit",        "q",    quitTUI,            "q[uit]                  | Quit this program"},
+    {"script",      "sc",   runScript,          "sc[ript] FILE           | Run the commands in FILE, one per line"},
 
     // Device state
     {"set",         "s",    setMemoryValue,     "s[et] [N1] N2           | Sets address N1 (PC assumed) to N2"},
     {"reg",         "r",    setRegister,        "r[eg] R [N]             | Sets register R to value N, or show R as 4-digit hex if N is not provided"},
-    {"read",        "rd",   loadExecutable,     "r[ea]d FILE             | Read .lc3 file into memory"},
-    {"restart",     NULL,   restartDevice,      "restart                 | Clear simulator"},
+    {"read",        "rd",   loadExecutable,     "r[ea]d FILE             | Read .lc3 or .obj file into memory, with the .sym and .lst next to a textbook .obj"},
+    {"asm",         NULL,   assembleFile,       "asm FILE                | Assemble FILE into memory, running it again only patches changed lines"},
+    {"restart",     NULL,   restartDevice,      "restart [--keep-image]  | Clear simulator, or reset it to the state right after the last read"},
 
     // Simulation control/display
     {"go",          "g",    goToCell,           "g[o] [N]                | Scroll memory view N (PC assumed)"},
-    {"breakpoint",  "bp",   breakpoint,         "b[reak]p[point] N ...   | Sets breakpoint at provided locations (PC assumed)"},
+    {"find",        "f",    findPattern,        "f[ind] PATTERN          | Find words N, masked words N/MASK, any word ?, or \"strings\", in sequence; n/N jump between hits"},
+    {"mem",         NULL,   showMemory,         "mem [N1] [N2]           | Show N2 words of memory (16 assumed) starting at N1 (PC assumed)"},
+    {"dis",         NULL,   disassemble,        "dis [N1] [N2]           | Disassemble N2 instructions (16 assumed) starting at N1 (PC assumed)"},
+    {"breakpoint",  "bp",   breakpoint,         "b[reak]p[point] N ...   | Sets breakpoint at provided locations (PC assumed)", true},
     {"num",         "n",    setnumDisplay,      "n[um] [x/i/u/c]         | Set number display type (hex, int, unsigned, char), hex assumed"},
-    {"step",        "st",   makeSteps,          "st[ep] [N]              | Execute N instructions (1 assumed), or until breakpoint"},
+    {"step",        "st",   makeSteps,          "st[ep] [N]              | Execute N instructions (1 assumed), or until breakpoint", true},
     {"undo",        "u",    undoSteps,          "u[ndo] [N]              | Undo previous N instructions (1 assumed)"},
     {"run",         NULL,   startSimulation,    "run                     | Run simulator until breakpoint or halted"},
-    {"halt",        "h",    stopSimulation,     "h[alt]                  | Halt simulator"},
+    {"halt",        "h",    stopSimulation,     "h[alt]                  | Halt simulator", true},
     {"count",       "cnt",  counterCommands,    "count [get]/reset/total | Get amount of instructions executed, reset count, or get total count"},
+    {"trace",       "tr",   traceExecution,     "tr[ace] on FILE | off   | Record every executed instruction to FILE (read it with lc3trace)"},
+    {"record",      "rec",  recordInput,        "rec[ord] on FILE | off  | Record queued and read input to FILE, with the current state to replay it from"},
+    {"replay",      NULL,   replayInput,        "replay FILE             | Reset to the state in recording FILE and rerun it, queueing input at the recorded instructions"},
+    {"coverage",    "cov",  coverageCommands,   "cov[erage] [ARG]        | Show coverage totals, on/off/reset collection, or report F [L] to write listing F and lcov L (F.info assumed)"},
 
     // I/O
     {"input",       "in",   giveInput,          "in[put] ...             | Queues any characters (possibly escaped) after the delimiter for input"},
@@ -196,8 +258,13 @@ static const LC3_Command CMD_MAP[] = {
     {"clear",       NULL,   clearOutput,        "clear                   | Clear output box"},
 
     // Saving/loading
-    {"save",        "sv",   saveSimulator,      "s[a]v[e] FILE           | Save simulator state to file"},
-    {"load",        "ld",   loadSimulator,      "l[oa]d FILE             | Load simulator state from file"},
+    {"save",        "sv",   saveSimulator,      "s[a]v[e] [--delta B] F  | Save simulator state to file F, only changes since save B with --delta"},
+    {"checkpoint",  "cp",   checkpointSimulator,"c[heck]p[oint] F [N/Ns] | Save state to F in the background, every N instructions or N seconds if provided"},
+    {"load",        "ld",   loadSimulator,      "l[oa]d FILE             | Load simulator state from file (delta saves load their base first)"},
+    {"import",      "im",   importMemory,       "im[port] F N [FMT]      | Write the words in file F to memory at N, FMT is be, le, hex or bin (guessed from the extension, be otherwise)"},
+    {"export",      "ex",   exportMemory,       "ex[port] F N1 N2 [FMT]  | Write N2 words of memory at N1 to file F, in the formats of import"},
+    {"snap",        NULL,   snapSimulator,      "snap [NAME]             | Keep a copy of the simulator state in memory as NAME, or list the copies"},
+    {"diff",        NULL,   diffState,          "diff N/NAME/FILE        | Show registers and memory changed since N instructions ago, snapshot NAME or state file FILE"},
 };
 
 
@@ -207,12 +274,54 @@ const LC3_Command *getCommands(int *sz) {
 }
 
 
-// Get function from command string
-LC3_CMD_FN_PTR(getCommandFunction(const char *instr)) {
-    // Linear search
-    for (int i = 0; i < (sizeof(CMD_MAP) / sizeof(CMD_MAP[0])); i++) {
-        if (strcmp(instr, CMD_MAP[i].full) == 0 || (CMD_MAP[i].abbrev && (strcmp(instr, CMD_MAP[i].abbrev) == 0))) {
-            return CMD_MAP[i].func;
+// Slots in the command name hash table, a power of 2 well above twice the amount of commands
+#define CMD_TABLE_SIZE (256)
+
+// Characters that separate arguments
+#define CMD_DELIMITERS " ;,|"
+
+// Commands up to this length are split on the stack
+#define CMD_STACK_LEN (512)
+
+
+// FNV-1a
+static uint32_t hashName(const char *name) {
+    uint32_t hash = 2166136261u;
+
+    for (; *name; name++) {
+        hash = (hash ^ (uint8_t)*name) * 16777619u;
+    }
+
+    return hash;
+}
+
+
+static void insertCommand(const LC3_Command **table, const char *name, const LC3_Command *command) {
+    uint32_t i = hashName(name) & (CMD_TABLE_SIZE - 1);
+    for (; table[i] != NULL; i = (i + 1) & (CMD_TABLE_SIZE - 1));
+    table[i] = command;
+}
+
+
+// Get command from command string
+static const LC3_Command *findCommand(const char *instr) {
+    // Both names of every command are hashed into the table on first use
+    static const LC3_Command *table[CMD_TABLE_SIZE] = {NULL};
+    static bool filled = false;
+
+    for (size_t i = 0; !filled && i < (sizeof(CMD_MAP) / sizeof(CMD_MAP[0])); i++) {
+        insertCommand(table, CMD_MAP[i].full, &CMD_MAP[i]);
+
+        if (CMD_MAP[i].abbrev) {
+            insertCommand(table, CMD_MAP[i].abbrev, &CMD_MAP[i]);
+        }
+    }
+
+    filled = true;
+
+    for (uint32_t i = hashName(instr) & (CMD_TABLE_SIZE - 1); table[i] != NULL; i = (i + 1) & (CMD_TABLE_SIZE - 1)) {
+        if (strcmp(instr, table[i]->full) == 0 || (table[i]->abbrev && (strcmp(instr, table[i]->abbrev) == 0))) {
+            return table[i];
         }
     }
 
@@ -220,10 +329,57 @@ LC3_CMD_FN_PTR(getCommandFunction(const char *instr)) {
 }
 
 
-// List of cosnt char * for argv
-vaTypedef(const char *, ArgumentList);
-static vaAllocFunction(ArgumentList, const char *, newArgumentList, ;, ;)
-static vaAppendFunction(ArgumentList, const char *, addArgument, ;, ;)
+// Argument list functions
+static vaAllocFunction(LC3_ScriptArgs, const char *, newScriptArgs, ;, ;)
+static vaAppendFunction(LC3_ScriptArgs, const char *, addScriptArg, ;, ;)
+static vaAllocFunction(LC3_ScriptOps, LC3_ScriptOp, newScriptOps, ;, ;)
+static vaAppendFunction(LC3_ScriptOps, LC3_ScriptOp, addScriptOp, ;, ;)
+
+
+// Split a command line in place, storing its arguments in argv (which should fit strlen(line) / 2 + 1 of them)
+// Returns the amount of arguments, or -1 if the line is empty
+static int splitCommand(char *line, const LC3_Command **command, const char **argv) {
+    char *token = strtok(line, CMD_DELIMITERS);
+    int argc = 0;
+
+    if (token == NULL) {
+        return -1;
+    }
+
+    (*command) = findCommand(token);
+
+    // Special logic for commands that take the rest of the line
+    if ((*command) && ((*command)->func == giveInput || (*command)->func == findPattern)) {
+        argv[0] = strtok(NULL, "");
+        return (argv[0] != NULL);
+    }
+
+    for (; (token = strtok(NULL, CMD_DELIMITERS)); argv[argc++] = token);
+    return argc;
+}
+
+
+// Run a split command on tui
+static void dispatchCommand(LC3_TermInterface *tui, const LC3_Command *command, int argc, const char **argv) {
+    if (command == NULL) {
+        LC3_ShowMessage(tui, "unknown command", true);
+        return;
+    }
+
+    // Other commands may touch anything, so the simulator is stopped at an instruction boundary
+    bool pause = (tui->worker != NULL) && !command->live;
+
+    if (pause) {
+        LC3_PauseWorker(tui->worker);
+    }
+
+    command->func(tui, tui->sim, argc, argv);
+
+    if (pause) {
+        tui->worker->checkpoint = tui->checkpoint;
+        LC3_ResumeWorker(tui->worker);
+    }
+}
 
 
 // Execute the command in cmd on the provided tui
@@ -232,39 +388,103 @@ void LC3_ExecuteCommand(LC3_TermInterface *tui, const char *cmd) {
         return;
     }
 
-    int len = strlen(cmd) + 1;
+    // Usual commands are short enough to be split without allocating
+    size_t len = strlen(cmd) + 1;
+    char lineBuf[CMD_STACK_LEN];
+    const char *argvBuf[CMD_STACK_LEN / 2 + 1];
+    char *line = (len <= CMD_STACK_LEN) ? lineBuf : lc_malloc(len);
+    const char **argv = (len <= CMD_STACK_LEN) ? argvBuf : lc_malloc((len / 2 + 1) * sizeof(const char *));
+    const LC3_Command *command = NULL;
 
-    if (len <= 0) {
-        return;
+    memcpy(line, cmd, len);
+    int argc = splitCommand(line, &command, argv);
+
+    if (argc >= 0) {
+        dispatchCommand(tui, command, argc, argv);
     }
 
-    char *copy = lc_malloc(len);
-    memcpy(copy, cmd, len);
+    if (len > CMD_STACK_LEN) {
+        lc_free(line);
+        lc_free(argv);
+    }
+}
 
-    char *token = strtok(copy, " ;,|");
 
-    if (token == NULL) {
-        free(copy);
-        return;
+LC3_Script *LC3_CompileScript(const char *filename) {
+    LC3_Script *script = lc_malloc(sizeof(LC3_Script));
+    script->ops = newScriptOps();
+    script->args = newScriptArgs();
+    script->error[0] = '\0';
+
+    size_t size = 0;
+    const uint8_t *data = mapFile(filename, &size);
+
+    if (data == NULL && access(filename, R_OK) != 0) {
+        snprintf(script->error, sizeof(script->error), "failed to read file");
     }
 
-    LC3_CMD_FN_PTR(func) = getCommandFunction(token);
+    // Lines are split in place, in a single copy of the file
+    script->text = lc_malloc(size + 1);
+    script->text[size] = '\0';
 
-    // Special logic for input
-    if (func == giveInput) {
-        const char *arg = strtok(NULL, "");
-        func(tui, tui->sim, (arg != NULL), &arg);
-    } else if (func != NULL) {
-        // Get arguments
-        ArgumentList argv = newArgumentList();
+    if (data != NULL) {
+        memcpy(script->text, data, size);
+        unmapFile(data, size);
+    }
 
-        for (; (token = strtok(NULL, " ;,|")); addArgument(&argv, token));
+    const char **argv = lc_malloc((size / 2 + 1) * sizeof(const char *));
+    char *line = script->text;
 
-        func(tui, tui->sim, argv.sz, argv.ptr);
-        lc_free(argv.ptr);
-    } else {
-        LC3_ShowMessage(tui, "unknown command", true);
+    for (size_t lineNo = 1; script->error[0] == '\0' && line < script->text + size; lineNo++) {
+        char *end = strchr(line, '\n');
+        end = (end != NULL) ? end : script->text + size;
+        (*end) = '\0';
+
+        if (end > line && end[-1] == '\r') {
+            end[-1] = '\0';
+        }
+
+        LC3_ScriptOp op = {NULL, 0, script->args.sz};
+        int argc = splitCommand(line, &op.command, argv);
+
+        if (argc >= 0 && op.command == NULL) {
+            snprintf(script->error, sizeof(script->error), "line %zu: unknown command", lineNo);
+        } else if (argc >= 0) {
+            op.argc = argc;
+            for (int i = 0; i < argc; addScriptArg(&script->args, argv[i]), i++);
+            addScriptOp(&script->ops, op);
+        }
+
+        line = end + 1;
+    }
+
+    lc_free(argv);
+
+    if (script->error[0] != '\0') {
+        script->ops.sz = 0;
+    }
+
+    return script;
+}
+
+
+void LC3_DestroyScript(LC3_Script *script) {
+    lc_free(script->text);
+    lc_free(script->ops.ptr);
+    lc_free(script->args.ptr);
+    lc_free(script);
+}
+
+
+void LC3_RunScript(LC3_TermInterface *tui, const LC3_Script *script) {
+    // Without a worker, live commands act on the simulator directly as well
+    LC3_SimWorker *worker = tui->worker;
+    tui->worker = NULL;
+
+    for (size_t i = 0; i < script->ops.sz && tui->running; i++) {
+        const LC3_ScriptOp *op = &script->ops.ptr[i];
+        dispatchCommand(tui, op->command, op->argc, script->args.ptr + op->argv);
     }
 
-    lc_free(copy);
+    tui->worker = worker;
 }
@@ -7,3 +7,42 @@
  * Might modify tui and tui->sim
  */
 void LC3_ExecuteCommand(LC3_TermInterface *tui, const char *cmd);
+
+
+// Command of a compiled script, with its arguments already split
+typedef struct LC3_ScriptOp {
+    const struct LC3_Command *command;
+    uint32_t argc;                  // Amount of arguments
+    uint32_t argv;                  // Index of the first argument in the argument list of the script
+} LC3_ScriptOp;
+
+vaTypedef(LC3_ScriptOp, LC3_ScriptOps);
+vaTypedef(const char *, LC3_ScriptArgs);
+
+
+// File of commands, one per line, parsed once so running it does no parsing or allocation
+typedef struct LC3_Script {
+    char *text;                     // Contents of the file, split into arguments in place
+    LC3_ScriptOps ops;              // Commands in order
+    LC3_ScriptArgs args;            // Arguments of all commands, pointing into text
+    char error[128];                // Why the script could not be compiled, empty if it could
+} LC3_Script;
+
+
+/*
+ * Parse a command file, empty lines are skipped
+ * If a line has an unknown command or the file cannot be read, error is set and there are no ops
+ * Should be destroyed using LC3_DestroyScript
+ */
+LC3_Script *LC3_CompileScript(const char *filename);
+
+/*
+ * Deallocate a compiled script
+ */
+void LC3_DestroyScript(LC3_Script *script);
+
+/*
+ * Run the commands of a compiled script on tui, until they are done or one of them quits
+ * The simulation worker should be paused, commands act on the simulator directly
+ */
+void LC3_RunScript(LC3_TermInterface *tui, const LC3_Script *script);
@@ -0,0 +1,110 @@
+#include "lc3_cover.h"
+#include <ctype.h>
+
+
+LC3_Coverage *LC3_CreateCoverage(void) {
+    return lc_calloc(1, sizeof(LC3_Coverage));
+}
+
+
+// Check whether the source line contains code, a label may come before the mnemonic
+static bool isInstructionLine(const char *text) {
+    for (int token = 0; token < 2; token++) {
+        for (; isspace((unsigned char)*text); text++);
+
+        if (*text == '\0' || *text == ';') {
+            return token > 0;
+        } else if (*text == '.') {
+            return false;
+        }
+
+        for (; *text && !isspace((unsigned char)*text); text++);
+    }
+
+    return true;
+}
+
+
+// Get the debug string of addr if it is an instruction line, NULL otherwise
+static const char *instructionLine(const LC3_SimInstance *sim, int addr) {
+    if (!sim->memory[addr].hasDebug) {
+        return NULL;
+    }
+
+    const char *text = sim->debug.ptr[sim->memory[addr].debugIndex].ptr;
+    return isInstructionLine(text) ? text : NULL;
+}
+
+
+LC3_CoverageSummary LC3_SummarizeCoverage(const LC3_Coverage *cov, const LC3_SimInstance *sim) {
+    LC3_CoverageSummary ret = {0};
+
+    for (int i = 0; i < LC3_MEM_SIZE; i++) {
+        if (instructionLine(sim, i) == NULL) {
+            continue;
+        }
+
+        ret.lines++;
+        ret.linesHit += LC3_IsCovered(cov, i);
+
+        if (LC3_IsConditionalBranch(sim->memory[i].value)) {
+            ret.branches += 2;
+            ret.branchesHit += (cov->taken[i] > 0) + (cov->notTaken[i] > 0);
+        }
+    }
+
+    return ret;
+}
+
+
+int LC3_WriteCoverage(const LC3_Coverage *cov, const LC3_SimInstance *sim, const char *listing, const char *lcov) {
+    FILE *lst = fopen(listing, "w");
+    FILE *info = fopen(lcov, "w");
+    int line = 0;
+
+    if (lst == NULL || info == NULL) {
+        if (lst) fclose(lst);
+        if (info) fclose(info);
+        return 1;
+    }
+
+    fprintf(info, "TN:\nSF:%s\n", listing);
+
+    for (int i = 0; i < LC3_MEM_SIZE; i++) {
+        if (!sim->memory[i].hasDebug) {
+            continue;
+        }
+
+        const char *text = instructionLine(sim, i);
+        bool hit = LC3_IsCovered(cov, i);
+        line++;
+
+        if (text == NULL) {
+            fprintf(lst, "    - | x%04X | x%04X | %s\n", i, (uint16_t)sim->memory[i].value, sim->debug.ptr[sim->memory[i].debugIndex].ptr);
+            continue;
+        }
+
+        fprintf(lst, "%s | x%04X | x%04X | %s", hit ? "  hit" : "#####", i, (uint16_t)sim->memory[i].value, text);
+        fprintf(info, "DA:%d,%d\n", line, hit);
+
+        if (LC3_IsConditionalBranch(sim->memory[i].value)) {
+            fprintf(lst, "  [taken %lu, not taken %lu]", (unsigned long)cov->taken[i], (unsigned long)cov->notTaken[i]);
+
+            if (hit) {
+                fprintf(info, "BRDA:%d,0,0,%lu\nBRDA:%d,0,1,%lu\n", line, (unsigned long)cov->taken[i], line, (unsigned long)cov->notTaken[i]);
+            } else {
+                fprintf(info, "BRDA:%d,0,0,-\nBRDA:%d,0,1,-\n", line, line);
+            }
+        }
+
+        fputc('\n', lst);
+    }
+
+    LC3_CoverageSummary sum = LC3_SummarizeCoverage(cov, sim);
+    fprintf(info, "BRF:%zu\nBRH:%zu\nLF:%zu\nLH:%zu\nend_of_record\n", sum.branches, sum.branchesHit, sum.lines, sum.linesHit);
+
+    int ret = ferror(lst) || ferror(info);
+    ret |= fclose(lst) != 0;
+    ret |= fclose(info) != 0;
+    return ret;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "lc3_sim.h"
+
+// Entries of the edge map, transitions between addresses are hashed into it
+#define LC3_EDGE_MAP_SIZE (1 << 16)
+
+// Coverage collected while the simulator runs
+typedef struct LC3_Coverage {
+    uint8_t hit[LC3_MEM_SIZE / 8];  // Bitmap of executed addresses
+    uint32_t taken[LC3_MEM_SIZE];   // Times the conditional BR at each address was taken
+    uint32_t notTaken[LC3_MEM_SIZE];// Times the conditional BR at each address was not taken
+    uint8_t edges[LC3_EDGE_MAP_SIZE];// Times each hashed PC transition was taken, saturating at 255
+} LC3_Coverage;
+
+
+// Coverage totals over the source lines of a program
+typedef struct LC3_CoverageSummary {
+    size_t lines, linesHit;         // Instruction lines, and how many of them were executed
+    size_t branches, branchesHit;   // Conditional BR directions (taken and not taken), and how many of them were seen
+} LC3_CoverageSummary;
+
+
+/*
+ * Check whether the instruction word is a BR that can go both ways
+ * BR/BRnzp always branches and NOP never does, so neither has a second direction to cover
+ */
+#define LC3_IsConditionalBranch(value) ((((uint16_t)(value) >> 12) == 0) && ((value) & 0x0E00) != 0 && ((value) & 0x0E00) != 0x0E00)
+
+/*
+ * Mark addr as executed
+ */
+#define LC3_CoverHit(cov, addr) ((cov)->hit[(uint16_t)(addr) >> 3] |= (1 << ((addr) & 7)))
+
+/*
+ * Check whether addr was executed
+ */
+#define LC3_IsCovered(cov, addr) (((cov)->hit[(uint16_t)(addr) >> 3] >> ((addr) & 7)) & 1)
+
+/*
+ * Count the transition from the instruction at from to the instruction at to
+ */
+#define LC3_CoverEdge(cov, from, to) do {                                                    \
+    uint8_t *_edge = &(cov)->edges[(uint16_t)((from) * 0x9E37u ^ (to)) % LC3_EDGE_MAP_SIZE]; \
+    *_edge += (*_edge != 0xFF);                                                              \
+} while (0)
+
+/*
+ * Allocate empty coverage data
+ * Should be lc_free'd after use
+ */
+LC3_Coverage *LC3_CreateCoverage(void);
+
+/*
+ * Count covered lines and branches
+ * Only addresses with debug info that is not an assembler directive count as instruction lines
+ */
+LC3_CoverageSummary LC3_SummarizeCoverage(const LC3_Coverage *cov, const LC3_SimInstance *sim);
+
+/*
+ * Write an annotated listing of the debug strings to listing, and lcov tracefile to lcov
+ * The lcov file refers to the lines of the listing, as the original source file is unknown
+ * Returns 0 on success
+ */
+int LC3_WriteCoverage(const LC3_Coverage *cov, const LC3_SimInstance *sim, const char *listing, const char *lcov);
@@ -0,0 +1,78 @@
+#include "lc3_diff.h"
+
+// Bytes compared at once
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define LANES (32)
+typedef __m256i Vector;
+#define LOAD(ptr)       _mm256_loadu_si256((const __m256i *)(ptr))
+#define ZERO()          _mm256_setzero_si256()
+#define ANYDIFF(a, b)   _mm256_xor_si256((a), (b))
+#define EITHER(a, b)    _mm256_or_si256((a), (b))
+#define ALLZERO(x)      (_mm256_movemask_epi8(_mm256_cmpeq_epi8((x), ZERO())) == -1)
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define LANES (16)
+typedef __m128i Vector;
+#define LOAD(ptr)       _mm_loadu_si128((const __m128i *)(ptr))
+#define ZERO()          _mm_setzero_si128()
+#define ANYDIFF(a, b)   _mm_xor_si128((a), (b))
+#define EITHER(a, b)    _mm_or_si128((a), (b))
+#define ALLZERO(x)      (_mm_movemask_epi8(_mm_cmpeq_epi8((x), ZERO())) == 0xFFFF)
+#else
+#define LANES (1)
+#endif
+
+#define PAGE_BYTES (LC3_PAGE_SIZE * sizeof(LC3_MemoryCell))
+
+vaAllocFunction(LC3_DiffRanges, LC3_DiffRange, newDiffRanges, ;, ;)
+vaAppendFunction(LC3_DiffRanges, LC3_DiffRange, addDiffRange, ;, ;)
+
+
+// Check whether two pages hold the same cells, breakpoints and debug strings included
+static bool samePage(const LC3_MemoryCell *a, const LC3_MemoryCell *b) {
+#if LANES > 1
+    const uint8_t *pa = (const uint8_t *)a;
+    const uint8_t *pb = (const uint8_t *)b;
+    Vector acc = ZERO();
+    size_t i = 0;
+
+    for (; i + LANES <= PAGE_BYTES; i += LANES) {
+        acc = EITHER(acc, ANYDIFF(LOAD(pa + i), LOAD(pb + i)));
+    }
+
+    return ALLZERO(acc) && memcmp(pa + i, pb + i, PAGE_BYTES - i) == 0;
+#else
+    return memcmp(a, b, PAGE_BYTES) == 0;
+#endif
+}
+
+
+LC3_DiffRanges LC3_DiffMemory(const LC3_MemoryCell *old, const LC3_MemoryCell *cur, const bool *pages) {
+    LC3_DiffRanges ret = newDiffRanges();
+
+    for (int page = 0; page < LC3_PAGE_COUNT; page++) {
+        int base = page * LC3_PAGE_SIZE;
+
+        if ((pages != NULL && !pages[page]) || samePage(old + base, cur + base)) {
+            continue;
+        }
+
+        // Cells can also differ in breakpoints or debug strings only
+        for (int i = base; i < base + LC3_PAGE_SIZE; i++) {
+            if (old[i].value == cur[i].value) {
+                continue;
+            }
+
+            LC3_DiffRange *last = (ret.sz > 0) ? &ret.ptr[ret.sz - 1] : NULL;
+
+            if (last != NULL && last->start + last->len == (uint32_t)i) {
+                last->len++;
+            } else {
+                addDiffRange(&ret, (LC3_DiffRange){(uint16_t)i, 1});
+            }
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "lc3_sim.h"
+
+
+// Consecutive words whose values changed
+typedef struct LC3_DiffRange {
+    uint16_t start;                 // First changed address
+    uint32_t len;                   // Amount of changed words
+} LC3_DiffRange;
+
+// List of changed ranges, in address order
+vaTypedef(LC3_DiffRange, LC3_DiffRanges);
+
+
+/*
+ * Find the words whose values differ between the memories old and cur
+ * Only pages set in pages are compared, or every page if pages is NULL
+ * The returned ranges should be lc_free'd after use
+ */
+LC3_DiffRanges LC3_DiffMemory(const LC3_MemoryCell *old, const LC3_MemoryCell *cur, const bool *pages);
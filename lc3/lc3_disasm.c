@@ -0,0 +1,158 @@
+#include "lc3_disasm.h"
+#include <stdarg.h>
+
+// Instruction fields
+#define DR(value)   (((value) >> 9) & 0x7)
+#define SR1(value)  (((value) >> 6) & 0x7)
+#define SR2(value)  ((value) & 0x7)
+#define BIT(value, n) (((value) >> (n)) & 1)
+
+// Width of the label column
+#define LABEL_W (8)
+
+
+// Builds a line without overflowing the buffer
+typedef struct LineBuffer {
+    char *ptr;
+    size_t cap;
+    int sz;
+} LineBuffer;
+
+
+static void append(LineBuffer *line, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+
+    if ((size_t)line->sz < line->cap) {
+        int n = vsnprintf(line->ptr + line->sz, line->cap - line->sz, fmt, args);
+        line->sz += (n > 0) ? n : 0;
+        line->sz = ((size_t)line->sz >= line->cap) ? (int)line->cap - 1 : line->sz;
+    }
+
+    va_end(args);
+}
+
+
+static int16_t signExtend(uint16_t value, int bits) {
+    uint16_t sign = 1 << (bits - 1);
+    value &= (1 << bits) - 1;
+    return (int16_t)((value ^ sign) - sign);
+}
+
+
+// PC-relative target, as a label if there is one
+static void appendTarget(LineBuffer *line, const LC3_SimInstance *sim, uint16_t addr, uint16_t value, int bits) {
+    uint16_t target = addr + 1 + signExtend(value, bits);
+    const char *label = LC3_SymbolAt(sim, target);
+
+    if (label != NULL) {
+        append(line, "%s", label);
+    } else {
+        append(line, "x%04X", target);
+    }
+}
+
+
+int LC3_Disassemble(const LC3_SimInstance *sim, uint16_t addr, uint16_t value, char *buf, size_t n) {
+    static const char *const trapNames[] = {"GETC", "OUT", "PUTS", "IN", "PUTSP", "HALT"};
+    static const char *const memNames[] = {
+        [0x2] = "LD", [0x3] = "ST", [0xA] = "LDI", [0xB] = "STI", [0xE] = "LEA",
+    };
+
+    LineBuffer line = {buf, n, 0};
+    const char *label = LC3_SymbolAt(sim, addr);
+    uint16_t op = value >> 12;
+
+    if (n == 0) {
+        return 0;
+    }
+
+    buf[0] = '\0';
+    append(&line, "%-*s", LABEL_W - 1, label ? label : "");
+    append(&line, " ");
+
+    switch (op) {
+        case 0x0:   if ((value & 0x0E00) == 0) {
+                        append(&line, "NOP");
+                        break;
+                    }
+
+                    append(&line, "BR%s%s%s ", BIT(value, 11) ? "n" : "", BIT(value, 10) ? "z" : "", BIT(value, 9) ? "p" : "");
+                    appendTarget(&line, sim, addr, value, 9);
+                    break;
+        case 0x1:
+        case 0x5:   append(&line, "%s R%d, R%d, ", (op == 0x1) ? "ADD" : "AND", DR(value), SR1(value));
+
+                    if (BIT(value, 5)) {
+                        append(&line, "#%d", signExtend(value, 5));
+                    } else {
+                        append(&line, "R%d", SR2(value));
+                    }
+
+                    break;
+        case 0x2:
+        case 0x3:
+        case 0xA:
+        case 0xB:
+        case 0xE:   append(&line, "%s R%d, ", memNames[op], DR(value));
+                    appendTarget(&line, sim, addr, value, 9);
+                    break;
+        case 0x4:   if (BIT(value, 11)) {
+                        append(&line, "JSR ");
+                        appendTarget(&line, sim, addr, value, 11);
+                    } else {
+                        append(&line, "JSRR R%d", SR1(value));
+                    }
+
+                    break;
+        case 0x6:
+        case 0x7:   append(&line, "%s R%d, R%d, #%d", (op == 0x6) ? "LDR" : "STR", DR(value), SR1(value), signExtend(value, 6));
+                    break;
+        case 0x8:   append(&line, "RTI");
+                    break;
+        case 0x9:   append(&line, "NOT R%d, R%d", DR(value), SR1(value));
+                    break;
+        case 0xC:   if (SR1(value) == 7) {
+                        append(&line, "RET");
+                    } else {
+                        append(&line, "JMP R%d", SR1(value));
+                    }
+
+                    break;
+        case 0xD:   append(&line, ".FILL x%04X", value);
+                    break;
+        case 0xF:   if ((value & 0xFF) >= 0x20 && (value & 0xFF) <= 0x25) {
+                        append(&line, "%s", trapNames[(value & 0xFF) - 0x20]);
+                    } else {
+                        append(&line, "TRAP x%02X", value & 0xFF);
+                    }
+
+                    break;
+    }
+
+    return line.sz;
+}
+
+
+LC3_DisasmCache *LC3_CreateDisasmCache(void) {
+    return lc_calloc(1, sizeof(LC3_DisasmCache));
+}
+
+
+const char *LC3_DisassembleCached(LC3_DisasmCache *cache, const LC3_SimInstance *sim, uint16_t addr, uint16_t value) {
+    // Labels may appear anywhere, so new symbols invalidate every line
+    if (cache->symbolEpoch != sim->debugEpoch) {
+        memset(cache->valid, 0, sizeof(cache->valid));
+        cache->symbolEpoch = sim->debugEpoch;
+    }
+
+    bool valid = (cache->valid[addr >> 3] >> (addr & 7)) & 1;
+
+    if (!valid || (uint16_t)cache->value[addr] != value) {
+        LC3_Disassemble(sim, addr, value, cache->text[addr], LC3_DISASM_LEN);
+        cache->value[addr] = (int16_t)value;
+        cache->valid[addr >> 3] |= 1 << (addr & 7);
+    }
+
+    return cache->text[addr];
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "lc3_sim.h"
+
+// Size of a disassembled line, including the terminator
+#define LC3_DISASM_LEN (48)
+
+
+// Disassembled text of every address
+typedef struct LC3_DisasmCache {
+    char text[LC3_MEM_SIZE][LC3_DISASM_LEN];    // Formatted line of each address
+    int16_t value[LC3_MEM_SIZE];                // Value each line was formatted from
+    uint8_t valid[LC3_MEM_SIZE / 8];            // Bitmap of formatted lines
+    uint32_t symbolEpoch;                       // Debug epoch of the simulator the lines were formatted with
+} LC3_DisasmCache;
+
+
+/*
+ * Format value as an instruction at addr into buf (at most n bytes, including the terminator)
+ * The line starts with the label at addr, and targets are replaced by their labels if there are any
+ * Returns the length of the line
+ */
+int LC3_Disassemble(const LC3_SimInstance *sim, uint16_t addr, uint16_t value, char *buf, size_t n);
+
+/*
+ * Allocate an empty cache
+ * Should be lc_free'd after use
+ */
+LC3_DisasmCache *LC3_CreateDisasmCache(void);
+
+/*
+ * Get the disassembled line of value at addr, only formatting it if the cached line is for another value
+ * Lines are reformatted once the symbols of sim change
+ * The returned string stays valid until the next call
+ */
+const char *LC3_DisassembleCached(LC3_DisasmCache *cache, const LC3_SimInstance *sim, uint16_t addr, uint16_t value);
@@ -0,0 +1,130 @@
+#include "lc3_find.h"
+
+// Words compared at once
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define LANES (16)
+typedef __m256i Vector;
+#define SPLAT(x)        _mm256_set1_epi16((int16_t)(x))
+#define LOAD(ptr)       _mm256_loadu_si256((const __m256i *)(ptr))
+#define MATCH(w, m, v)  _mm256_cmpeq_epi16(_mm256_and_si256((w), (m)), (v))
+#define BOTH(a, b)      _mm256_and_si256((a), (b))
+#define BITS(x)         ((uint32_t)_mm256_movemask_epi8(x))
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define LANES (8)
+typedef __m128i Vector;
+#define SPLAT(x)        _mm_set1_epi16((int16_t)(x))
+#define LOAD(ptr)       _mm_loadu_si128((const __m128i *)(ptr))
+#define MATCH(w, m, v)  _mm_cmpeq_epi16(_mm_and_si128((w), (m)), (v))
+#define BOTH(a, b)      _mm_and_si128((a), (b))
+#define BITS(x)         ((uint32_t)_mm_movemask_epi8(x))
+#else
+#define LANES (1)
+#endif
+
+
+LC3_Search *LC3_CreateSearch(void) {
+    return lc_calloc(1, sizeof(LC3_Search));
+}
+
+
+void LC3_UpdateSearch(LC3_Search *search, LC3_SimInstance *sim) {
+    bool first = false;
+
+    for (int page = 0; page < LC3_PAGE_COUNT; page++) {
+        if (search->mark != 0 && !LC3_IsDirty(sim, page, search->mark)) {
+            continue;
+        }
+
+        for (int i = page * LC3_PAGE_SIZE; i < (page + 1) * LC3_PAGE_SIZE; i++) {
+            search->words[i] = (uint16_t)sim->memory[i].value;
+        }
+
+        first |= (page == 0);
+    }
+
+    // Sequences can run past the end of memory into the start
+    if (first) {
+        memcpy(search->words + LC3_MEM_SIZE, search->words, LC3_FIND_MAX * sizeof(uint16_t));
+    }
+
+    search->mark = LC3_NewEpoch(sim);
+}
+
+
+size_t LC3_SearchPattern(LC3_Search *search, const LC3_FindPattern *pattern) {
+    const uint16_t *words = search->words;
+    size_t count = 0;
+
+    if (pattern->len <= 0 || pattern->len > LC3_FIND_MAX) {
+        search->hitCount = 0;
+        return 0;
+    }
+
+#if LANES > 1
+    Vector masks[LC3_FIND_MAX], values[LC3_FIND_MAX];
+
+    for (int k = 0; k < pattern->len; k++) {
+        masks[k]  = SPLAT(pattern->mask[k]);
+        values[k] = SPLAT(pattern->value[k]);
+    }
+
+    // Every word of the pattern is compared for LANES start addresses at once, each lane gives 2 mask bits
+    for (uint32_t i = 0; i < LC3_MEM_SIZE; i += LANES) {
+        Vector eq = MATCH(LOAD(words + i), masks[0], values[0]);
+        uint32_t bits = BITS(eq);
+
+        for (int k = 1; bits && k < pattern->len; k++) {
+            eq = BOTH(eq, MATCH(LOAD(words + i + k), masks[k], values[k]));
+            bits = BITS(eq);
+        }
+
+        while (bits) {
+            int bit = __builtin_ctz(bits);
+            search->hits[count++] = (uint16_t)(i + bit / 2);
+            bits &= ~(3u << bit);
+        }
+    }
+#else
+    for (uint32_t i = 0; i < LC3_MEM_SIZE; i++) {
+        int k = 0;
+        for (; k < pattern->len && (words[i + k] & pattern->mask[k]) == pattern->value[k]; k++);
+
+        if (k == pattern->len) {
+            search->hits[count++] = (uint16_t)i;
+        }
+    }
+#endif
+
+    search->hitCount = count;
+    return count;
+}
+
+
+int32_t LC3_NextHit(const LC3_Search *search, uint16_t addr, bool backwards) {
+    if (search->hitCount == 0) {
+        return -1;
+    }
+
+    // First hit after addr
+    size_t lo = 0, hi = search->hitCount;
+
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+
+        if (search->hits[mid] <= addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (!backwards) {
+        return search->hits[(lo < search->hitCount) ? lo : 0];
+    }
+
+    // Last hit before addr, lo - 1 is addr itself if it is a hit
+    size_t before = (lo > 0 && search->hits[lo - 1] == addr) ? lo - 1 : lo;
+    return search->hits[(before > 0) ? before - 1 : search->hitCount - 1];
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "lc3_sim.h"
+
+// Maximum amount of words in a search pattern
+#define LC3_FIND_MAX (64)
+
+
+// Sequence of (masked) words to search for
+typedef struct LC3_FindPattern {
+    uint16_t value[LC3_FIND_MAX];   // Wanted values, already masked
+    uint16_t mask[LC3_FIND_MAX];    // Bits of each word that are compared
+    int len;                        // Amount of words in the pattern
+} LC3_FindPattern;
+
+
+// Memory search state
+typedef struct LC3_Search {
+    uint16_t words[LC3_MEM_SIZE + LC3_FIND_MAX];    // Dense copy of the memory values, the first words are repeated at the end
+    uint32_t mark;                                  // Epoch mark of the simulator when words was last updated, 0 if never
+    uint16_t hits[LC3_MEM_SIZE];                    // Addresses where the last pattern starts, in order
+    size_t hitCount;                                // Amount of hits
+} LC3_Search;
+
+
+/*
+ * Allocate search state
+ * Should be lc_free'd after use
+ */
+LC3_Search *LC3_CreateSearch(void);
+
+/*
+ * Copy the memory pages of sim that changed since the last update into the dense array
+ */
+void LC3_UpdateSearch(LC3_Search *search, LC3_SimInstance *sim);
+
+/*
+ * Find every address where pattern starts, sequences may wrap around the end of memory
+ * Replaces the hits of the previous search, and returns the amount of hits
+ */
+size_t LC3_SearchPattern(LC3_Search *search, const LC3_FindPattern *pattern);
+
+/*
+ * Get the first hit after addr (or before addr if backwards), wrapping around
+ * Returns -1 if there are no hits
+ */
+int32_t LC3_NextHit(const LC3_Search *search, uint16_t addr, bool backwards);
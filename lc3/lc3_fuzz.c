@@ -0,0 +1,510 @@
+#include "lc3_fuzz.h"
+#include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "lc3_cover.h"
+#include "lc3_io.h"
+
+#define LOAD(ptr)        __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define STORE(ptr, val)  __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#define ADD(ptr, val)    __atomic_fetch_add((ptr), (val), __ATOMIC_RELAXED)
+
+// Bytes of the edge map compared at once when looking for taken edges
+#define EDGE_BLOCK (64)
+
+
+// Corpus functions
+vaTypedef(ByteArray, FuzzCorpus);
+vaAllocFunction(FuzzCorpus, ByteArray, newFuzzCorpus, ;, ;)
+vaAppendFunction(FuzzCorpus, ByteArray, addFuzzInput, ;, ;)
+vaFreeFunction(FuzzCorpus, ByteArray, freeFuzzCorpus, lc_free(el.ptr), ;, ;)
+
+
+// How a run ended, the exceptions are in order of their vectors
+typedef enum FuzzResult {
+    FUZZ_PRIVILEGE,
+    FUZZ_ILLEGAL,
+    FUZZ_ACV,
+    FUZZ_DONE,
+    FUZZ_HANG,
+} FuzzResult;
+
+static const char *resultNames[] = {"privilege", "illegal", "acv"};
+
+// Edge maps kept per kind of saved input
+enum {
+    MAP_QUEUE,
+    MAP_CRASH,
+    MAP_HANG,
+    MAP_COUNT,
+};
+
+
+// Shared by the fuzzing threads
+typedef struct FuzzJob {
+    const LC3_FuzzConfig *cfg;
+    const LC3_SimInstance *base;    // Freshly loaded executable, only read
+    FuzzCorpus corpus;              // Inputs reaching new edges, protected by lock
+    uint8_t virgin[MAP_COUNT][LC3_EDGE_MAP_SIZE]; // Edge buckets no saved input reached yet, protected by lock
+    LC3_FuzzStats stats;            // Runs and instructions are atomic, the rest is protected by lock
+    uint64_t saved;                 // Inputs saved so far, numbers the files
+    bool stop;                      // Set when the threads should finish, atomic
+    pthread_mutex_t lock;
+} FuzzJob;
+
+
+// State of one fuzzing thread, reused for every run
+typedef struct FuzzThread {
+    FuzzJob *job;
+    LC3_SimInstance sim;            // Collects coverage, reset from image before each run
+    LC3_SimImage image;             // sim right after loading
+    uint16_t handlers[3];           // Addresses of the exception handlers, breakpoints end runs there
+    uint8_t seen[MAP_COUNT][LC3_EDGE_MAP_SIZE]; // Copy of job->virgin, checked without locking
+    uint8_t input[LC3_FUZZ_INPUT_MAX], parent[LC3_FUZZ_INPUT_MAX], other[LC3_FUZZ_INPUT_MAX];
+    size_t inputSz, parentSz, otherSz;
+    uint64_t rng;                   // xorshift state
+    pthread_t thread;
+} FuzzThread;
+
+
+// Bytes mutations favour, programs mostly read digits, letters and newlines
+static const char interesting[] = "\n 0123456789-+azAZ\x7F\xFF";
+
+
+static double secondsSince(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+
+static uint64_t nextRandom(FuzzThread *t) {
+    t->rng ^= t->rng << 13;
+    t->rng ^= t->rng >> 7;
+    t->rng ^= t->rng << 17;
+    return t->rng;
+}
+
+
+// Coarse class of a hit count, so only meaningful changes in loop counts are new
+static uint8_t bucket(uint8_t count) {
+    if (count <= 3) {
+        return (count == 3) ? 4 : count;
+    }
+
+    return (count < 8) ? 8 : (count < 16) ? 16 : (count < 32) ? 32 : (count < 128) ? 64 : 128;
+}
+
+
+// Check for edge buckets still set in virgin, skipping empty blocks as most edges are never taken
+static bool hasNewBits(const uint8_t *edges, const uint8_t *virgin) {
+    static const uint8_t empty[EDGE_BLOCK] = {0};
+
+    for (size_t i = 0; i < LC3_EDGE_MAP_SIZE; i += EDGE_BLOCK) {
+        if (memcmp(edges + i, empty, EDGE_BLOCK) == 0) {
+            continue;
+        }
+
+        for (size_t j = i; j < i + EDGE_BLOCK; j++) {
+            if (edges[j] && (bucket(edges[j]) & virgin[j])) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+
+// Clear the buckets of edges in virgin, returns the amount of edges not seen before
+static size_t mergeBits(const uint8_t *edges, uint8_t *virgin) {
+    size_t ret = 0;
+
+    for (size_t i = 0; i < LC3_EDGE_MAP_SIZE; i++) {
+        if (edges[i]) {
+            ret += (virgin[i] == 0xFF);
+            virgin[i] &= ~bucket(edges[i]);
+        }
+    }
+
+    return ret;
+}
+
+
+// Make a directory, or use the existing one
+static int makeDir(const char *dir, const char *sub) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s%s", dir, sub);
+    return (mkdir(path, 0755) != 0 && errno != EEXIST);
+}
+
+
+// Write the current input of t to a new file in DIR/sub, job->lock should be held
+static void saveInput(FuzzThread *t, const char *sub, const char *prefix) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s/%s%06llu", t->job->cfg->dir, sub, prefix, (unsigned long long)t->job->saved++);
+
+    FILE *fp = fopen(path, "wb");
+
+    if (fp == NULL) {
+        fprintf(stderr, "%s: failed to save input\n", path);
+        return;
+    }
+
+    fwrite(t->input, 1, t->inputSz, fp);
+    fclose(fp);
+}
+
+
+// Run the current input from the freshly loaded executable
+static FuzzResult runInput(FuzzThread *t) {
+    LC3_SimInstance *sim = &t->sim;
+
+    // Only the pages the previous run wrote are copied back
+    LC3_RestoreImage(sim, &t->image);
+    memset(sim->coverage->edges, 0, sizeof(sim->coverage->edges));
+
+    for (size_t i = 0; i < t->inputSz; LC3_QueueInput(&sim->inputs, (char)t->input[i]), i++);
+    sim->flags &= ~LC3_SIM_HALTED;
+
+    LC3_UntilBreakpoint(sim, t->job->cfg->budget);
+    ADD(&t->job->stats.runs, 1);
+    ADD(&t->job->stats.instructions, sim->counter - t->image.state.counter);
+
+    if (!(sim->flags & LC3_SIM_HALTED)) {
+        return FUZZ_HANG;
+    }
+
+    // Exceptions stop on the breakpoint of their handler, with the table and vector still set
+    if (sim->reg.Table == 0x01 && sim->reg.Vector <= FUZZ_ACV && sim->reg.PC == t->handlers[sim->reg.Vector]) {
+        return (FuzzResult)sim->reg.Vector;
+    }
+
+    return FUZZ_DONE;
+}
+
+
+// Keep and save the current input if it took new edges for its kind of result, seeds are always kept
+static void judgeInput(FuzzThread *t, FuzzResult result, bool seed) {
+    FuzzJob *job = t->job;
+    const uint8_t *edges = t->sim.coverage->edges;
+    int map = (result == FUZZ_DONE) ? MAP_QUEUE : (result == FUZZ_HANG) ? MAP_HANG : MAP_CRASH;
+
+    // Nearly every run ends here, without touching anything shared
+    if (!seed && !hasNewBits(edges, t->seen[map])) {
+        return;
+    }
+
+    pthread_mutex_lock(&job->lock);
+
+    if (seed || hasNewBits(edges, job->virgin[map])) {
+        size_t found = mergeBits(edges, job->virgin[map]);
+
+        if (result == FUZZ_DONE) {
+            ByteArray kept = newByteArray();
+            addBytes(&kept, t->input, t->inputSz);
+            addFuzzInput(&job->corpus, kept);
+            saveInput(t, "queue", "");
+            job->stats.edges += found;
+        } else if (result == FUZZ_HANG) {
+            saveInput(t, "hangs", "");
+            job->stats.hangs++;
+        } else {
+            // Named after the exception and the address of the instruction causing it, which the exception pushed
+            size_t *counts[] = {&job->stats.privilege, &job->stats.illegal, &job->stats.acv};
+            uint16_t addr = t->sim.memory[(uint16_t)t->sim.reg.reg[6]].value;
+            char prefix[32];
+            snprintf(prefix, sizeof(prefix), "%s-x%04X-", resultNames[result], addr);
+            saveInput(t, "crashes", prefix);
+            (*counts[result])++;
+        }
+    }
+
+    memcpy(t->seen[map], job->virgin[map], LC3_EDGE_MAP_SIZE);
+    pthread_mutex_unlock(&job->lock);
+}
+
+
+// Copy a random corpus entry to dst
+static void pickInput(FuzzThread *t, uint8_t *dst, size_t *size) {
+    const ByteArray *src = &t->job->corpus.ptr[nextRandom(t) % t->job->corpus.sz];
+    memcpy(dst, src->ptr, src->sz);
+    *size = src->sz;
+}
+
+
+// Apply one random change to the input
+static void mutate(FuzzThread *t) {
+    uint8_t *in = t->input;
+    size_t sz = t->inputSz;
+    size_t at = sz ? nextRandom(t) % sz : 0;
+    uint64_t op = nextRandom(t) % 7;
+
+    // Empty inputs can only grow
+    if (sz == 0 || (op == 4 && sz == 1)) {
+        op = 3;
+    } else if (sz >= LC3_FUZZ_INPUT_MAX && (op == 3 || op == 5)) {
+        op = 4;
+    }
+
+    switch (op) {
+        // Flip a bit
+        case 0: in[at] ^= 1 << (nextRandom(t) % 8);
+                break;
+        // Random byte
+        case 1: in[at] = (uint8_t)nextRandom(t);
+                break;
+        // Interesting byte
+        case 2: in[at] = interesting[nextRandom(t) % (sizeof(interesting) - 1)];
+                break;
+        // Insert a byte, usually an interesting one
+        case 3: at = nextRandom(t) % (sz + 1);
+                memmove(in + at + 1, in + at, sz - at);
+                in[at] = (nextRandom(t) & 3) ? interesting[nextRandom(t) % (sizeof(interesting) - 1)] : (uint8_t)nextRandom(t);
+                sz++;
+                break;
+        // Delete a block
+        case 4: {
+                size_t n = 1 + nextRandom(t) % (sz - at);
+                n = (n < sz) ? n : sz - 1;
+                memmove(in + at, in + at + n, sz - at - n);
+                sz -= n;
+                break;
+        }
+        // Duplicate a block
+        case 5: {
+                size_t n = 1 + nextRandom(t) % (sz - at);
+                n = (sz + n <= LC3_FUZZ_INPUT_MAX) ? n : LC3_FUZZ_INPUT_MAX - sz;
+                memmove(in + at + n, in + at, sz - at);
+                sz += n;
+                break;
+        }
+        // Continue with the end of another input
+        default: {
+                size_t from = t->otherSz ? nextRandom(t) % t->otherSz : 0;
+                size_t n = t->otherSz - from;
+                n = (at + n <= LC3_FUZZ_INPUT_MAX) ? n : LC3_FUZZ_INPUT_MAX - at;
+                memcpy(in + at, t->other + from, n);
+                sz = at + n;
+                break;
+        }
+    }
+
+    t->inputSz = sz;
+}
+
+
+static void *fuzzThread(void *arg) {
+    FuzzThread *t = arg;
+    FuzzJob *job = t->job;
+
+    while (!LOAD(&job->stop)) {
+        pthread_mutex_lock(&job->lock);
+        pickInput(t, t->parent, &t->parentSz);
+        pickInput(t, t->other, &t->otherSz);
+        pthread_mutex_unlock(&job->lock);
+
+        for (int round = 0; round < LC3_FUZZ_ROUNDS; round++) {
+            memcpy(t->input, t->parent, t->parentSz);
+            t->inputSz = t->parentSz;
+
+            // A few changes stacked at once
+            for (int n = 1 << (nextRandom(t) % 3); n > 0; mutate(t), n--);
+            judgeInput(t, runInput(t), false);
+        }
+    }
+
+    return NULL;
+}
+
+
+static FuzzThread *createFuzzThread(FuzzJob *job, uint64_t seed) {
+    FuzzThread *t = lc_malloc(sizeof(FuzzThread));
+    t->job = job;
+    t->sim = LC3_CreateSimInstance();
+    t->sim.coverage = LC3_CreateCoverage();
+    t->image = LC3_CreateImage();
+    t->rng = seed ? seed : 1;
+    t->otherSz = 0;
+
+    LC3_CopySimState(&t->sim, job->base, 0);
+    t->sim.flags |= LC3_SIM_NO_HISTORY;
+
+    // The vector table as loaded, programs overwriting it are not followed
+    for (int i = 0; i < 3; i++) {
+        t->handlers[i] = t->sim.memory[0x0100 + i].value;
+        LC3_SetBreakpoint(&t->sim, t->handlers[i], true);
+    }
+
+    LC3_CaptureImage(&t->image, &t->sim);
+    memcpy(t->seen, job->virgin, sizeof(t->seen));
+    return t;
+}
+
+
+static void destroyFuzzThread(FuzzThread *t) {
+    LC3_DestroyImage(t->image);
+    LC3_DestroySimInstance(t->sim);
+    lc_free(t);
+}
+
+
+// Run every file in dir as a seed, or an empty input if dir is NULL
+static int runSeeds(FuzzThread *t, const char *dir) {
+    DIR *d = (dir != NULL) ? opendir(dir) : NULL;
+    struct dirent *entry;
+
+    if (dir != NULL && d == NULL) {
+        fprintf(stderr, "%s: failed to open directory\n", dir);
+        return 1;
+    }
+
+    while (d != NULL && (entry = readdir(d)) != NULL) {
+        char path[4096];
+        size_t size = 0;
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+
+        struct stat st;
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+
+        const uint8_t *data = mapFile(path, &size);
+        t->inputSz = (size < LC3_FUZZ_INPUT_MAX) ? size : LC3_FUZZ_INPUT_MAX;
+        memcpy(t->input, data, t->inputSz);
+        unmapFile(data, size);
+
+        judgeInput(t, runInput(t), true);
+    }
+
+    if (d != NULL) {
+        closedir(d);
+    }
+
+    // Always something to mutate, even if every seed crashed
+    if (t->job->corpus.sz == 0) {
+        t->inputSz = 0;
+        judgeInput(t, runInput(t), true);
+    }
+
+    if (t->job->corpus.sz == 0) {
+        addFuzzInput(&t->job->corpus, newByteArray());
+    }
+
+    return 0;
+}
+
+
+static void writeSummary(FILE *out, const LC3_FuzzStats *stats, double seconds) {
+    fprintf(out, "runs: %llu\n", (unsigned long long)stats->runs);
+    fprintf(out, "runs per second: %.0f\n", stats->runs / seconds);
+    fprintf(out, "instructions: %llu\n", (unsigned long long)stats->instructions);
+    fprintf(out, "corpus: %zu\n", stats->corpus);
+    fprintf(out, "edges: %zu\n", stats->edges);
+    fprintf(out, "access violations: %zu\n", stats->acv);
+    fprintf(out, "illegal opcodes: %zu\n", stats->illegal);
+    fprintf(out, "privilege violations: %zu\n", stats->privilege);
+    fprintf(out, "hangs: %zu\n", stats->hangs);
+}
+
+
+int LC3_Fuzz(const LC3_FuzzConfig *cfg, FILE *out) {
+    LC3_SimInstance base = LC3_CreateSimInstance();
+    LC3_LoadExecutable(&base, cfg->executable);
+
+    if (base.error != NULL) {
+        fprintf(stderr, "%s: %s\n", cfg->executable, base.error);
+        LC3_DestroySimInstance(base);
+        return -1;
+    }
+
+    if (makeDir(cfg->dir, "") || makeDir(cfg->dir, "/queue") || makeDir(cfg->dir, "/crashes") || makeDir(cfg->dir, "/hangs")) {
+        fprintf(stderr, "%s: failed to create directory\n", cfg->dir);
+        LC3_DestroySimInstance(base);
+        return -1;
+    }
+
+    FuzzJob *job = lc_calloc(1, sizeof(FuzzJob));
+    job->cfg = cfg;
+    job->base = &base;
+    job->corpus = newFuzzCorpus();
+    memset(job->virgin, 0xFF, sizeof(job->virgin));
+    pthread_mutex_init(&job->lock, NULL);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    FuzzThread **threads = lc_malloc(cfg->jobs * sizeof(FuzzThread *));
+    uint64_t seed = (uint64_t)start.tv_nsec ^ ((uint64_t)start.tv_sec << 32);
+
+    for (int i = 0; i < cfg->jobs; i++) {
+        threads[i] = createFuzzThread(job, seed * (2 * i + 1));
+    }
+
+    int ret = runSeeds(threads[0], cfg->seeds);
+
+    // Only this thread receives the signals that stop fuzzing early
+    sigset_t stop;
+    sigemptyset(&stop);
+    sigaddset(&stop, SIGINT);
+    sigaddset(&stop, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop, NULL);
+
+    int started = 0;
+    for (; ret == 0 && started < cfg->jobs && pthread_create(&threads[started]->thread, NULL, fuzzThread, threads[started]) == 0; started++);
+
+    // Fuzzing goes on with fewer threads than asked for, but not without any
+    if (ret == 0 && started == 0) {
+        fprintf(stderr, "failed to start fuzzing threads\n");
+        ret = 1;
+    }
+
+    bool progress = isatty(STDERR_FILENO);
+
+    while (ret == 0 && secondsSince(start) < cfg->seconds) {
+        struct timespec second = {.tv_sec = 1, .tv_nsec = 0};
+
+        if (sigtimedwait(&stop, NULL, &second) > 0) {
+            break;
+        }
+
+        if (progress) {
+            pthread_mutex_lock(&job->lock);
+            fprintf(stderr, "\r%llu runs, corpus %zu, edges %zu, crashes %zu, hangs %zu ",
+                    (unsigned long long)LOAD(&job->stats.runs), job->corpus.sz, job->stats.edges,
+                    job->stats.acv + job->stats.illegal + job->stats.privilege, job->stats.hangs);
+            pthread_mutex_unlock(&job->lock);
+        }
+    }
+
+    STORE(&job->stop, true);
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i]->thread, NULL);
+    }
+
+    if (progress) {
+        fprintf(stderr, "\n");
+    }
+
+    if (ret == 0) {
+        job->stats.corpus = job->corpus.sz;
+        writeSummary(out, &job->stats, secondsSince(start));
+        ret = (job->stats.acv + job->stats.illegal + job->stats.privilege + job->stats.hangs > 0);
+    } else {
+        ret = -1;
+    }
+
+    for (int i = 0; i < cfg->jobs; destroyFuzzThread(threads[i]), i++);
+    lc_free(threads);
+    freeFuzzCorpus(job->corpus);
+    pthread_mutex_destroy(&job->lock);
+    lc_free(job);
+    LC3_DestroySimInstance(base);
+    return ret;
+}
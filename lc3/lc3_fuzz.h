@@ -0,0 +1,49 @@
+#pragma once
+#include <stdio.h>
+#include "lc3_sim.h"
+
+// Instructions a run may execute when no budget is given, runs reaching it are saved as hangs
+#define LC3_FUZZ_BUDGET (1000000)
+
+// Seconds to fuzz when no time is given
+#define LC3_FUZZ_SECONDS (60)
+
+// Longest input tried
+#define LC3_FUZZ_INPUT_MAX (1024)
+
+// Mutations tried on an input before another one is picked from the corpus
+#define LC3_FUZZ_ROUNDS (64)
+
+
+// Settings of the fuzzer (--fuzz)
+typedef struct LC3_FuzzConfig {
+    char *executable;               // Executable that is fuzzed
+    char *dir;                      // Directory the interesting inputs are saved to
+    char *seeds;                    // Directory with initial inputs, NULL to start from an empty line
+    int64_t budget;                 // Instructions each run may execute
+    int64_t seconds;                // Time to fuzz for
+    int jobs;                       // Runs at the same time
+} LC3_FuzzConfig;
+
+
+// Totals of a fuzzing session
+typedef struct LC3_FuzzStats {
+    uint64_t runs;                  // Inputs tried
+    uint64_t instructions;          // Instructions executed over all runs
+    size_t corpus;                  // Inputs reaching new coverage, seeds included
+    size_t edges;                   // Distinct edges reached by the corpus
+    size_t acv, illegal, privilege; // Saved inputs per kind of exception
+    size_t hangs;                   // Saved inputs exceeding the budget
+} LC3_FuzzStats;
+
+
+/*
+ * Fuzz the input of cfg->executable on cfg->jobs threads until cfg->seconds have passed, or SIGINT or SIGTERM
+ * Every run restores the freshly loaded executable, queues a mutated input and runs until it halts, waits for input,
+ * causes an exception or exceeds the budget. Inputs reaching new edges are kept for further mutation and saved to
+ * DIR/queue, inputs causing an access violation, illegal opcode or privilege violation to DIR/crashes, and inputs
+ * exceeding the budget to DIR/hangs. Crashes and hangs are only saved if they took new edges, so each is distinct
+ * A summary is written to out, and progress to stderr
+ * Returns 0 if nothing crashed or hung, 1 if something did, or -1 if the executable, seeds or output could not be used
+ */
+int LC3_Fuzz(const LC3_FuzzConfig *cfg, FILE *out);
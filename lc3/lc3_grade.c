@@ -0,0 +1,258 @@
+#include "lc3_grade.h"
+#include <dirent.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include "lc3_io.h"
+
+
+// Grade case list functions
+vaAllocFunction(LC3_GradeCases, LC3_GradeCase, newGradeCases, ;, ;)
+vaAppendFunction(LC3_GradeCases, LC3_GradeCase, addGradeCase, ;, ;)
+vaFreeFunction(LC3_GradeCases, LC3_GradeCase, freeGradeCases, lc_free(el.name.ptr), ;, ;)
+
+
+// Shared by the grading threads
+typedef struct GradeJob {
+    const LC3_GradeConfig *cfg;
+    const LC3_SimInstance *base;    // Freshly loaded executable, only read
+    LC3_GradeCases cases;
+    size_t next;                    // Next case to run, protected by lock
+    pthread_mutex_t lock;
+} GradeJob;
+
+
+static double secondsSince(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+
+// Path of a file of a case, should be lc_free'd
+static char *casePath(const char *dir, const char *name, const char *ext) {
+    size_t len = strlen(dir) + strlen(name) + strlen(ext) + 2;
+    char *ret = lc_malloc(len);
+    snprintf(ret, len, "%s/%s%s", dir, name, ext);
+    return ret;
+}
+
+
+static int compareCases(const void *a, const void *b) {
+    return strcmp(((const LC3_GradeCase *)a)->name.ptr, ((const LC3_GradeCase *)b)->name.ptr);
+}
+
+
+// Find every NAME.input with a NAME.expected next to it, sorted by name
+static int findCases(const char *dir, LC3_GradeCases *cases) {
+    DIR *d = opendir(dir);
+    struct dirent *entry;
+
+    if (d == NULL) {
+        return 1;
+    }
+
+    while ((entry = readdir(d)) != NULL) {
+        const char *ext = strrchr(entry->d_name, '.');
+
+        if (ext == NULL || strcmp(ext, ".input") != 0) {
+            continue;
+        }
+
+        LC3_GradeCase c = {.name = newString()};
+        for (const char *at = entry->d_name; at < ext; addchar(&c.name, *at), at++);
+
+        char *expected = casePath(dir, c.name.ptr, ".expected");
+        FILE *fp = fopen(expected, "rb");
+        lc_free(expected);
+
+        if (fp == NULL) {
+            lc_free(c.name.ptr);
+            continue;
+        }
+
+        fclose(fp);
+        addGradeCase(cases, c);
+    }
+
+    closedir(d);
+    qsort(cases->ptr, cases->sz, sizeof(LC3_GradeCase), compareCases);
+    return 0;
+}
+
+
+// Compare output produced since checked against the expected output, returns false on the first difference
+static bool compareOutput(LC3_GradeCase *c, const char *output, size_t size, size_t *checked, const uint8_t *expected, size_t expectedSize) {
+    for (; *checked < size; (*checked)++) {
+        if (*checked >= expectedSize) {
+            c->failure = "more output than expected";
+            c->offset = *checked;
+            return false;
+        } else if ((uint8_t)output[*checked] != expected[*checked]) {
+            c->failure = "output differs";
+            c->offset = *checked;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+static void runCase(const GradeJob *job, LC3_GradeCase *c) {
+    char *inputPath = casePath(job->cfg->dir, c->name.ptr, ".input");
+    char *expectedPath = casePath(job->cfg->dir, c->name.ptr, ".expected");
+    size_t inputSize = 0, expectedSize = 0, outputSize = 0, checked = 0;
+    const uint8_t *input = mapFile(inputPath, &inputSize);
+    const uint8_t *expected = mapFile(expectedPath, &expectedSize);
+    char *output = NULL;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    LC3_SimInstance sim = LC3_CreateSimInstance();
+    LC3_CopySimState(&sim, job->base, 0);
+
+    // Output goes into memory as well, unescaped, so it can be compared as it is produced
+    sim.outf = open_memstream(&output, &outputSize);
+
+    for (size_t i = 0; i < inputSize; LC3_QueueInput(&sim.inputs, (char)input[i]), i++);
+    sim.flags &= ~LC3_SIM_HALTED;
+    sim.flags |= LC3_SIM_NO_HISTORY;
+
+    bool same = true;
+
+    while (same && !(sim.flags & LC3_SIM_HALTED) && (int64_t)sim.counter < job->cfg->budget) {
+        int64_t left = job->cfg->budget - (int64_t)sim.counter;
+        LC3_UntilBreakpoint(&sim, (left < LC3_GRADE_CHUNK) ? left : LC3_GRADE_CHUNK);
+        fflush(sim.outf);
+        same = compareOutput(c, output, outputSize, &checked, expected, expectedSize);
+    }
+
+    if (!same) {
+        ;
+    } else if (!(sim.flags & LC3_SIM_HALTED)) {
+        c->failure = "instruction budget exceeded";
+    } else if (LC3_WaitingForInput(&sim)) {
+        c->failure = "waiting for input";
+    } else if (checked < expectedSize) {
+        c->failure = "output ends early";
+        c->offset = checked;
+    }
+
+    c->instructions = sim.counter;
+    c->seconds = secondsSince(start);
+
+    // Closes the memstream, which still has to be freed
+    LC3_DestroySimInstance(sim);
+    free(output);
+
+    unmapFile(input, inputSize);
+    unmapFile(expected, expectedSize);
+    lc_free(inputPath);
+    lc_free(expectedPath);
+}
+
+
+static void *gradeThread(void *arg) {
+    GradeJob *job = arg;
+
+    while (true) {
+        pthread_mutex_lock(&job->lock);
+        size_t idx = job->next++;
+        pthread_mutex_unlock(&job->lock);
+
+        if (idx >= job->cases.sz) {
+            return NULL;
+        }
+
+        runCase(job, &job->cases.ptr[idx]);
+    }
+}
+
+
+// Write the results as TAP version 13, with instruction counts and timing as YAML
+static int writeReport(FILE *out, const LC3_GradeCases *cases, double seconds) {
+    size_t failed = 0, instructions = 0;
+
+    fprintf(out, "TAP version 13\n1..%zu\n", cases->sz);
+
+    for (size_t i = 0; i < cases->sz; i++) {
+        const LC3_GradeCase *c = &cases->ptr[i];
+
+        fprintf(out, "%sok %zu - %s\n  ---\n", c->failure ? "not " : "", i + 1, c->name.ptr);
+
+        if (c->failure) {
+            fprintf(out, "  message: %s\n", c->failure);
+        }
+
+        if (c->failure && c->offset != SIZE_MAX) {
+            fprintf(out, "  offset: %zu\n", c->offset);
+        }
+
+        fprintf(out, "  instructions: %zu\n  ms: %.3f\n  ...\n", c->instructions, c->seconds * 1000);
+        failed += (c->failure != NULL);
+        instructions += c->instructions;
+    }
+
+    fprintf(out, "# %zu/%zu passed, %zu instructions in %.3f ms\n", cases->sz - failed, cases->sz, instructions, seconds * 1000);
+    return (int)failed;
+}
+
+
+int LC3_Grade(const LC3_GradeConfig *cfg, FILE *out) {
+    LC3_SimInstance base = LC3_CreateSimInstance();
+    LC3_LoadExecutable(&base, cfg->executable);
+
+    if (base.error != NULL) {
+        fprintf(stderr, "%s: %s\n", cfg->executable, base.error);
+        LC3_DestroySimInstance(base);
+        return -1;
+    }
+
+    GradeJob job = {
+        .cfg   = cfg,
+        .base  = &base,
+        .cases = newGradeCases(),
+        .next  = 0,
+    };
+
+    if (findCases(cfg->dir, &job.cases) != 0) {
+        fprintf(stderr, "%s: failed to open directory\n", cfg->dir);
+        freeGradeCases(job.cases);
+        LC3_DestroySimInstance(base);
+        return -1;
+    }
+
+    for (size_t i = 0; i < job.cases.sz; i++) {
+        job.cases.ptr[i].failure = NULL;
+        job.cases.ptr[i].offset = SIZE_MAX;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int jobs = (cfg->jobs < (int)job.cases.sz) ? cfg->jobs : (int)job.cases.sz;
+    pthread_t *threads = lc_malloc((jobs + 1) * sizeof(pthread_t));
+    pthread_mutex_init(&job.lock, NULL);
+
+    int started = 0;
+    for (; started < jobs && pthread_create(&threads[started], NULL, gradeThread, &job) == 0; started++);
+
+    // Without any thread the cases still run, one after another
+    if (started == 0) {
+        gradeThread(&job);
+    }
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    int failed = writeReport(out, &job.cases, secondsSince(start));
+
+    pthread_mutex_destroy(&job.lock);
+    lc_free(threads);
+    freeGradeCases(job.cases);
+    LC3_DestroySimInstance(base);
+    return failed;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <stdio.h>
+#include "lc3_sim.h"
+
+// Instructions executed between output comparisons
+#define LC3_GRADE_CHUNK (4096)
+
+// Instructions a case may execute when no budget is given
+#define LC3_GRADE_BUDGET (10000000)
+
+
+// Settings of the autograder (--grade)
+typedef struct LC3_GradeConfig {
+    char *executable;               // Executable that is tested
+    char *dir;                      // Directory with NAME.input and NAME.expected files
+    int64_t budget;                 // Instructions each case may execute
+    int jobs;                       // Cases run at the same time
+} LC3_GradeConfig;
+
+
+// Test case of the autograder
+typedef struct LC3_GradeCase {
+    String name;                    // Name of the case, the files without extension
+    const char *failure;            // Why the case failed, NULL if it passed
+    size_t offset;                  // Output offset the failure refers to
+    size_t instructions;            // Instructions executed
+    double seconds;                 // Time taken
+} LC3_GradeCase;
+
+vaTypedef(LC3_GradeCase, LC3_GradeCases);
+
+
+/*
+ * Run every case in cfg->dir against cfg->executable on cfg->jobs threads, and write a TAP report to out
+ * Each case starts from the freshly loaded executable with NAME.input queued as input, and passes if the simulator
+ * halts with exactly NAME.expected as output. A case stops as soon as its output differs
+ * Returns the amount of failed cases, or -1 if the executable or directory could not be read
+ */
+int LC3_Grade(const LC3_GradeConfig *cfg, FILE *out);
@@ -1,5 +1,7 @@
 #include "lc3_io.h"
+#include "lc3_snap.h"
 #include "lc3_util.h"
+#include <ctype.h>
 
 #define READ_SAFE(ptr, sz, n, fp, onFail) if (fread(ptr, sz, n, fp) != n) { onFail; }
 #define CHECK(x, onFail) if(!(x)) { onFail; }
@@ -20,24 +22,6 @@ static String readString(FILE *fp) {
 }
 
 
-static void printString(FILE *fp, String str) {
-    fwrite(str.ptr, sizeof(char), str.sz + 1, fp);
-}
-
-
-static void setDebugString(LC3_SimInstance *sim, String debug, int addr) {
-    if (sim->memory[addr].hasDebug) {
-        int idx = sim->memory[addr].debugIndex;
-        lc_free(sim->debug.ptr[idx].ptr);
-        sim->debug.ptr[idx] = debug;
-    } else {
-        sim->memory[addr].hasDebug   = true;
-        sim->memory[addr].debugIndex = sim->debug.sz;
-        addString(&sim->debug, debug);
-    }
-}
-
-
 // Load LC3A executable (.lc3)
 static void loadExecutableLC3A(LC3_SimInstance *sim, FILE *fp) {
     enum {
@@ -60,16 +44,25 @@ static void loadExecutableLC3A(LC3_SimInstance *sim, FILE *fp) {
 
     while (fread(&indicator, 1, 1, fp)) {
         if (indicator == 'S') {
-            // Why is there a symbol table in my executable?
             uint32_t count;
-            uint32_t gobbler;
+            uint16_t addr;
 
             fread(&count, 4, 1, fp);
 
-            // Skip skip skip skip
             for (uint32_t i = 0; i < count; i++) {
-                fread(&gobbler, 2, 1, fp);
-                for (char c; fread(&c, 1, 1, fp) && c != '\0';);
+                fread(&addr, 2, 1, fp);
+                String name = readString(fp);
+
+                if (name.cap > 0) {
+                    LC3_AddSymbol(sim, addr, name.ptr);
+                }
+
+                lc_free(name.ptr);
+
+                if (name.cap == 0) {
+                    sim->error = "truncated symbol table";
+                    return;
+                }
             }
         }
 
@@ -89,10 +82,11 @@ static void loadExecutableLC3A(LC3_SimInstance *sim, FILE *fp) {
 
             for (uint16_t i = orig; i < (orig + count); i++) {
                 fread(sim->memory + i, 2, 1, fp);
+                LC3_MarkDirty(sim, i);
 
                 if ((flags & LC3_FILE_DBG)) {
                     String debug = readString(fp);
-                    setDebugString(sim, debug, i);
+                    LC3_SetDebugString(sim, i, debug);
                 }
             }
         }
@@ -142,9 +136,10 @@ static void loadExecutableLC3T(LC3_SimInstance *sim, FILE *fp) {
             }
         } else if (origFound) {
             sim->memory[addr].value = entry.value;
+            LC3_MarkDirty(sim, addr);
 
             if (entry.len > 0) {
-                setDebugString(sim, entry.debug, addr);
+                LC3_SetDebugString(sim, addr, entry.debug);
             }
         } else {
             if (entry.len > 0) {
@@ -161,10 +156,178 @@ static void loadExecutableLC3T(LC3_SimInstance *sim, FILE *fp) {
 }
 
 
+// Parse up to 4 hex digits at str, returns the amount of digits read
+static size_t parseHexDigits(const char *str, size_t len, uint16_t *value) {
+    size_t i = 0;
+    (*value) = 0;
+
+    for (; i < len && i < 4 && isxdigit((unsigned char)str[i]); i++) {
+        int digit = isdigit((unsigned char)str[i]) ? (str[i] - '0') : (tolower((unsigned char)str[i]) - 'a' + 10);
+        (*value) = (uint16_t)(((*value) << 4) | digit);
+    }
+
+    return i;
+}
+
+
+// Skip spaces and tabs, without going past the end of the line
+static size_t skipBlank(const char *line, size_t i, size_t len) {
+    for (; i < len && (line[i] == ' ' || line[i] == '\t'); i++);
+    return i;
+}
+
+
+// Replace the extension of an .obj filename, returns NULL if it has none
+static char *companionFile(const char *filename, const char *ext) {
+    const char *dot = strrchr(filename, '.');
+
+    if (dot == NULL || strchr(dot, '/') != NULL) {
+        return NULL;
+    }
+
+    size_t base = dot - filename;
+    char *ret = lc_malloc(base + strlen(ext) + 1);
+    memcpy(ret, filename, base);
+    strcpy(ret + base, ext);
+    return ret;
+}
+
+
+// Read lc3as symbol table lines, e.g. "//	LOOP             3001"
+static void readPattSymbols(LC3_SimInstance *sim, const char *text, size_t size) {
+    for (size_t start = 0, end = 0; start < size; start = end + 1) {
+        for (end = start; end < size && text[end] != '\n'; end++);
+
+        size_t i = skipBlank(text, start, end);
+
+        if (end - i < 2 || text[i] != '/' || text[i + 1] != '/') {
+            continue;
+        }
+
+        size_t nameStart = skipBlank(text, i + 2, end), nameEnd = nameStart;
+        for (; nameEnd < end && !isspace((unsigned char)text[nameEnd]); nameEnd++);
+
+        size_t addrStart = skipBlank(text, nameEnd, end), addrEnd = addrStart;
+        for (; addrEnd < end && !isspace((unsigned char)text[addrEnd]); addrEnd++);
+
+        // Header lines fail here, as their second column is not a hex address
+        uint16_t addr;
+
+        if (nameEnd == nameStart || addrEnd - addrStart != 4 || parseHexDigits(text + addrStart, 4, &addr) != 4 || skipBlank(text, addrEnd, end) < end) {
+            continue;
+        }
+
+        String name = newString();
+        for (size_t j = nameStart; j < nameEnd; addchar(&name, text[j]), j++);
+        LC3_AddSymbol(sim, addr, name.ptr);
+        lc_free(name.ptr);
+    }
+}
+
+
+// Read lc3as listing lines as debug strings, e.g. "(3001) 1261  0001001001100001 (   3) LOOP ADD R1,R1,#1"
+// Only addresses loaded from the object file are used, which skips the .ORIG line
+static void readPattListing(LC3_SimInstance *sim, const char *text, size_t size, uint16_t orig, uint32_t count) {
+    for (size_t start = 0, end = 0; start < size; start = end + 1) {
+        for (end = start; end < size && text[end] != '\n'; end++);
+
+        size_t i = skipBlank(text, start, end);
+        uint16_t addr;
+
+        if (i >= end || text[i] != '(' || parseHexDigits(text + i + 1, end - i - 1, &addr) != 4 || i + 5 >= end || text[i + 5] != ')') {
+            continue;
+        }
+
+        // Source text follows the parenthesised line number
+        const char *close = memchr(text + i + 6, '(', end - i - 6);
+        close = (close != NULL) ? memchr(close, ')', end - (close - text)) : NULL;
+
+        if (close == NULL || (uint16_t)(addr - orig) >= count) {
+            continue;
+        }
+
+        size_t srcStart = skipBlank(text, close - text + 1, end), srcEnd = end;
+        for (; srcEnd > srcStart && isspace((unsigned char)text[srcEnd - 1]); srcEnd--);
+
+        if (srcStart == srcEnd) {
+            continue;
+        }
+
+        String debug = newString();
+        for (size_t j = srcStart; j < srcEnd; addchar(&debug, text[j] == '\t' ? ' ' : text[j]), j++);
+        LC3_SetDebugString(sim, addr, debug);
+    }
+}
+
+
+// Read a companion file of an .obj file, if it exists
+static void readPattCompanion(LC3_SimInstance *sim, const char *filename, const char *ext, uint16_t orig, uint32_t count) {
+    char *path = companionFile(filename, ext);
+    size_t size = 0;
+    const uint8_t *data = (path != NULL) ? mapFile(path, &size) : NULL;
+
+    if (data != NULL && strcmp(ext, ".sym") == 0) {
+        readPattSymbols(sim, (const char *)data, size);
+    } else if (data != NULL) {
+        readPattListing(sim, (const char *)data, size, orig, count);
+    }
+
+    if (data != NULL) {
+        unmapFile(data, size);
+    }
+
+    lc_free(path);
+}
+
+
+// Load Patt/Patel object file (.obj): big-endian origin, followed by big-endian words
+// Symbols and debug strings are taken from .sym and .lst files next to it
+static void loadExecutablePatt(LC3_SimInstance *sim, const char *filename) {
+    size_t size = 0;
+    const uint8_t *data = mapFile(filename, &size);
+
+    if (data == NULL) {
+        sim->error = "failed to read file";
+        return;
+    }
+
+    uint16_t orig = (size >= 2) ? (uint16_t)((data[0] << 8) | data[1]) : 0;
+    uint32_t count = (size >= 2) ? (size - 2) / 2 : 0;
+
+    if (size < 2 || size % 2 != 0) {
+        sim->error = "object file is not a whole number of words";
+    } else if ((uint32_t)orig + count > LC3_MEM_SIZE) {
+        sim->error = "instructions out of memory range!";
+    }
+
+    if (sim->error != NULL) {
+        unmapFile(data, size);
+        return;
+    }
+
+    // Swap the whole file at once, memory cells are not plain words so they are filled afterwards
+    uint16_t *words = lc_malloc(LC3_MEM_SIZE * sizeof(uint16_t));
+    convertWords(words, data + 2, count, true);
+    unmapFile(data, size);
+
+    sim->reg.PC = orig;
+
+    for (uint32_t i = 0; i < count; i++) {
+        sim->memory[orig + i].value = (int16_t)words[i];
+        LC3_MarkDirty(sim, orig + i);
+    }
+
+    lc_free(words);
+    readPattCompanion(sim, filename, ".sym", orig, count);
+    readPattCompanion(sim, filename, ".lst", orig, count);
+}
+
+
 enum LC3_FileType {
     LC3_UnknownFile,
     LC3_MYLC3A_File, // https://github.com/beeldscherm/lc3-assembler .lc3 format
     LC3_LC3TV1_File, // https://github.com/chiragsakhuja/lc3tools .obj format
+    LC3_PATTOBJ_File, // Patt/Patel lc3as .obj format (no magic number, recognised by extension)
 };
 
 
@@ -177,12 +340,16 @@ enum LC3_FileType getFileType(const char *filename) {
     }
 
     uint8_t magic[8] = {0};
-    READ_SAFE(magic, 1, sizeof(magic), fp, fclose(fp); return type);
-    
-    if (memcmp(magic, "LC3\x03", 4) == 0) {
+    size_t n = fread(magic, 1, sizeof(magic), fp);
+    const char *ext = strrchr(filename, '.');
+    fclose(fp);
+
+    if (n >= 4 && memcmp(magic, "LC3\x03", 4) == 0) {
         type = LC3_MYLC3A_File;
-    } else if (memcmp(magic, "\x1c\x30\x15\xc0\x01\x01\x01", 7) == 0) {
+    } else if (n >= 7 && memcmp(magic, "\x1c\x30\x15\xc0\x01\x01\x01", 7) == 0) {
         type = LC3_LC3TV1_File;
+    } else if (n >= 2 && ext != NULL && strcmp(ext, ".obj") == 0) {
+        type = LC3_PATTOBJ_File;
     }
 
     return type;
@@ -209,6 +376,9 @@ void LC3_LoadExecutable(LC3_SimInstance *sim, const char *filename) {
         case LC3_LC3TV1_File:
             loadExecutableLC3T(sim, fp);
             break;
+        case LC3_PATTOBJ_File:
+            loadExecutablePatt(sim, filename);
+            break;
         default:
             break;
     }
@@ -219,39 +389,12 @@ void LC3_LoadExecutable(LC3_SimInstance *sim, const char *filename) {
 
 
 // Saving/loading simulator state
+// Files in the old format can still be loaded, new files are always written as snapshots (see lc3_snap.h)
 static bool isEmpty(const LC3_MemoryCell cell) {
     return (cell.value == 0) && (cell.debugIndex == 0) && (cell.hasDebug == 0) && (cell.breakpoint == 0);
 }
 
 
-static void writeMemory(LC3_SimInstance *sim, FILE *fp) {
-    LC3_MemoryCell *empty = lc_calloc(1, sizeof(LC3_MemoryCell));
-    int chunkCounter = 0;
-
-    for (int i = 0; i < LC3_MEM_SIZE; i++) {
-        if (isEmpty(sim->memory[i])) {
-            chunkCounter++;
-        } else {
-            if (chunkCounter > 0) {
-                fwrite(empty, sizeof(LC3_MemoryCell), 1, fp);
-                fwrite(&chunkCounter, sizeof(int), 1, fp);
-                chunkCounter = 0;
-            }
-
-            fwrite(&sim->memory[i], sizeof(LC3_MemoryCell), 1, fp);
-        }
-    }
-
-    if (chunkCounter > 0) {
-        fwrite(empty, sizeof(LC3_MemoryCell), 1, fp);
-        fwrite(&chunkCounter, sizeof(int), 1, fp);
-    }
-
-    lc_free(empty);
-    return;
-}
-
-
 static int readMemory(LC3_SimInstance *sim, FILE *fp) {
     LC3_MemoryCell current = {0};
     int chunkCounter = 0;
@@ -261,7 +404,7 @@ static int readMemory(LC3_SimInstance *sim, FILE *fp) {
 
         if (isEmpty(current)) {
             READ_SAFE(&chunkCounter, sizeof(int), 1, fp, return 1);
-            CHECK(i + chunkCounter < LC3_MEM_SIZE, return 1);
+            CHECK(chunkCounter > 0 && i + chunkCounter <= LC3_MEM_SIZE, return 1);
             memset(sim->memory + i, 0, chunkCounter * sizeof(LC3_MemoryCell));
             i += chunkCounter;
         } else {
@@ -274,37 +417,18 @@ static int readMemory(LC3_SimInstance *sim, FILE *fp) {
 }
 
 
-int LC3_SaveSimulatorState(LC3_SimInstance *sim, const char *filename) {
-    FILE *fp = fopen(filename, "wb");
-
-    if (fp == NULL) {
-        sim->error = "Failed to open file!";
+int LC3_SaveSimulatorState(LC3_SimInstance *sim, const char *filename, const char *base) {
+    if (LC3_SaveSnapshot(sim, filename, base) != 0) {
+        sim->error = "Failed to write file!";
         return 1;
     }
 
-    // Save some space in case any variables are added
-    uint8_t buffer[48] = {0};
-    memcpy(buffer, &sim->reg, sizeof(LC3_Registers));
-
-    fwrite(buffer, 1, sizeof(buffer), fp);
-    writeMemory(sim, fp);
-    fwrite(&sim->debug.sz, sizeof(int), 1, fp);
-
-    for (int i = 0; i < sim->debug.sz; i++) {
-        printString(fp, sim->debug.ptr[i]);
-    }
-
-    // Other variables
-    fwrite(&sim->flags, sizeof(uint32_t), 1, fp);
-    fwrite(&sim->counter, sizeof(size_t), 1, fp);
-    fwrite(&sim->c2, sizeof(size_t), 1, fp);
-
-    fclose(fp);
     return 0;
 }
 
 
-int LC3_LoadSimulatorState(LC3_SimInstance *sim, const char *filename) {
+// Load state saved before the snapshot format existed
+static int loadSimulatorStateV1(LC3_SimInstance *sim, const char *filename) {
     FILE *fp = fopen(filename, "rb");
 
     if (fp == NULL) {
@@ -317,7 +441,7 @@ int LC3_LoadSimulatorState(LC3_SimInstance *sim, const char *filename) {
     READ_SAFE(buffer, 1, sizeof(buffer), fp, fclose(fp); return 1);
 
     sim->reg = *((LC3_Registers *)buffer);
-    CHECK(readMemory(sim, fp) != 0, fclose(fp); return 1);
+    CHECK(readMemory(sim, fp) == 0, fclose(fp); return 1);
 
     int dsz = 0;
     READ_SAFE(&dsz, sizeof(int), 1, fp, fclose(fp); return 1);
@@ -338,3 +462,31 @@ int LC3_LoadSimulatorState(LC3_SimInstance *sim, const char *filename) {
     fclose(fp);
     return 0;
 }
+
+
+int LC3_LoadSimulatorState(LC3_SimInstance *sim, const char *filename) {
+    if (!LC3_IsSnapshotFile(filename)) {
+        // Read into a copy, so a file failing halfway through leaves sim untouched
+        LC3_SimInstance loaded = LC3_CreateSimInstance();
+        LC3_CopySimState(&loaded, sim, 0);
+        int ret = loadSimulatorStateV1(&loaded, filename);
+
+        if (ret == 0) {
+            LC3_CopySimState(sim, &loaded, 0);
+            LC3_MarkAllDirty(sim);
+            LC3_CountBreakpoints(sim);
+        } else {
+            sim->error = loaded.error;
+        }
+
+        LC3_DestroySimInstance(loaded);
+        return ret;
+    }
+
+    if (LC3_LoadSnapshot(sim, filename) != 0) {
+        sim->error = "Invalid snapshot file!";
+        return 1;
+    }
+
+    return 0;
+}
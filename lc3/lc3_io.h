@@ -9,8 +9,9 @@ void LC3_LoadExecutable(LC3_SimInstance *sim, const char *filename);
 
 /*
  * Save simulator state
+ * If base is not NULL, only the changes since the state saved in base are written
  */
-int LC3_SaveSimulatorState(LC3_SimInstance *sim, const char *filename);
+int LC3_SaveSimulatorState(LC3_SimInstance *sim, const char *filename, const char *base);
 
 /*
  * Load simulator state
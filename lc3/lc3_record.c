@@ -0,0 +1,202 @@
+#include "lc3_record.h"
+#include "lc3_snap.h"
+
+#define RECORD_MAGIC       "LC3R"
+#define RECORD_HEADER_SIZE (16)
+
+
+// Encode n as LEB128, returns the end of the encoded bytes
+static uint8_t *putVarint(uint8_t *p, uint64_t n) {
+    for (; n >= 0x80; *(p++) = (n & 0x7F) | 0x80, n >>= 7);
+    *(p++) = n;
+    return p;
+}
+
+
+// Decode a LEB128 value at *pos, returns 0 on success
+static int getVarint(const uint8_t *data, size_t size, size_t *pos, uint64_t *n) {
+    (*n) = 0;
+
+    for (int shift = 0; *pos < size && shift < 64; shift += 7) {
+        uint8_t b = data[(*pos)++];
+        (*n) |= (uint64_t)(b & 0x7F) << shift;
+
+        if (!(b & 0x80)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+LC3_Recorder *LC3_StartRecording(const LC3_SimInstance *sim, const char *filename) {
+    FILE *fp = fopen(filename, "wb");
+
+    if (fp == NULL) {
+        return NULL;
+    }
+
+    ByteArray head = newByteArray();
+    addBytes(&head, RECORD_MAGIC, 4);
+    addU16(&head, LC3_RECORD_VERSION);
+    addU16(&head, 0);
+    addU64(&head, 0);
+
+    // The snapshot size is only known after encoding it behind the header
+    LC3_EncodeSnapshot(sim, &head);
+    size_t snapSize = head.sz - RECORD_HEADER_SIZE;
+    for (int i = 0; i < 8; head.ptr[8 + i] = (snapSize >> (8 * i)) & 0xFF, i++);
+
+    LC3_Recorder *ret = lc_malloc(sizeof(LC3_Recorder));
+    ret->fp = fp;
+    ret->counter = sim->counter;
+    ret->failed = fwrite(head.ptr, 1, head.sz, fp) != head.sz;
+
+    lc_free(head.ptr);
+    return ret;
+}
+
+
+int LC3_StopRecording(LC3_Recorder *rec, const LC3_SimInstance *sim) {
+    LC3_RecordEvent(rec, LC3_RECORD_END, sim->counter, NULL, 0);
+
+    int ret = rec->failed;
+    ret |= fclose(rec->fp) != 0;
+    lc_free(rec);
+    return ret;
+}
+
+
+void LC3_RecordEvent(LC3_Recorder *rec, LC3_RecordType type, uint64_t counter, const char *data, size_t n) {
+    uint8_t head[24], *p = head;
+
+    // Undone instructions cannot be replayed, the event is kept at the last instruction recorded
+    *(p++) = type;
+    p = putVarint(p, (counter > rec->counter) ? counter - rec->counter : 0);
+    rec->counter = (counter > rec->counter) ? counter : rec->counter;
+
+    if (type == LC3_RECORD_QUEUE) {
+        p = putVarint(p, n);
+    }
+
+    rec->failed |= fwrite(head, 1, p - head, rec->fp) != (size_t)(p - head);
+
+    if (n > 0) {
+        rec->failed |= fwrite(data, 1, n, rec->fp) != n;
+    }
+}
+
+
+void LC3_RecordQueued(LC3_SimInstance *sim, size_t from) {
+    size_t sz = VQ_SZ(sim->inputs);
+
+    if (sim->recorder == NULL || sz <= from) {
+        return;
+    }
+
+    char *queued = lc_malloc(sz - from);
+    for (size_t i = from; i < sz; queued[i - from] = VQ_EL(sim->inputs, i), i++);
+
+    LC3_RecordEvent(sim->recorder, LC3_RECORD_QUEUE, sim->counter, queued, sz - from);
+    lc_free(queued);
+}
+
+
+// Run until instruction target, returns 1 if the simulator halts before it
+static int runTo(LC3_SimInstance *sim, uint64_t target) {
+    while (sim->counter < target) {
+        size_t before = sim->counter;
+        sim->flags &= ~LC3_SIM_HALTED;
+        LC3_UntilBreakpoint(sim, target - sim->counter);
+
+        if (sim->counter == before) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+int LC3_Replay(LC3_SimInstance *sim, const char *filename, char *error, size_t errorSz) {
+    size_t size = 0, pos = RECORD_HEADER_SIZE;
+    const uint8_t *data = mapFile(filename, &size);
+    uint64_t counter = 0, n = 0;
+    int ret = 1;
+
+    if (data == NULL || size < RECORD_HEADER_SIZE || memcmp(data, RECORD_MAGIC, 4) != 0) {
+        snprintf(error, errorSz, "not a recording");
+        goto end;
+    } else if (readU16(data + 4) != LC3_RECORD_VERSION) {
+        snprintf(error, errorSz, "unsupported recording version");
+        goto end;
+    } else if (readU64(data + 8) > size - pos || LC3_DecodeSnapshot(sim, data + pos, readU64(data + 8)) != 0) {
+        snprintf(error, errorSz, "corrupt snapshot in recording");
+        goto end;
+    }
+
+    pos += readU64(data + 8);
+    counter = sim->counter;
+
+    // A recording that was never stopped ends after its last complete event
+    while (pos < size) {
+        uint8_t type = data[pos++];
+
+        if (getVarint(data, size, &pos, &n) != 0) {
+            snprintf(error, errorSz, "corrupt event in recording");
+            goto end;
+        }
+
+        counter += n;
+
+        if (runTo(sim, counter) != 0) {
+            snprintf(error, errorSz, "halted at instruction %zu, before the event at %llu", sim->counter, (unsigned long long)counter);
+            goto end;
+        }
+
+        switch (type) {
+            case LC3_RECORD_QUEUE:
+                if (getVarint(data, size, &pos, &n) != 0 || n > size - pos) {
+                    snprintf(error, errorSz, "corrupt event in recording");
+                    goto end;
+                }
+
+                for (; n > 0; LC3_QueueInput(&sim->inputs, (char)data[pos++]), n--);
+                break;
+
+            case LC3_RECORD_CLEAR:
+                sim->inputs.hd = sim->inputs.tl = 0;
+                break;
+
+            // The next instruction reads a character, which has to be the recorded one
+            case LC3_RECORD_READ:
+                if (pos >= size) {
+                    snprintf(error, errorSz, "corrupt event in recording");
+                    goto end;
+                } else if (VQ_SZ(sim->inputs) == 0 || (uint8_t)VQ_EL(sim->inputs, 0) != data[pos]) {
+                    snprintf(error, errorSz, "input read at instruction %llu differs", (unsigned long long)counter);
+                    goto end;
+                }
+
+                pos++;
+                break;
+
+            case LC3_RECORD_END:
+                pos = size;
+                break;
+
+            default:
+                snprintf(error, errorSz, "corrupt event in recording");
+                goto end;
+        }
+    }
+
+    ret = 0;
+
+    end:
+        // Halted where the replay stopped, so it can be inspected
+        sim->flags |= LC3_SIM_HALTED;
+        unmapFile(data, size);
+        return ret;
+}
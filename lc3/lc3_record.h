@@ -0,0 +1,66 @@
+#pragma once
+#include <stdio.h>
+#include "lc3_sim.h"
+
+/*
+ * Input recording format
+ *
+ * The file starts with a header: "LC3R", u16 version, u16 reserved, u64 snapshot size
+ * It is followed by a full snapshot of the simulator when recording started (see lc3_snap.h), and then one record per event:
+ *
+ *      u8 type         | One of LC3_RecordType
+ *      varint          | Instructions executed since the previous event (or the start)
+ *      [varint, u8...] | Amount of characters and the characters (QUEUE)
+ *      [u8]            | Character read (READ)
+ *
+ * Multi-byte values are little-endian, varints are LEB128
+ */
+
+#define LC3_RECORD_VERSION (1)
+
+typedef enum LC3_RecordType {
+    LC3_RECORD_QUEUE = 1,           // Input queued by input or inputfile
+    LC3_RECORD_CLEAR = 2,           // Queued input removed by noinput
+    LC3_RECORD_READ  = 3,           // Character read by a GETC or IN TRAP
+    LC3_RECORD_END   = 4,           // Recording stopped
+} LC3_RecordType;
+
+
+// Records the input of a simulator
+typedef struct LC3_Recorder {
+    FILE *fp;                       // Output file
+    uint64_t counter;               // Instruction counter of the previous event
+    bool failed;                    // Whether a write failed
+} LC3_Recorder;
+
+
+/*
+ * Start recording into filename, starting from the current state of sim
+ * Returns NULL if the file could not be written
+ * Should be stopped with LC3_StopRecording
+ */
+LC3_Recorder *LC3_StartRecording(const LC3_SimInstance *sim, const char *filename);
+
+/*
+ * Record the end at the current instruction of sim, close the file and deallocate the recorder
+ * Returns 0 if all events were written
+ */
+int LC3_StopRecording(LC3_Recorder *rec, const LC3_SimInstance *sim);
+
+/*
+ * Record an event at instruction counter, data holds the n characters of QUEUE and READ events
+ */
+void LC3_RecordEvent(LC3_Recorder *rec, LC3_RecordType type, uint64_t counter, const char *data, size_t n);
+
+/*
+ * Record the input queued since the queue of sim held from characters, if sim is recording
+ */
+void LC3_RecordQueued(LC3_SimInstance *sim, size_t from);
+
+/*
+ * Reset sim to the state in the recording filename and run it to where recording stopped, queueing input at the
+ * recorded instructions. Runs stop early if a character read differs from the recording, or the simulator halts
+ * without reaching the next event
+ * Returns 0 if the run was reproduced, otherwise error describes why not
+ */
+int LC3_Replay(LC3_SimInstance *sim, const char *filename, char *error, size_t errorSz);
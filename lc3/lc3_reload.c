@@ -0,0 +1,335 @@
+#include "lc3_reload.h"
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include "lc3_diff.h"
+#include "lc3_io.h"
+
+
+// Watched file list functions
+vaAllocFunction(LC3_WatchedFiles, LC3_WatchedFile, newWatchedFiles, ;, ;)
+vaAppendFunction(LC3_WatchedFiles, LC3_WatchedFile, addWatchedFile, ;, ;)
+vaFreeFunction(LC3_WatchedFiles, LC3_WatchedFile, freeWatchedFiles, lc_free(el.path.ptr), ;, ;)
+
+
+static String copyPath(const char *path, size_t len) {
+    String ret = newString();
+    for (size_t i = 0; i < len; addchar(&ret, path[i]), i++);
+    return ret;
+}
+
+
+// Whether an inotify event for name in the directory of wd concerns file
+static bool concernsFile(const LC3_WatchedFile *file, int wd, const char *name) {
+    const char *slash = strrchr(file->path.ptr, '/');
+    const char *base = (slash != NULL) ? slash + 1 : file->path.ptr;
+    const char *ext = strrchr(base, '.');
+
+    if (file->wd != wd) {
+        return false;
+    } else if (strcmp(base, name) == 0) {
+        return true;
+    }
+
+    // Companions of textbook object files
+    size_t stem = (ext != NULL) ? (size_t)(ext - base) : 0;
+    return ext != NULL && strcmp(ext, ".obj") == 0 && strncmp(base, name, stem) == 0 &&
+           (strcmp(name + stem, ".sym") == 0 || strcmp(name + stem, ".lst") == 0);
+}
+
+
+// Read pending inotify events, returns whether any of them concerns a watched file
+static bool readEvents(LC3_Reloader *rl) {
+    union {
+        struct inotify_event event;
+        char buf[4096];
+    } events;
+
+    bool relevant = false;
+    ssize_t n;
+
+    while ((n = read(rl->inotifyFd, events.buf, sizeof(events.buf))) > 0) {
+        pthread_mutex_lock(&rl->lock);
+
+        for (ssize_t i = 0; i < n;) {
+            const struct inotify_event *event = (const struct inotify_event *)(events.buf + i);
+
+            for (size_t j = 0; j < rl->files.sz && event->len > 0 && !relevant; j++) {
+                relevant = concernsFile(&rl->files.ptr[j], event->wd, event->name);
+            }
+
+            i += sizeof(struct inotify_event) + event->len;
+        }
+
+        pthread_mutex_unlock(&rl->lock);
+    }
+
+    return relevant;
+}
+
+
+// Load every watched file into a fresh simulator, and hand it to the owner
+static void reloadFiles(LC3_Reloader *rl) {
+    StringArray paths = newStringArray();
+
+    pthread_mutex_lock(&rl->lock);
+    uint32_t generation = rl->generation;
+
+    for (size_t i = 0; i < rl->files.sz; i++) {
+        addString(&paths, copyPath(rl->files.ptr[i].path.ptr, rl->files.ptr[i].path.sz));
+    }
+
+    pthread_mutex_unlock(&rl->lock);
+
+    LC3_SimInstance *fresh = lc_malloc(sizeof(LC3_SimInstance));
+    (*fresh) = LC3_CreateSimInstance();
+
+    for (size_t i = 0; i < paths.sz && fresh->error == NULL; i++) {
+        LC3_LoadExecutable(fresh, paths.ptr[i].ptr);
+    }
+
+    freeStringArray(paths);
+
+    pthread_mutex_lock(&rl->lock);
+
+    if (rl->pending != NULL) {
+        LC3_DestroySimInstance(*rl->pending);
+        lc_free(rl->pending);
+    }
+
+    rl->pending = fresh;
+    rl->pendingGeneration = generation;
+    pthread_mutex_unlock(&rl->lock);
+
+    uint64_t one = 1;
+    write(rl->readyFd, &one, sizeof(one));
+}
+
+
+static void *reloadThread(void *arg) {
+    LC3_Reloader *rl = arg;
+    struct pollfd fds[2] = {
+        {rl->inotifyFd, POLLIN, 0},
+        {rl->quitFd, POLLIN, 0},
+    };
+
+    while (!(fds[1].revents & POLLIN)) {
+        if (poll(fds, 2, -1) < 0 || !(fds[0].revents & POLLIN) || !readEvents(rl)) {
+            continue;
+        }
+
+        // Wait until the files stop changing
+        while (poll(fds, 1, LC3_RELOAD_SETTLE_MS) > 0) {
+            readEvents(rl);
+        }
+
+        reloadFiles(rl);
+    }
+
+    return NULL;
+}
+
+
+// Close and deallocate everything of rl, its thread should not be running
+static void freeReloader(LC3_Reloader *rl) {
+    close(rl->inotifyFd);
+    close(rl->readyFd);
+    close(rl->quitFd);
+    pthread_mutex_destroy(&rl->lock);
+
+    if (rl->pending != NULL) {
+        LC3_DestroySimInstance(*rl->pending);
+        lc_free(rl->pending);
+    }
+
+    freeWatchedFiles(rl->files);
+    LC3_DestroySimInstance(rl->loaded);
+    lc_free(rl);
+}
+
+
+LC3_Reloader *LC3_CreateReloader(void) {
+    LC3_Reloader *rl = lc_malloc(sizeof(LC3_Reloader));
+
+    rl->inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    rl->readyFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    rl->quitFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    rl->files = newWatchedFiles();
+    rl->generation = 0;
+    rl->pending = NULL;
+    rl->pendingGeneration = 0;
+    rl->loaded = LC3_CreateSimInstance();
+
+    // Signals are left to the other threads, the TUI reads SIGWINCH through a signalfd
+    sigset_t all, oldMask;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &oldMask);
+
+    pthread_mutex_init(&rl->lock, NULL);
+    int err = pthread_create(&rl->thread, NULL, reloadThread, rl);
+    pthread_sigmask(SIG_SETMASK, &oldMask, NULL);
+
+    if (err != 0) {
+        freeReloader(rl);
+        return NULL;
+    }
+
+    return rl;
+}
+
+
+void LC3_DestroyReloader(LC3_Reloader *rl) {
+    if (rl == NULL) {
+        return;
+    }
+
+    uint64_t one = 1;
+    write(rl->quitFd, &one, sizeof(one));
+    pthread_join(rl->thread, NULL);
+    freeReloader(rl);
+}
+
+
+void LC3_WatchFile(LC3_Reloader *rl, const char *filename) {
+    // Editors often save by replacing the file, so its directory is watched instead
+    const char *slash = strrchr(filename, '/');
+    String dir = (slash == NULL) ? copyPath(".", 1) : copyPath(filename, (slash == filename) ? 1 : (size_t)(slash - filename));
+    int wd = inotify_add_watch(rl->inotifyFd, dir.ptr, IN_CLOSE_WRITE | IN_MOVED_TO);
+    lc_free(dir.ptr);
+
+    if (wd < 0) {
+        return;
+    }
+
+    LC3_WatchedFile file = {copyPath(filename, strlen(filename)), wd};
+
+    pthread_mutex_lock(&rl->lock);
+    addWatchedFile(&rl->files, file);
+    rl->generation++;
+    pthread_mutex_unlock(&rl->lock);
+
+    LC3_LoadExecutable(&rl->loaded, filename);
+    rl->loaded.error = NULL;
+}
+
+
+void LC3_ForgetFiles(LC3_Reloader *rl) {
+    pthread_mutex_lock(&rl->lock);
+
+    for (size_t i = 0; i < rl->files.sz; i++) {
+        inotify_rm_watch(rl->inotifyFd, rl->files.ptr[i].wd);
+    }
+
+    freeWatchedFiles(rl->files);
+    rl->files = newWatchedFiles();
+    rl->generation++;
+    pthread_mutex_unlock(&rl->lock);
+
+    LC3_DestroySimInstance(rl->loaded);
+    rl->loaded = LC3_CreateSimInstance();
+}
+
+
+bool LC3_ReloadPending(LC3_Reloader *rl) {
+    pthread_mutex_lock(&rl->lock);
+    bool ret = (rl->pending != NULL);
+    pthread_mutex_unlock(&rl->lock);
+    return ret;
+}
+
+
+static const char *debugString(const LC3_SimInstance *sim, uint16_t addr) {
+    return sim->memory[addr].hasDebug ? sim->debug.ptr[sim->memory[addr].debugIndex].ptr : NULL;
+}
+
+
+static bool sameSymbols(const LC3_SymbolTable *a, const LC3_SymbolTable *b) {
+    if (a->sz != b->sz) {
+        return false;
+    }
+
+    for (size_t i = 0; i < a->sz; i++) {
+        if (a->ptr[i].addr != b->ptr[i].addr || strcmp(a->ptr[i].name.ptr, b->ptr[i].name.ptr) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+// Write what changed between the loaded files old and cur into dst
+static void patchInstance(LC3_SimInstance *dst, const LC3_SimInstance *old, const LC3_SimInstance *cur, const LC3_DiffRanges *ranges) {
+    for (size_t i = 0; i < ranges->sz; i++) {
+        for (uint32_t j = 0; j < ranges->ptr[i].len; j++) {
+            uint16_t addr = ranges->ptr[i].start + j;
+            dst->memory[addr].value = cur->memory[addr].value;
+            LC3_MarkDirty(dst, addr);
+        }
+    }
+
+    for (uint32_t addr = 0; addr < LC3_MEM_SIZE; addr++) {
+        const char *before = debugString(old, addr), *after = debugString(cur, addr);
+
+        if (after == NULL && before != NULL) {
+            LC3_ClearDebugString(dst, addr);
+        } else if (after != NULL && (before == NULL || strcmp(before, after) != 0)) {
+            String debug = copyPath(after, strlen(after));
+            LC3_SetDebugString(dst, addr, debug);
+        }
+    }
+
+    if (!sameSymbols(&old->symbols, &cur->symbols)) {
+        for (size_t i = 0; i < old->symbols.sz; i++) {
+            LC3_RemoveSymbol(dst, old->symbols.ptr[i].addr, old->symbols.ptr[i].name.ptr);
+        }
+
+        for (size_t i = 0; i < cur->symbols.sz; i++) {
+            LC3_AddSymbol(dst, cur->symbols.ptr[i].addr, cur->symbols.ptr[i].name.ptr);
+        }
+    }
+}
+
+
+int32_t LC3_ApplyReload(LC3_Reloader *rl, LC3_SimInstance *sim, LC3_SimInstance *image) {
+    pthread_mutex_lock(&rl->lock);
+    LC3_SimInstance *fresh = rl->pending;
+    bool stale = (rl->pendingGeneration != rl->generation);
+    rl->pending = NULL;
+    pthread_mutex_unlock(&rl->lock);
+
+    int32_t ret = 0;
+
+    if (fresh == NULL) {
+        return 0;
+    } else if (fresh->error != NULL) {
+        // Error strings are literals, they outlive the instance
+        sim->error = fresh->error;
+        ret = -1;
+    } else if (!stale) {
+        LC3_DiffRanges ranges = LC3_DiffMemory(rl->loaded.memory, fresh->memory, NULL);
+
+        patchInstance(sim, &rl->loaded, fresh, &ranges);
+
+        if (image != NULL) {
+            patchInstance(image, &rl->loaded, fresh, &ranges);
+        }
+
+        for (size_t i = 0; i < ranges.sz; i++) {
+            ret += ranges.ptr[i].len;
+        }
+
+        lc_free(ranges.ptr);
+
+        // The fresh files become the new reference
+        LC3_SimInstance swap = rl->loaded;
+        rl->loaded = (*fresh);
+        (*fresh) = swap;
+    }
+
+    LC3_DestroySimInstance(*fresh);
+    lc_free(fresh);
+    return ret;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <pthread.h>
+#include "lc3_sim.h"
+
+// How long files have to stay unchanged before they are reloaded, editors often write in several steps
+#define LC3_RELOAD_SETTLE_MS (50)
+
+
+// Executable loaded with read, watched for changes
+typedef struct LC3_WatchedFile {
+    String path;                    // Path as given to read
+    int wd;                         // Inotify watch of its directory
+} LC3_WatchedFile;
+
+vaTypedef(LC3_WatchedFile, LC3_WatchedFiles);
+
+
+/*
+ * Reloads executables when they change on disk
+ *
+ * The reload thread loads every watched file into a fresh simulator once one of them changes.
+ * The owner of the simulator then patches the words and debug strings that differ from the previously
+ * loaded files into it, at an instruction boundary, leaving everything else as it is.
+ */
+typedef struct LC3_Reloader {
+    pthread_t thread;               // Reload thread
+    int inotifyFd;                  // Watches the directories of the files
+    int readyFd;                    // Eventfd written when a reload is pending
+    int quitFd;                     // Eventfd that stops the reload thread
+    pthread_mutex_t lock;           // Protects the fields below
+    LC3_WatchedFiles files;         // Watched files, in the order they were read
+    uint32_t generation;            // Incremented whenever files changes
+    LC3_SimInstance *pending;       // Reloaded files waiting to be applied, NULL if none
+    uint32_t pendingGeneration;     // Generation of files that pending was loaded from
+    LC3_SimInstance loaded;         // The files as they were applied last, only used by the owner
+} LC3_Reloader;
+
+
+/*
+ * Allocate a reloader and start its thread, returns NULL if the thread could not be started
+ * Should be destroyed using LC3_DestroyReloader
+ */
+LC3_Reloader *LC3_CreateReloader(void);
+
+/*
+ * Stop the reload thread and deallocate the reloader, rl may be NULL
+ */
+void LC3_DestroyReloader(LC3_Reloader *rl);
+
+/*
+ * Watch a file that was just loaded into the simulator
+ * For Patt/Patel .obj files, the .sym and .lst files next to them are watched too
+ */
+void LC3_WatchFile(LC3_Reloader *rl, const char *filename);
+
+/*
+ * Stop watching all files, for when the simulator is cleared
+ */
+void LC3_ForgetFiles(LC3_Reloader *rl);
+
+/*
+ * Check whether a reload is waiting to be applied
+ */
+bool LC3_ReloadPending(LC3_Reloader *rl);
+
+/*
+ * Patch the pending reload into sim, and into image if it is not NULL
+ * Only changed words, debug strings and symbols are written, registers and breakpoints are left alone
+ * Should be called at an instruction boundary
+ * Returns the amount of changed words, or -1 with sim->error set if a file failed to load
+ */
+int32_t LC3_ApplyReload(LC3_Reloader *rl, LC3_SimInstance *sim, LC3_SimInstance *image);
@@ -0,0 +1,172 @@
+#include "lc3_run.h"
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "lc3_io.h"
+#include "lib/cmdarg/cmdarg.h"
+
+
+static void addFile(LC3_RunConfig *cfg, const char *filename) {
+    String file = newString();
+    for (const char *at = filename; *at; addchar(&file, *at), at++);
+    addString(&cfg->files, file);
+}
+
+
+// Parse a limit given as a flag value, absent limits are negative
+static bool parseLimit(const char *value, int64_t *limit) {
+    char *end = NULL;
+
+    if (value == NULL) {
+        *limit = -1;
+        return true;
+    }
+
+    *limit = strtoll(value, &end, 0);
+    return end != value && *end == '\0' && *limit > 0;
+}
+
+
+LC3_RunConfig *LC3_ParseRunConfig(int argc, char **argv) {
+    enum Flag {
+        STDOUT = 0x01,
+    };
+
+    ca_config *config = ca_alloc_config();
+    ca_set_hasv(config, "--load");
+    ca_set_hasv(config, "--input");
+    ca_set_hasv(config, "--max-steps");
+    ca_set_hasv(config, "--timeout-ms");
+    ca_bind_flag(config, "--stdout", STDOUT);
+
+    ca_info *info = ca_parse(config, argc, argv);
+    LC3_RunConfig *ret = NULL;
+
+    if (ca_is_set(info, "--load")) {
+        size_t count = 0;
+        const char **literals = ca_literals(info, &count);
+        const char *first = ca_flag_value(info, "--load");
+        const char *input = ca_flag_value(info, "--input");
+
+        ret = lc_malloc(sizeof(LC3_RunConfig));
+        ret->files = newStringArray();
+        ret->input = (input != NULL) ? copyCString(input) : NULL;
+        ret->toStdout = (ca_flags(info) & STDOUT) > 0;
+        ret->valid = (first != NULL) && (ca_is_set(info, "--input") == (input != NULL));
+        ret->valid &= parseLimit(ca_flag_value(info, "--max-steps"), &ret->maxSteps);
+        ret->valid &= parseLimit(ca_flag_value(info, "--timeout-ms"), &ret->timeoutMs);
+
+        // Any further files follow the first one as literals
+        if (first != NULL) {
+            addFile(ret, first);
+        }
+
+        for (size_t i = 0; i < count; addFile(ret, literals[i]), i++);
+    }
+
+    ca_free_config(config);
+    ca_free_info(info);
+    return ret;
+}
+
+
+void LC3_DestroyRunConfig(LC3_RunConfig *cfg) {
+    freeStringArray(cfg->files);
+
+    if (cfg->input != NULL) {
+        lc_free(cfg->input);
+    }
+
+    lc_free(cfg);
+}
+
+
+static int64_t millisecondsSince(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+}
+
+
+// Load the executables and queue the input, returns false if any of them could not be read
+static bool prepare(const LC3_RunConfig *cfg, LC3_SimInstance *sim) {
+    for (size_t i = 0; i < cfg->files.sz; i++) {
+        LC3_LoadExecutable(sim, cfg->files.ptr[i].ptr);
+
+        if (sim->error != NULL) {
+            fprintf(stderr, "%s: %s\n", cfg->files.ptr[i].ptr, sim->error);
+            return false;
+        }
+    }
+
+    if (cfg->input == NULL) {
+        return true;
+    }
+
+    size_t size = 0;
+    const uint8_t *input = mapFile(cfg->input, &size);
+
+    // Empty files cannot be mapped, but are fine as input
+    if (input == NULL && access(cfg->input, R_OK) != 0) {
+        fprintf(stderr, "%s: failed to read file\n", cfg->input);
+        return false;
+    }
+
+    for (size_t i = 0; i < size; LC3_QueueInput(&sim->inputs, (char)input[i]), i++);
+
+    if (input != NULL) {
+        unmapFile(input, size);
+    }
+
+    return true;
+}
+
+
+int LC3_RunOnce(const LC3_RunConfig *cfg, LC3_SimInstance *sim) {
+    if (!cfg->valid) {
+        fprintf(stderr, "usage: lc3tui --load FILE [FILE...] [--input FILE] [--max-steps N] [--timeout-ms N] [--stdout]\n");
+        return LC3_RUN_USAGE;
+    }
+
+    if (!prepare(cfg, sim)) {
+        return LC3_RUN_FAILED;
+    }
+
+    // Program output goes straight to stdout, in large writes
+    if (cfg->toStdout) {
+        setvbuf(stdout, NULL, _IOFBF, LC3_RUN_BUFFER);
+        sim->stream = stdout;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    // Nothing is undone in a one-shot run
+    sim->flags &= ~LC3_SIM_HALTED;
+    sim->flags |= LC3_SIM_NO_HISTORY;
+
+    // Without a timeout there is nothing to check between instructions
+    int64_t chunk = (cfg->timeoutMs < 0) ? cfg->maxSteps : LC3_RUN_CHUNK;
+    int ret = LC3_RUN_HALTED;
+
+    while (!(sim->flags & LC3_SIM_HALTED)) {
+        int64_t left = cfg->maxSteps - (int64_t)sim->counter;
+
+        if (cfg->maxSteps >= 0 && left <= 0) {
+            ret = LC3_RUN_STEPS;
+            break;
+        } else if (cfg->timeoutMs >= 0 && millisecondsSince(start) >= cfg->timeoutMs) {
+            ret = LC3_RUN_TIMEOUT;
+            break;
+        }
+
+        LC3_UntilBreakpoint(sim, (cfg->maxSteps >= 0 && (chunk < 0 || left < chunk)) ? left : chunk);
+    }
+
+    if (ret == LC3_RUN_HALTED && LC3_WaitingForInput(sim)) {
+        ret = LC3_RUN_INPUT;
+    }
+
+    fflush(stdout);
+
+    return ret;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <stdio.h>
+#include "lc3_sim.h"
+
+// Instructions executed between timeout checks
+#define LC3_RUN_CHUNK (65536)
+
+// Size of the stdout buffer program output is written through
+#define LC3_RUN_BUFFER (65536)
+
+
+// Exit statuses of a one-shot run
+typedef enum LC3_RunStatus {
+    LC3_RUN_HALTED  = 0,            // Program halted
+    LC3_RUN_FAILED  = 1,            // A file could not be read
+    LC3_RUN_USAGE   = 2,            // Invalid arguments
+    LC3_RUN_STEPS   = 3,            // Maximum amount of instructions reached
+    LC3_RUN_TIMEOUT = 4,            // Timeout reached
+    LC3_RUN_INPUT   = 5,            // Program waits for input that is not there
+} LC3_RunStatus;
+
+
+// Settings of a one-shot run (--load)
+typedef struct LC3_RunConfig {
+    StringArray files;              // Executables, loaded in order
+    char *input;                    // File queued as input, NULL for none
+    int64_t maxSteps;               // Instructions the program may execute, negative for no limit
+    int64_t timeoutMs;              // Time the program may run, negative for no limit
+    bool toStdout;                  // Whether program output is written to stdout
+    bool valid;                     // Whether the arguments could be parsed
+} LC3_RunConfig;
+
+
+/*
+ * Parse the arguments of a one-shot run
+ * Returns NULL if --load is not given, so the TUI should be started instead
+ * Otherwise, the result should be destroyed using LC3_DestroyRunConfig
+ */
+LC3_RunConfig *LC3_ParseRunConfig(int argc, char **argv);
+
+/*
+ * Deallocate a run configuration
+ */
+void LC3_DestroyRunConfig(LC3_RunConfig *cfg);
+
+/*
+ * Load cfg->files into sim and run them until they halt, without any user interface
+ * Errors are written to stderr
+ * Returns an LC3_RunStatus
+ */
+int LC3_RunOnce(const LC3_RunConfig *cfg, LC3_SimInstance *sim);
@@ -0,0 +1,535 @@
+// epoll.h uses __packed__ itself, so it comes before the simulator headers that define it
+#include <sys/epoll.h>
+#include "lc3_serve.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "lc3_io.h"
+
+
+// Open sessions
+vaTypedef(LC3_Session *, LC3_Sessions);
+static vaAllocFunction(LC3_Sessions, LC3_Session *, newSessions, ;, ;)
+static vaAppendFunction(LC3_Sessions, LC3_Session *, addSession, ;, ;)
+
+
+// Client connection, only used by the thread its one shot event woke
+typedef struct Connection {
+    int fd;                         // Non-blocking socket
+    ByteArray in;                   // Received bytes not forming a complete request yet
+    ByteArray out;                  // Responses not sent yet, from outPos on
+    size_t outPos;
+} Connection;
+
+// Open connections
+vaTypedef(Connection *, Connections);
+static vaAllocFunction(Connections, Connection *, newConnections, ;, ;)
+static vaAppendFunction(Connections, Connection *, addConnection, ;, ;)
+
+
+// State shared by the server threads
+typedef struct Server {
+    int listenFd;
+    int epollFd;
+    int quitFd;                     // Eventfd that stays readable once the server stops
+    pthread_mutex_t lock;           // Protects the fields below
+    LC3_Sessions sessions;          // Open sessions
+    Connections connections;        // Open connections, closed by the server when it stops
+    uint32_t nextId;                // Identifier of the next session
+} Server;
+
+
+// Request being handled
+typedef struct Request {
+    const uint8_t *args;            // Arguments after the operation and session
+    size_t argSz;                   // Size of the arguments
+    ByteArray response;             // Response body, starting with the status
+} Request;
+
+
+static LC3_Session *createSession(uint32_t id) {
+    LC3_Session *s = lc_malloc(sizeof(LC3_Session));
+    s->id = id;
+    s->sim = LC3_CreateSimInstance();
+    s->sim.flags |= LC3_SIM_NO_HISTORY;     // The protocol has no undo
+    s->output = NULL;
+    s->outputSz = 0;
+    s->dropped = 0;
+    s->sim.outf = open_memstream(&s->output, &s->outputSz);
+    s->users = 0;
+    s->closed = false;
+    pthread_mutex_init(&s->lock, NULL);
+    return s;
+}
+
+
+static void destroySession(LC3_Session *s) {
+    // Closes the memstream, its buffer is freed separately
+    LC3_DestroySimInstance(s->sim);
+    free(s->output);
+    pthread_mutex_destroy(&s->lock);
+    lc_free(s);
+}
+
+
+// Get a session and hold a reference to it, or NULL if it does not exist
+static LC3_Session *acquireSession(Server *srv, uint32_t id) {
+    LC3_Session *ret = NULL;
+    pthread_mutex_lock(&srv->lock);
+
+    for (size_t i = 0; i < srv->sessions.sz && ret == NULL; i++) {
+        ret = (srv->sessions.ptr[i]->id == id) ? srv->sessions.ptr[i] : NULL;
+    }
+
+    if (ret != NULL) {
+        ret->users++;
+    }
+
+    pthread_mutex_unlock(&srv->lock);
+    return ret;
+}
+
+
+// Drop a reference, freeing the session if it was closed and this was the last one
+static void releaseSession(Server *srv, LC3_Session *s) {
+    pthread_mutex_lock(&srv->lock);
+    bool last = (--s->users == 0) && s->closed;
+    pthread_mutex_unlock(&srv->lock);
+
+    if (last) {
+        destroySession(s);
+    }
+}
+
+
+static void closeSession(Server *srv, LC3_Session *s) {
+    pthread_mutex_lock(&srv->lock);
+
+    for (size_t i = 0; i < srv->sessions.sz; i++) {
+        if (srv->sessions.ptr[i] == s) {
+            srv->sessions.ptr[i] = srv->sessions.ptr[--srv->sessions.sz];
+            break;
+        }
+    }
+
+    s->closed = true;
+    pthread_mutex_unlock(&srv->lock);
+}
+
+
+// Keep the newest half of the output once it grows too large
+static void trimOutput(LC3_Session *s) {
+    if (s->sim.outf == NULL) {
+        return;
+    }
+
+    fflush(s->sim.outf);
+
+    if (s->outputSz <= LC3_SERVE_OUTPUT_MAX) {
+        return;
+    }
+
+    // Closing writes the final buffer back, which may have moved
+    fclose(s->sim.outf);
+    char *old = s->output;
+    size_t keep = LC3_SERVE_OUTPUT_MAX / 2, drop = s->outputSz - keep;
+
+    s->sim.outf = open_memstream(&s->output, &s->outputSz);
+    s->dropped += drop;
+
+    // Without a new stream output is no longer collected, but what was kept can still be read
+    if (s->sim.outf == NULL) {
+        memmove(old, old + drop, keep);
+        s->output = old;
+        s->outputSz = keep;
+        return;
+    }
+
+    fwrite(old + drop, 1, keep, s->sim.outf);
+    fflush(s->sim.outf);
+    free(old);
+}
+
+
+static void fail(Request *req, const char *msg) {
+    req->response.sz = 0;
+    addU8(&req->response, LC3_SERVE_ERROR);
+    addBytes(&req->response, msg, strlen(msg));
+}
+
+
+// Handle a request on a session, the session lock is held
+static void handleSession(LC3_Session *s, uint8_t op, Request *req) {
+    LC3_SimInstance *sim = &s->sim;
+    char path[4096];
+
+    switch (op) {
+        case LC3_SERVE_LOAD:
+            if (req->argSz == 0 || req->argSz >= sizeof(path)) {
+                fail(req, "invalid path");
+                return;
+            }
+
+            memcpy(path, req->args, req->argSz);
+            path[req->argSz] = '\0';
+            LC3_LoadExecutable(sim, path);
+
+            if (sim->error != NULL) {
+                fail(req, sim->error);
+                sim->error = NULL;
+            }
+
+            return;
+
+        case LC3_SERVE_INPUT:
+            for (size_t i = 0; i < req->argSz; LC3_QueueInput(&sim->inputs, (char)req->args[i]), i++);
+            return;
+
+        case LC3_SERVE_RUN:
+            if (req->argSz != 8) {
+                fail(req, "invalid arguments");
+                return;
+            }
+
+            uint64_t steps = readU64(req->args);
+            sim->flags &= ~LC3_SIM_HALTED;
+            LC3_UntilBreakpoint(sim, (steps < LC3_SERVE_STEPS_MAX) ? (int64_t)steps : LC3_SERVE_STEPS_MAX);
+            trimOutput(s);
+
+            bool halted = (sim->flags & LC3_SIM_HALTED) != 0;
+            addU8(&req->response, halted | ((halted && LC3_WaitingForInput(sim)) << 1));
+            addU64(&req->response, sim->counter);
+            addU16(&req->response, sim->reg.PC);
+            return;
+
+        case LC3_SERVE_REGS:
+            addU16(&req->response, sim->reg.PC);
+            for (int i = 0; i < 8; addU16(&req->response, sim->reg.reg[i]), i++);
+            addU16(&req->response, sim->reg.PSR);
+            return;
+
+        case LC3_SERVE_MEMORY:
+            if (req->argSz != 4) {
+                fail(req, "invalid arguments");
+                return;
+            }
+
+            uint32_t addr = readU16(req->args), end = addr + readU16(req->args + 2);
+            end = (end < LC3_MEM_SIZE) ? end : LC3_MEM_SIZE;
+            for (; addr < end; addU16(&req->response, sim->memory[addr].value), addr++);
+            return;
+
+        case LC3_SERVE_OUTPUT:
+            if (req->argSz != 8) {
+                fail(req, "invalid arguments");
+                return;
+            }
+
+            fflush(sim->outf);
+            uint64_t offset = readU64(req->args), total = s->dropped + s->outputSz;
+            offset = (offset < s->dropped) ? s->dropped : (offset > total) ? total : offset;
+
+            addU64(&req->response, offset);
+            addU64(&req->response, total);
+            addBytes(&req->response, s->output + (offset - s->dropped), total - offset);
+            return;
+
+        default:
+            fail(req, "unknown operation");
+            return;
+    }
+}
+
+
+// Handle a request body, and fill in the response
+static void handleRequest(Server *srv, const uint8_t *body, size_t size, Request *req) {
+    addU8(&req->response, LC3_SERVE_OK);
+
+    if (size < 5) {
+        fail(req, "request too short");
+        return;
+    }
+
+    uint8_t op = body[0];
+    uint32_t id = readU32(body + 1);
+    req->args = body + 5;
+    req->argSz = size - 5;
+
+    if (op == LC3_SERVE_OPEN) {
+        pthread_mutex_lock(&srv->lock);
+        LC3_Session *s = createSession(++srv->nextId);
+        addSession(&srv->sessions, s);
+        pthread_mutex_unlock(&srv->lock);
+
+        addU32(&req->response, s->id);
+        return;
+    }
+
+    LC3_Session *s = acquireSession(srv, id);
+
+    if (s == NULL) {
+        fail(req, "no such session");
+        return;
+    }
+
+    pthread_mutex_lock(&s->lock);
+
+    if (op == LC3_SERVE_CLOSE) {
+        closeSession(srv, s);
+    } else {
+        handleSession(s, op, req);
+    }
+
+    pthread_mutex_unlock(&s->lock);
+    releaseSession(srv, s);
+}
+
+
+static Connection *openConnection(Server *srv, int fd) {
+    Connection *c = lc_malloc(sizeof(Connection));
+    c->fd = fd;
+    c->in = newByteArray();
+    c->out = newByteArray();
+    c->outPos = 0;
+
+    pthread_mutex_lock(&srv->lock);
+    addConnection(&srv->connections, c);
+    pthread_mutex_unlock(&srv->lock);
+    return c;
+}
+
+
+static void destroyConnection(Connection *c) {
+    close(c->fd);
+    lc_free(c->in.ptr);
+    lc_free(c->out.ptr);
+    lc_free(c);
+}
+
+
+static void closeConnection(Server *srv, Connection *c) {
+    pthread_mutex_lock(&srv->lock);
+
+    for (size_t i = 0; i < srv->connections.sz; i++) {
+        if (srv->connections.ptr[i] == c) {
+            srv->connections.ptr[i] = srv->connections.ptr[--srv->connections.sz];
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&srv->lock);
+    destroyConnection(c);
+}
+
+
+// Send as much of the pending responses as the socket takes, returns false if the client is gone
+static bool flushClient(Connection *c) {
+    while (c->outPos < c->out.sz) {
+        ssize_t w = send(c->fd, c->out.ptr + c->outPos, c->out.sz - c->outPos, MSG_NOSIGNAL);
+
+        if (w < 0) {
+            return errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+
+        c->outPos += w;
+    }
+
+    c->out.sz = c->outPos = 0;
+    return true;
+}
+
+
+// Answer every complete request received so far, returns false on a frame that is too large
+static bool handleFrames(Server *srv, Connection *c) {
+    size_t pos = 0;
+    bool ok = true;
+
+    while (c->in.sz - pos >= 4) {
+        size_t size = readU32(c->in.ptr + pos);
+
+        if (size > LC3_SERVE_FRAME_MAX) {
+            ok = false;
+            break;
+        } else if (c->in.sz - pos - 4 < size) {
+            break;
+        }
+
+        Request req = {.response = newByteArray()};
+        handleRequest(srv, c->in.ptr + pos + 4, size, &req);
+        addU32(&c->out, req.response.sz);
+        addBytes(&c->out, req.response.ptr, req.response.sz);
+        lc_free(req.response.ptr);
+        pos += 4 + size;
+    }
+
+    memmove(c->in.ptr, c->in.ptr + pos, c->in.sz - pos);
+    c->in.sz -= pos;
+    return ok;
+}
+
+
+// Handle whatever the client is ready for, returns false once the connection should be closed
+// Requests can arrive in pieces over several wakeups, the socket never blocks a thread
+static bool serveClient(Server *srv, Connection *c) {
+    uint8_t chunk[16384];
+
+    // Nothing more is read until earlier responses are sent, so a client not reading them cannot grow the buffer
+    if (!flushClient(c)) {
+        return false;
+    } else if (c->outPos < c->out.sz) {
+        return true;
+    }
+
+    ssize_t r = read(c->fd, chunk, sizeof(chunk));
+
+    if (r == 0 || (r < 0 && errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        return false;
+    } else if (r > 0) {
+        addBytes(&c->in, chunk, r);
+    }
+
+    return handleFrames(srv, c) && flushClient(c);
+}
+
+
+// Every thread waits on the epoll instance, clients are armed one shot so only one thread handles a client at once
+static void *serveThread(void *arg) {
+    Server *srv = arg;
+    struct epoll_event event;
+
+    while (true) {
+        if (epoll_wait(srv->epollFd, &event, 1, -1) <= 0) {
+            continue;
+        }
+
+        if (event.data.ptr == &srv->quitFd) {
+            return NULL;
+        } else if (event.data.ptr == &srv->listenFd) {
+            int client = accept(srv->listenFd, NULL, NULL);
+
+            if (client < 0) {
+                continue;
+            } else if (fcntl(client, F_SETFL, fcntl(client, F_GETFL) | O_NONBLOCK) != 0) {
+                close(client);
+                continue;
+            }
+
+            Connection *c = openConnection(srv, client);
+            struct epoll_event add = {.events = EPOLLIN | EPOLLONESHOT, .data.ptr = c};
+
+            if (epoll_ctl(srv->epollFd, EPOLL_CTL_ADD, client, &add) != 0) {
+                closeConnection(srv, c);
+            }
+
+            continue;
+        }
+
+        Connection *c = event.data.ptr;
+
+        // Waits for the socket to take more of the responses, or for more of a request
+        if (serveClient(srv, c)) {
+            struct epoll_event rearm = {.events = ((c->outPos < c->out.sz) ? EPOLLOUT : EPOLLIN) | EPOLLONESHOT, .data.ptr = c};
+            epoll_ctl(srv->epollFd, EPOLL_CTL_MOD, c->fd, &rearm);
+        } else {
+            closeConnection(srv, c);
+        }
+    }
+}
+
+
+static int openSocket(const char *path) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+
+    strcpy(addr.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    // A socket left behind by an earlier server is replaced
+    unlink(path);
+
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+
+        return -1;
+    }
+
+    return fd;
+}
+
+
+int LC3_Serve(const char *path, int threads) {
+    Server srv = {
+        .listenFd = openSocket(path),
+        .epollFd  = epoll_create1(EPOLL_CLOEXEC),
+        .quitFd   = eventfd(0, EFD_CLOEXEC),
+        .sessions = newSessions(),
+        .connections = newConnections(),
+        .nextId   = 0,
+    };
+
+    if (srv.listenFd < 0) {
+        fprintf(stderr, "%s: failed to open socket\n", path);
+        close(srv.epollFd);
+        close(srv.quitFd);
+        lc_free(srv.sessions.ptr);
+        lc_free(srv.connections.ptr);
+        return 1;
+    }
+
+    struct epoll_event accepting = {.events = EPOLLIN, .data.ptr = &srv.listenFd};
+    struct epoll_event quit = {.events = EPOLLIN, .data.ptr = &srv.quitFd};
+    epoll_ctl(srv.epollFd, EPOLL_CTL_ADD, srv.listenFd, &accepting);
+    epoll_ctl(srv.epollFd, EPOLL_CTL_ADD, srv.quitFd, &quit);
+    pthread_mutex_init(&srv.lock, NULL);
+
+    // Only this thread receives the signals that stop the server
+    sigset_t stop;
+    sigemptyset(&stop);
+    sigaddset(&stop, SIGINT);
+    sigaddset(&stop, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop, NULL);
+
+    pthread_t *pool = lc_malloc(threads * sizeof(pthread_t));
+
+    int started = 0, sig = 0;
+    for (; started < threads && pthread_create(&pool[started], NULL, serveThread, &srv) == 0; started++);
+
+    // Serving goes on with fewer threads than asked for, but not without any
+    if (started > 0) {
+        sigwait(&stop, &sig);
+    } else {
+        fprintf(stderr, "%s: failed to start server threads\n", path);
+    }
+
+    uint64_t one = 1;
+    write(srv.quitFd, &one, sizeof(one));
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(pool[i], NULL);
+    }
+
+    // No thread is left to use the connections, clients see them closed
+    for (size_t i = 0; i < srv.connections.sz; destroyConnection(srv.connections.ptr[i]), i++);
+    lc_free(srv.connections.ptr);
+
+    close(srv.listenFd);
+    close(srv.epollFd);
+    close(srv.quitFd);
+    unlink(path);
+
+    for (size_t i = 0; i < srv.sessions.sz; destroySession(srv.sessions.ptr[i]), i++);
+    lc_free(srv.sessions.ptr);
+    lc_free(pool);
+    pthread_mutex_destroy(&srv.lock);
+    return (started > 0) ? 0 : 1;
+}
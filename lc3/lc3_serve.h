@@ -0,0 +1,65 @@
+#pragma once
+#include <pthread.h>
+#include "lc3_sim.h"
+
+// Largest request body accepted
+#define LC3_SERVE_FRAME_MAX (1 << 20)
+
+// Most instructions a single run request may execute, so one session cannot hold a thread for long
+#define LC3_SERVE_STEPS_MAX (100000000)
+
+// Output kept per session, older output is dropped
+#define LC3_SERVE_OUTPUT_MAX (1 << 20)
+
+
+/*
+ * Session server protocol (--serve SOCKET)
+ *
+ * Every message is a 32-bit length followed by that many bytes, all numbers are little-endian.
+ * A request body is an 8-bit operation and a 32-bit session id (ignored by OPEN), followed by its arguments.
+ * A response body is an 8-bit status, followed by the results on success or an error message on failure.
+ *
+ *   OPEN                       -> u32 session
+ *   CLOSE                      ->
+ *   LOAD    path...            ->                                  Path on the server
+ *   INPUT   bytes...           ->                                  Queued as input
+ *   RUN     u64 steps          -> u8 state, u64 counter, u16 PC    State: bit 0 halted, bit 1 waiting for input
+ *   REGS                       -> u16 PC, u16 R0-R7, u16 PSR
+ *   MEMORY  u16 addr, u16 n    -> u16 words...                     Stops at the end of memory
+ *   OUTPUT  u64 offset         -> u64 offset, u64 total, bytes...  Raw output from offset, or the oldest output kept
+ */
+typedef enum LC3_ServeOp {
+    LC3_SERVE_OPEN,
+    LC3_SERVE_CLOSE,
+    LC3_SERVE_LOAD,
+    LC3_SERVE_INPUT,
+    LC3_SERVE_RUN,
+    LC3_SERVE_REGS,
+    LC3_SERVE_MEMORY,
+    LC3_SERVE_OUTPUT,
+} LC3_ServeOp;
+
+typedef enum LC3_ServeStatus {
+    LC3_SERVE_OK,
+    LC3_SERVE_ERROR,
+} LC3_ServeStatus;
+
+
+// Simulator hosted by the server
+typedef struct LC3_Session {
+    uint32_t id;                    // Identifier given to the client
+    LC3_SimInstance sim;            // Simulator, output goes into a memstream
+    char *output;                   // Memstream buffer with the output kept
+    size_t outputSz;                // Size of that buffer
+    uint64_t dropped;               // Bytes of output dropped before it
+    pthread_mutex_t lock;           // Held while a request uses the session
+    int users;                      // Requests holding a reference, protected by the server lock
+    bool closed;                    // Removed from the server, freed once users is 0
+} LC3_Session;
+
+
+/*
+ * Serve sessions on a unix domain socket at path, on threads threads, until SIGINT or SIGTERM
+ * Returns 0 after a clean shutdown, or 1 if the socket or threads could not be set up
+ */
+int LC3_Serve(const char *path, int threads);
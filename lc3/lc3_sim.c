@@ -1,4 +1,7 @@
 #include "lc3_sim.h"
+#include "lc3_cover.h"
+#include "lc3_trace.h"
+#include "lc3_record.h"
 #include "lib/va_template.h"
 #include "lib/leakcheck/lc.h"
 
@@ -32,6 +35,11 @@ vaAllocFunction(LC3_StateHistory, LC3_PrevState, newStateHistory, ;, ;)
 vaAppendFunction(LC3_StateHistory, LC3_PrevState, addState, if (va->sz >= LC3_HIST_MAX) { cropHistory(va); };, ;)
 vaFreeFunction(LC3_StateHistory, LC3_PrevState, freeStateHistory, ;, ;, ;)
 
+// Symbol table functions
+vaAllocFunction(LC3_SymbolTable, LC3_Symbol, newSymbolTable, ;, ;)
+vaAppendFunction(LC3_SymbolTable, LC3_Symbol, addSymbol, ;, ;)
+vaFreeFunction(LC3_SymbolTable, LC3_Symbol, freeSymbolTable, lc_free(el.name.ptr), ;, ;)
+
 // Input queue functions
 vqAllocFunction(InputQueue, char, newInputQueue, ;, ;)
 vqEnqueueFunction(InputQueue, char, LC3_QueueInput, ;, ;)
@@ -43,6 +51,7 @@ LC3_SimInstance LC3_CreateSimInstance() {
     LC3_SimInstance ret = {
         .memory  = lc_calloc(LC3_MEM_SIZE, sizeof(LC3_MemoryCell)),
         .debug   = newStringArray(),
+        .symbols = newSymbolTable(),
         .reg     = {.PC = 0x3000, .PSR = 0x8000, .Saved_SSP = 0x3000},
         .flags   = LC3_SIM_REDIR_TRAP | LC3_SIM_HALTED,
         .counter = 0,
@@ -52,6 +61,16 @@ LC3_SimInstance LC3_CreateSimInstance() {
         .inputs  = newInputQueue(),
         .output  = newString(),
         .outf    = NULL,
+        .stream  = NULL,
+        .pageEpoch  = lc_calloc(LC3_PAGE_COUNT, sizeof(uint32_t)),
+        .epoch      = 1,
+        .debugEpoch = 0,
+        .snapId     = 0,
+        .snapMark   = 0,
+        .tracer     = NULL,
+        .coverage   = NULL,
+        .recorder   = NULL,
+        .breakpoints = 0,
     };
 
     return ret;
@@ -65,9 +84,340 @@ void LC3_DestroySimInstance(LC3_SimInstance sim) {
 
     lc_free(sim.memory);
     freeStringArray(sim.debug);
+    freeSymbolTable(sim.symbols);
     freeStateHistory(sim.history);
     freeInputQueue(sim.inputs);
     lc_free(sim.output.ptr);
+    lc_free(sim.pageEpoch);
+
+    if (sim.tracer) {
+        LC3_StopTrace(sim.tracer);
+    }
+
+    if (sim.recorder) {
+        LC3_StopRecording(sim.recorder, &sim);
+    }
+
+    free_nn(sim.coverage);
+}
+
+
+uint32_t LC3_NewEpoch(LC3_SimInstance *sim) {
+    return ++sim->epoch;
+}
+
+
+void LC3_MarkAllDirty(LC3_SimInstance *sim) {
+    for (int i = 0; i < LC3_PAGE_COUNT; i++) {
+        sim->pageEpoch[i] = sim->epoch;
+    }
+
+    sim->debugEpoch = sim->epoch;
+}
+
+
+// Copy string array, including the strings themselves
+static void copyStringArray(StringArray *dst, const StringArray *src) {
+    freeStringArray(*dst);
+    (*dst) = newStringArray();
+
+    for (size_t i = 0; i < src->sz; i++) {
+        String str = {
+            .ptr = lc_malloc(src->ptr[i].cap),
+            .sz  = src->ptr[i].sz,
+            .cap = src->ptr[i].cap,
+        };
+
+        memcpy(str.ptr, src->ptr[i].ptr, str.sz + 1);
+        addString(dst, str);
+    }
+}
+
+
+// Copy symbol table, including the names
+static void copySymbolTable(LC3_SymbolTable *dst, const LC3_SymbolTable *src) {
+    freeSymbolTable(*dst);
+    (*dst) = newSymbolTable();
+
+    for (size_t i = 0; i < src->sz; i++) {
+        LC3_Symbol sym = {
+            .addr = src->ptr[i].addr,
+            .name = {
+                .ptr = lc_malloc(src->ptr[i].name.cap),
+                .sz  = src->ptr[i].name.sz,
+                .cap = src->ptr[i].name.cap,
+            },
+        };
+
+        memcpy(sym.name.ptr, src->ptr[i].name.ptr, sym.name.sz + 1);
+        addSymbol(dst, sym);
+    }
+}
+
+
+// Index of the first symbol at or after addr
+static size_t lowerSymbol(const LC3_SymbolTable *table, uint16_t addr) {
+    size_t lo = 0, hi = table->sz;
+
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+
+        if (table->ptr[mid].addr < addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+
+void LC3_AddSymbol(LC3_SimInstance *sim, uint16_t addr, const char *name) {
+    LC3_SymbolTable *table = &sim->symbols;
+    size_t idx = lowerSymbol(table, addr);
+
+    for (; idx < table->sz && table->ptr[idx].addr == addr; idx++) {
+        if (strcmp(table->ptr[idx].name.ptr, name) == 0) {
+            return;
+        }
+    }
+
+    LC3_Symbol sym = {
+        .addr = addr,
+        .name = newString(),
+    };
+
+    for (; *name; addchar(&sym.name, *name), name++);
+
+    // Append, then move it into place to keep the table sorted
+    addSymbol(table, sym);
+    memmove(table->ptr + idx + 1, table->ptr + idx, (table->sz - idx - 1) * sizeof(LC3_Symbol));
+    table->ptr[idx] = sym;
+    sim->debugEpoch = sim->epoch;
+}
+
+
+void LC3_RemoveSymbol(LC3_SimInstance *sim, uint16_t addr, const char *name) {
+    LC3_SymbolTable *table = &sim->symbols;
+
+    for (size_t idx = lowerSymbol(table, addr); idx < table->sz && table->ptr[idx].addr == addr; idx++) {
+        if (strcmp(table->ptr[idx].name.ptr, name) == 0) {
+            lc_free(table->ptr[idx].name.ptr);
+            memmove(table->ptr + idx, table->ptr + idx + 1, (table->sz - idx - 1) * sizeof(LC3_Symbol));
+            table->sz--;
+            sim->debugEpoch = sim->epoch;
+            return;
+        }
+    }
+}
+
+
+const char *LC3_SymbolAt(const LC3_SimInstance *sim, uint16_t addr) {
+    size_t idx = lowerSymbol(&sim->symbols, addr);
+    return (idx < sim->symbols.sz && sim->symbols.ptr[idx].addr == addr) ? sim->symbols.ptr[idx].name.ptr : NULL;
+}
+
+
+int32_t LC3_FindSymbol(const LC3_SimInstance *sim, const char *name) {
+    for (size_t i = 0; i < sim->symbols.sz; i++) {
+        if (strcmp(sim->symbols.ptr[i].name.ptr, name) == 0) {
+            return sim->symbols.ptr[i].addr;
+        }
+    }
+
+    return -1;
+}
+
+
+// Drop the debug slots no cell refers to, so indices fit into debugIndex again
+static void compactDebugStrings(LC3_SimInstance *sim) {
+    int32_t *moved = lc_malloc(sim->debug.sz * sizeof(int32_t));
+    StringArray debug = newStringArray();
+    for (size_t i = 0; i < sim->debug.sz; moved[i] = -1, i++);
+
+    for (int i = 0; i < LC3_MEM_SIZE; i++) {
+        if (!sim->memory[i].hasDebug) {
+            continue;
+        }
+
+        uint16_t idx = sim->memory[i].debugIndex;
+
+        if (moved[idx] < 0) {
+            moved[idx] = debug.sz;
+            addString(&debug, sim->debug.ptr[idx]);
+        }
+
+        // Images and snapshots only pick up cells on modified pages
+        if (moved[idx] != idx) {
+            sim->memory[i].debugIndex = moved[idx];
+            LC3_MarkDirty(sim, i);
+        }
+    }
+
+    for (size_t i = 0; i < sim->debug.sz; i++) {
+        if (moved[i] < 0) {
+            lc_free(sim->debug.ptr[i].ptr);
+        }
+    }
+
+    lc_free(sim->debug.ptr);
+    lc_free(moved);
+    sim->debug = debug;
+}
+
+
+void LC3_SetDebugString(LC3_SimInstance *sim, uint16_t addr, String debug) {
+    sim->debugEpoch = sim->epoch;
+    LC3_MarkDirty(sim, addr);
+
+    // Cleared slots are only reclaimed once every index is taken, as at most every cell holds one
+    if (!sim->memory[addr].hasDebug && sim->debug.sz >= LC3_MEM_SIZE) {
+        compactDebugStrings(sim);
+    }
+
+    if (sim->memory[addr].hasDebug) {
+        int idx = sim->memory[addr].debugIndex;
+        lc_free(sim->debug.ptr[idx].ptr);
+        sim->debug.ptr[idx] = debug;
+    } else {
+        sim->memory[addr].hasDebug   = true;
+        sim->memory[addr].debugIndex = sim->debug.sz;
+        addString(&sim->debug, debug);
+    }
+}
+
+
+void LC3_ClearDebugString(LC3_SimInstance *sim, uint16_t addr) {
+    if (!sim->memory[addr].hasDebug) {
+        return;
+    }
+
+    // The slot stays in the list, other cells keep their indices
+    int idx = sim->memory[addr].debugIndex;
+    lc_free(sim->debug.ptr[idx].ptr);
+    sim->debug.ptr[idx] = newString();
+    sim->memory[addr].hasDebug = false;
+    sim->debugEpoch = sim->epoch;
+    LC3_MarkDirty(sim, addr);
+}
+
+
+// Copy everything except memory, debug strings and symbols
+static void copyRuntimeState(LC3_SimInstance *dst, const LC3_SimInstance *src) {
+    dst->reg      = src->reg;
+    dst->flags    = src->flags;
+    dst->counter  = src->counter;
+    dst->c2       = src->c2;
+    dst->snapId   = src->snapId;
+
+    dst->inputs.hd = dst->inputs.tl = 0;
+
+    for (size_t i = 0; i < VQ_SZ(src->inputs); i++) {
+        LC3_QueueInput(&dst->inputs, VQ_EL(src->inputs, i));
+    }
+
+    if (dst->output.cap < src->output.cap) {
+        dst->output.cap = src->output.cap;
+        dst->output.ptr = lc_realloc(dst->output.ptr, dst->output.cap);
+    }
+
+    memcpy(dst->output.ptr, src->output.ptr, src->output.sz + 1);
+    dst->output.sz = src->output.sz;
+
+    if (dst->history.cap < src->history.sz) {
+        dst->history.cap = src->history.cap;
+        dst->history.ptr = lc_realloc(dst->history.ptr, dst->history.cap * sizeof(LC3_PrevState));
+    }
+
+    memcpy(dst->history.ptr, src->history.ptr, src->history.sz * sizeof(LC3_PrevState));
+    dst->history.sz = src->history.sz;
+}
+
+
+// Count the breakpoints among n cells
+static uint32_t countBreakpoints(const LC3_MemoryCell *cells, size_t n) {
+    uint32_t ret = 0;
+    for (size_t i = 0; i < n; ret += cells[i].breakpoint, i++);
+    return ret;
+}
+
+
+void LC3_CountBreakpoints(LC3_SimInstance *sim) {
+    sim->breakpoints = countBreakpoints(sim->memory, LC3_MEM_SIZE);
+}
+
+
+void LC3_CopySimState(LC3_SimInstance *dst, const LC3_SimInstance *src, uint32_t mark) {
+    for (int i = 0; i < LC3_PAGE_COUNT; i++) {
+        if (mark == 0 || LC3_IsDirty(src, i, mark)) {
+            // Breakpoints come along with the pages, there is nothing to count without any
+            dst->breakpoints -= dst->breakpoints ? countBreakpoints(dst->memory + i * LC3_PAGE_SIZE, LC3_PAGE_SIZE) : 0;
+            dst->breakpoints += src->breakpoints ? countBreakpoints(src->memory + i * LC3_PAGE_SIZE, LC3_PAGE_SIZE) : 0;
+            memcpy(dst->memory + i * LC3_PAGE_SIZE, src->memory + i * LC3_PAGE_SIZE, LC3_PAGE_SIZE * sizeof(LC3_MemoryCell));
+            dst->pageEpoch[i] = dst->epoch;
+        }
+    }
+
+    if (mark == 0 || src->debugEpoch >= mark) {
+        copyStringArray(&dst->debug, &src->debug);
+        copySymbolTable(&dst->symbols, &src->symbols);
+        dst->debugEpoch = dst->epoch;
+    }
+
+    copyRuntimeState(dst, src);
+}
+
+
+LC3_SimImage LC3_CreateImage() {
+    LC3_SimImage ret = {
+        .state = LC3_CreateSimInstance(),
+        .mark  = 0,
+        .valid = false,
+    };
+
+    return ret;
+}
+
+
+void LC3_DestroyImage(LC3_SimImage img) {
+    LC3_DestroySimInstance(img.state);
+}
+
+
+void LC3_CaptureImage(LC3_SimImage *img, LC3_SimInstance *sim) {
+    LC3_CopySimState(&img->state, sim, img->valid ? img->mark : 0);
+    img->mark  = LC3_NewEpoch(sim);
+    img->valid = true;
+}
+
+
+void LC3_RestoreImage(LC3_SimInstance *sim, LC3_SimImage *img) {
+    const LC3_SimInstance *src = &img->state;
+
+    for (int page = 0; page < LC3_PAGE_COUNT; page++) {
+        if (!LC3_IsDirty(sim, page, img->mark)) {
+            continue;
+        }
+
+        for (int i = page * LC3_PAGE_SIZE; i < (page + 1) * LC3_PAGE_SIZE; i++) {
+            sim->memory[i].value      = src->memory[i].value;
+            sim->memory[i].hasDebug   = src->memory[i].hasDebug;
+            sim->memory[i].debugIndex = src->memory[i].debugIndex;
+        }
+
+        // Still modified as far as other marks are concerned
+        sim->pageEpoch[page] = sim->epoch;
+    }
+
+    if (sim->debugEpoch >= img->mark) {
+        copyStringArray(&sim->debug, &src->debug);
+        copySymbolTable(&sim->symbols, &src->symbols);
+        sim->debugEpoch = sim->epoch;
+    }
+
+    copyRuntimeState(sim, src);
+    img->mark = LC3_NewEpoch(sim);
 }
 
 
@@ -83,6 +433,7 @@ static void memWrite(LC3_SimInstance *sim, uint16_t addr, int16_t val) {
     sim->reg.MAR = addr;
     sim->reg.MDR = val;
     sim->memory[sim->reg.MAR].value = sim->reg.MDR;
+    LC3_MarkDirty(sim, sim->reg.MAR);
 }
 
 
@@ -128,6 +479,12 @@ static int checkedReadChar(LC3_SimInstance *sim) {
     }
 
     R(0) = fetchInput(&sim->inputs);
+
+    if (sim->recorder) {
+        char c = R(0);
+        LC3_RecordEvent(sim->recorder, LC3_RECORD_READ, sim->counter, &c, 1);
+    }
+
     return 1;
 }
 
@@ -138,6 +495,11 @@ static void checkedPutChar(LC3_SimInstance *sim, char c) {
         fputc(c, sim->outf);
     }
 
+    // Blocks while the reader falls behind, which pauses the simulator in this TRAP
+    if (sim->stream != NULL) {
+        fputc(c, sim->stream);
+    }
+
     for (const char *cstr = charString(c); cstr && cstr[0]; cstr++) {
         addchar(&sim->output, cstr[0]);
     }
@@ -148,9 +510,9 @@ static void checkedPutChar(LC3_SimInstance *sim, char c) {
 }
 
 
-// Simulate TRAP
+// Simulate TRAP, only called with LC3_SIM_REDIR_TRAP set
 int fakeTRAP(LC3_SimInstance *sim, uint8_t code) {
-    switch (((sim->flags & LC3_SIM_REDIR_TRAP) != 0) * code) {
+    switch (code) {
         case 0x00:  return 0;
         case 0x23:
         case 0x20:  return checkedReadChar(sim);
@@ -158,7 +520,17 @@ int fakeTRAP(LC3_SimInstance *sim, uint8_t code) {
                     return 1;
         case 0x22:  for (uint16_t r0 = R(0); MEM(r0); checkedPutChar(sim, MEM(r0) & 0xFF), r0++);;
                     return 1;
-        case 0x24:  for (uint16_t r0 = R(0); MEM(r0); checkedPutChar(sim, MEM(r0) >> 8), putchar(MEM(r0) & 0xFF), r0++);;
+        case 0x24:  // Two characters per word, low byte first, a zero high byte ends the string early
+                    for (uint16_t r0 = R(0); MEM(r0); r0++) {
+                        checkedPutChar(sim, MEM(r0) & 0xFF);
+
+                        if (((uint16_t)MEM(r0) >> 8) == 0) {
+                            break;
+                        }
+
+                        checkedPutChar(sim, (uint16_t)MEM(r0) >> 8);
+                    }
+
                     return 1;
         case 0x25:  return -1;
         default:    return 0;
@@ -166,8 +538,19 @@ int fakeTRAP(LC3_SimInstance *sim, uint8_t code) {
 }
 
 
+// Features an executor variant is specialised on
+enum ExecFeature {
+    EXEC_HISTORY     = 0x01,    // Record previous states
+    EXEC_REDIR       = 0x02,    // Redirect TRAPs to C functions
+    EXEC_PROFILE     = 0x04,    // Collect coverage and/or trace
+    EXEC_BREAKPOINTS = 0x08,    // Stop on breakpoints
+    EXEC_VARIANTS    = 0x10,    // Amount of combinations
+};
+
+
 // Execute instruction at the current PC
-void LC3_ExecuteInstruction(LC3_SimInstance *sim) {
+// Specialised on features, so runs do not pay for what they do not use
+static inline void executeInstruction(LC3_SimInstance *sim, const unsigned features) {
     // Pre
     if (sim->flags & LC3_SIM_HALTED) {
         return;
@@ -199,6 +582,7 @@ void LC3_ExecuteInstruction(LC3_SimInstance *sim) {
     };
 
     int16_t tmp = 0;
+    int32_t stored = -1;
     Converter cast = {0};
     goto state18;
 
@@ -243,7 +627,7 @@ void LC3_ExecuteInstruction(LC3_SimInstance *sim) {
     
     // Start of TRAP
     state15:
-        if ((tmp = fakeTRAP(sim, sim->reg.IR & 0x00FF))) {
+        if ((features & EXEC_REDIR) && (tmp = fakeTRAP(sim, sim->reg.IR & 0x00FF))) {
             gotoIfElse(tmp > 0, done, failure);
         }
 
@@ -251,7 +635,10 @@ void LC3_ExecuteInstruction(LC3_SimInstance *sim) {
         interrupt(0x00, (sim->reg.IR & 0x00FF));
     
     state16:
+        SAVE_MEM(sim->reg.MAR);
         sim->memory[sim->reg.MAR].value = sim->reg.MDR;
+        LC3_MarkDirty(sim, sim->reg.MAR);
+        stored = sim->reg.MAR;
         goto done;
 
     // Start of instruction cycle
@@ -368,12 +755,35 @@ void LC3_ExecuteInstruction(LC3_SimInstance *sim) {
 
     done:
         sim->counter++;
-        addState(&sim->history, initial);
+
+        if (features & EXEC_HISTORY) {
+            addState(&sim->history, initial);
+        }
+
+        if ((features & EXEC_PROFILE) && sim->coverage) {
+            LC3_CoverHit(sim->coverage, initial.reg.PC);
+            LC3_CoverEdge(sim->coverage, initial.reg.PC, sim->reg.PC);
+
+            if (LC3_IsConditionalBranch(sim->reg.IR)) {
+                (sim->reg.BEN ? sim->coverage->taken : sim->coverage->notTaken)[initial.reg.PC]++;
+            }
+        }
+
+        if ((features & EXEC_PROFILE) && sim->tracer) {
+            LC3_TraceInstruction(sim->tracer, &initial.reg, sim, stored);
+        }
+
         goto end;
 
     failure:
         sim->flags |= LC3_SIM_HALTED;
         sim->reg = initial.reg;
+
+        // HALT, or a TRAP waiting for input, still counts as reached
+        if ((features & EXEC_PROFILE) && sim->coverage) {
+            LC3_CoverHit(sim->coverage, initial.reg.PC);
+        }
+
         goto end;
 
     end:
@@ -381,16 +791,55 @@ void LC3_ExecuteInstruction(LC3_SimInstance *sim) {
 }
 
 
+// Run loop, specialised on features like executeInstruction
+static inline void runInstructions(LC3_SimInstance *sim, int64_t maxSteps, const unsigned features) {
+    int64_t i = 0;
+    do {
+        executeInstruction(sim, features);
+    } while (!((features & EXEC_BREAKPOINTS) && MEM_PC.breakpoint) && (maxSteps < 0 || (++i) < maxSteps) && !(sim->flags & LC3_SIM_HALTED));
+}
+
+
+// Every combination of features gets its own copy of the run loop and executor
+#define EXEC_VARIANT_LIST(X) \
+    X(0) X(1) X(2) X(3) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11) X(12) X(13) X(14) X(15)
+
+#define EXEC_DEFINE(f) \
+    static void runVariant##f(LC3_SimInstance *sim, int64_t maxSteps) { runInstructions(sim, maxSteps, f); }
+#define EXEC_ENTRY(f) runVariant##f,
+
+EXEC_VARIANT_LIST(EXEC_DEFINE)
+
+static void (*const runVariants[EXEC_VARIANTS])(LC3_SimInstance *, int64_t) = {EXEC_VARIANT_LIST(EXEC_ENTRY)};
+
+
+// Features the current configuration of sim needs
+static unsigned execFeatures(const LC3_SimInstance *sim) {
+    return ((sim->flags & LC3_SIM_NO_HISTORY) ? 0 : EXEC_HISTORY)
+         | ((sim->flags & LC3_SIM_REDIR_TRAP) ? EXEC_REDIR : 0)
+         | ((sim->coverage || sim->tracer) ? EXEC_PROFILE : 0)
+         | ((sim->breakpoints > 0) ? EXEC_BREAKPOINTS : 0);
+}
+
+
+void LC3_ExecuteInstruction(LC3_SimInstance *sim) {
+    runVariants[execFeatures(sim) & ~EXEC_BREAKPOINTS](sim, 1);
+}
+
+
 // Run until breakpoint, halt or maxsteps
 void LC3_UntilBreakpoint(LC3_SimInstance *sim, int64_t maxSteps) {
     if (sim->flags & LC3_SIM_HALTED || maxSteps == 0) {
         return;
     }
 
-    int i = 0;
-    do {
-        LC3_ExecuteInstruction(sim);
-    } while (!sim->memory[_PC].breakpoint && (maxSteps < 0 || (++i) < maxSteps) && !(sim->flags & LC3_SIM_HALTED));
-
+    // The variant is picked once per run, so changes in configuration apply from the next run
+    runVariants[execFeatures(sim)](sim, maxSteps);
     sim->flags |= (MEM_PC.breakpoint * LC3_SIM_HALTED);
 }
+
+
+bool LC3_WaitingForInput(const LC3_SimInstance *sim) {
+    uint16_t ir = sim->memory[sim->reg.PC].value;
+    return (ir >> 12) == 0xF && ((ir & 0xFF) == 0x20 || (ir & 0xFF) == 0x23) && sim->inputs.hd == sim->inputs.tl;
+}
@@ -14,6 +14,12 @@
 // Amount of memory cells in the LC3
 #define LC3_MEM_SIZE (65536)
 
+// Memory is divided into pages for change tracking
+#define LC3_PAGE_BITS  (8)
+#define LC3_PAGE_SIZE  (1 << LC3_PAGE_BITS)
+#define LC3_PAGE_COUNT (LC3_MEM_SIZE / LC3_PAGE_SIZE)
+#define LC3_PAGE(addr) ((uint16_t)(addr) >> LC3_PAGE_BITS)
+
 // Queue for inputs
 vqTypedef(char, InputQueue);
 vqEnqueueFunctionDefine(InputQueue, char, LC3_QueueInput);
@@ -34,6 +40,8 @@ typedef enum LC3_SimFlag {
                                 // e.g. "getc" instead of "loop until keyboard register is set"
                                 // Currently, this option is required for the simulator to work as expected
     LC3_SIM_HALTED     = 0x02,  // Execution is halted, exec functions will do nothing until "unhalted"
+    LC3_SIM_NO_HISTORY = 0x04,  // Previous states are not recorded, so instructions cannot be undone
+                                // For batch runs that never undo, saves copying the registers every instruction
 } LC3_SimFlag;
 
 
@@ -68,10 +76,31 @@ typedef struct LC3_PrevState {
 vaTypedef(LC3_PrevState, LC3_StateHistory);
 
 
+// Label from the symbol table of an executable
+typedef struct LC3_Symbol {
+    uint16_t addr;              // Address the label refers to
+    String name;                // Label name
+} LC3_Symbol;
+
+// List of symbols, sorted by address
+vaTypedef(LC3_Symbol, LC3_SymbolTable);
+
+
+// Execution trace recorder (see lc3_trace.h)
+struct LC3_Tracer;
+
+// Coverage data (see lc3_cover.h)
+struct LC3_Coverage;
+
+// Input recorder (see lc3_record.h)
+struct LC3_Recorder;
+
+
 // Simulator state
 typedef struct LC3_SimInstance {
     LC3_MemoryCell *memory;     // List of LC3_MEM_SIZE LC3_MemoryCells
     StringArray debug;          // Debug strings
+    LC3_SymbolTable symbols;    // Labels of the loaded executables
     LC3_Registers reg;          // Registers
     uint32_t flags;             // Combination of LC3_SimFlags
     size_t counter, c2;         // How many instructions the simulator has executed and a variable for commands
@@ -80,8 +109,45 @@ typedef struct LC3_SimInstance {
     InputQueue inputs;          // Input queue
     String output;              // Simulator output
     FILE *outf;                 // File to put output into
+    FILE *stream;               // Raw output is streamed here as well if not NULL, not closed with the instance
+    uint32_t *pageEpoch;        // Epoch in which each memory page was last modified
+    uint32_t epoch;             // Current modification epoch
+    uint32_t debugEpoch;        // Epoch in which the debug strings or symbols were last modified
+    uint64_t snapId;            // Identifier of the last snapshot saved or loaded
+    uint32_t snapMark;          // Epoch mark taken when that snapshot was saved or loaded
+    struct LC3_Tracer *tracer;  // Records every executed instruction if not NULL
+    struct LC3_Coverage *coverage; // Collects coverage if not NULL, lc_free'd with the instance
+    struct LC3_Recorder *recorder; // Records queued and read input if not NULL, stopped with the instance
+    uint32_t breakpoints;       // Amount of breakpoints set, runs without any skip checking for them
 } LC3_SimInstance;
 
+
+// In-memory copy of a simulator state, kept up to date incrementally using page epochs
+typedef struct LC3_SimImage {
+    LC3_SimInstance state;      // Copied state
+    uint32_t mark;              // Epoch mark of the source simulator when state was last synchronised
+    bool valid;                 // Whether state has been captured before
+} LC3_SimImage;
+
+
+/*
+ * Mark the memory page containing addr as modified
+ * Any code writing to sim->memory values should call this, LC3_SetDebugString and LC3_ClearDebugString do so themselves
+ */
+#define LC3_MarkDirty(sim, addr) ((sim)->pageEpoch[LC3_PAGE(addr)] = (sim)->epoch)
+
+/*
+ * Check whether page was modified after mark was taken using LC3_NewEpoch
+ */
+#define LC3_IsDirty(sim, page, mark) ((sim)->pageEpoch[(page)] >= (mark))
+
+/*
+ * Set or clear the breakpoint at addr, keeping the breakpoint count up to date
+ * Code changing breakpoints in bulk can instead call LC3_CountBreakpoints afterwards
+ */
+#define LC3_SetBreakpoint(sim, addr, on) \
+    ((sim)->breakpoints += (bool)(on) - (sim)->memory[(addr)].breakpoint, (sim)->memory[(addr)].breakpoint = (on))
+
 /*
  * Allocate and initialize a new sim instance
  * Should be lc_free'd after use with LC3_DestroySimInstance
@@ -89,13 +155,90 @@ typedef struct LC3_SimInstance {
 LC3_SimInstance LC3_CreateSimInstance();
 
 /*
- * Deallocate sim instance
+ * Deallocate sim instance, stopping its tracer and recorder if any
  * Should first have been allocated using LC3_CreateSimInstance
  */
 void LC3_DestroySimInstance(LC3_SimInstance sim);
 
+/*
+ * Start a new modification epoch
+ * Returns a mark, pages modified from now on will be dirty relative to it (see LC3_IsDirty)
+ */
+uint32_t LC3_NewEpoch(LC3_SimInstance *sim);
+
+/*
+ * Mark every memory page and the debug strings as modified
+ */
+void LC3_MarkAllDirty(LC3_SimInstance *sim);
+
+/*
+ * Copy the state of src into dst, which should have been created using LC3_CreateSimInstance
+ * Only memory pages (and debug strings) modified since mark are copied, pass 0 to copy everything
+ * The output file and stream of dst are left untouched
+ */
+void LC3_CopySimState(LC3_SimInstance *dst, const LC3_SimInstance *src, uint32_t mark);
+
+/*
+ * Recount the breakpoints set in memory
+ */
+void LC3_CountBreakpoints(LC3_SimInstance *sim);
+
+/*
+ * Add label name for addr to the symbol table, unless it is there already
+ */
+void LC3_AddSymbol(LC3_SimInstance *sim, uint16_t addr, const char *name);
+
+/*
+ * Remove label name for addr from the symbol table, if it is there
+ */
+void LC3_RemoveSymbol(LC3_SimInstance *sim, uint16_t addr, const char *name);
+
+/*
+ * Get the first label at addr, or NULL if there is none
+ */
+const char *LC3_SymbolAt(const LC3_SimInstance *sim, uint16_t addr);
+
+/*
+ * Find the address of label name, returns -1 if it does not exist
+ */
+int32_t LC3_FindSymbol(const LC3_SimInstance *sim, const char *name);
+
+/*
+ * Set the debug string of addr, sim takes ownership of debug
+ */
+void LC3_SetDebugString(LC3_SimInstance *sim, uint16_t addr, String debug);
+
+/*
+ * Remove the debug string of addr, if it has one
+ */
+void LC3_ClearDebugString(LC3_SimInstance *sim, uint16_t addr);
+
+/*
+ * Allocate an empty image
+ * Should be deallocated using LC3_DestroyImage
+ */
+LC3_SimImage LC3_CreateImage();
+
+/*
+ * Deallocate image
+ */
+void LC3_DestroyImage(LC3_SimImage img);
+
+/*
+ * Update image to the current simulator state
+ * Only pages modified since the last capture or restore are copied
+ */
+void LC3_CaptureImage(LC3_SimImage *img, LC3_SimInstance *sim);
+
+/*
+ * Reset the simulator to the state in image, which must have been captured from sim
+ * Only pages modified since the last capture or restore are copied back, breakpoints are kept
+ */
+void LC3_RestoreImage(LC3_SimInstance *sim, LC3_SimImage *img);
+
 /*
  * Execute a single instruction, unless halted
+ * Collects coverage if sim->coverage is set
  */
 void LC3_ExecuteInstruction(LC3_SimInstance *sim);
 
@@ -104,3 +247,8 @@ void LC3_ExecuteInstruction(LC3_SimInstance *sim);
  * Sets the LC3_SIM_HALTED flag afterwards
  */
 void LC3_UntilBreakpoint(LC3_SimInstance *sim, int64_t maxSteps);
+
+/*
+ * Check whether the simulator halted on a TRAP that reads input, with no input queued
+ */
+bool LC3_WaitingForInput(const LC3_SimInstance *sim);
@@ -0,0 +1,792 @@
+#include "lc3_snap.h"
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TAG(a, b, c, d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+#define CHECK(x, onFail) if (!(x)) { onFail; }
+
+#define SNAP_MAGIC       "LC3S"
+#define SNAP_HEADER_SIZE (32)
+#define SNAP_ENTRY_SIZE  (24)
+#define SNAP_MAX_SECTIONS (16)
+#define SNAP_REG_SIZE    (37)
+
+// Memory is stored in the same pages used for change tracking
+#define PAGE_WORDS (LC3_PAGE_SIZE)
+#define PAGE_COUNT (LC3_PAGE_COUNT)
+
+// Maximum length of a snapshot chain
+#define SNAP_MAX_DEPTH (256)
+
+enum SnapshotKind {
+    SNAP_FULL  = 0,     // Complete simulator state
+    SNAP_DELTA = 1,     // Only pages changed since the base snapshot, other sections are complete
+};
+
+enum PageEncoding {
+    PAGE_ZERO   = 0,    // Every word is zero, no payload
+    PAGE_BITMAP = 1,    // 32-byte bitmap of nonzero words, followed by those words
+    PAGE_RUNS   = 2,    // Runs of repeated words and literal words
+    PAGE_RAW    = 3,    // All PAGE_WORDS words
+};
+
+
+typedef struct SnapSection {
+    uint32_t tag;
+    uint64_t offset;
+    uint64_t size;
+} SnapSection;
+
+
+typedef struct SnapWriter {
+    ByteArray body;
+    SnapSection sections[SNAP_MAX_SECTIONS];
+    int count;
+} SnapWriter;
+
+
+// Start a new section, payloads are aligned to 8 bytes
+static void beginSection(SnapWriter *w, uint32_t tag) {
+    while (w->body.sz % 8) {
+        addU8(&w->body, 0);
+    }
+
+    w->sections[w->count].tag    = tag;
+    w->sections[w->count].offset = w->body.sz;
+    w->sections[w->count].size   = 0;
+}
+
+
+static void endSection(SnapWriter *w) {
+    SnapSection *s = &w->sections[w->count];
+    s->size = w->body.sz - s->offset;
+    w->count++;
+}
+
+
+// Generate an identifier for a new snapshot
+static uint64_t newSnapshotId(void) {
+    static uint64_t sequence = 0;
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ((uint64_t)ts.tv_sec << 32) ^ ((uint64_t)ts.tv_nsec << 8) ^ ((uint64_t)getpid() << 40) ^ (++sequence);
+}
+
+
+// Registers
+static void writeRegisters(ByteArray *out, const LC3_Registers *reg) {
+    addU16(out, reg->PC);
+
+    for (int i = 0; i < 8; i++) {
+        addU16(out, reg->reg[i]);
+    }
+
+    addU16(out, reg->MAR);
+    addU16(out, reg->MDR);
+    addU16(out, reg->IR);
+    addU16(out, reg->PSR);
+    addU8(out, reg->Table);
+    addU8(out, reg->Vector);
+    addU8(out, reg->INTV);
+    addU16(out, reg->Saved_SSP);
+    addU16(out, reg->Saved_USP);
+    addU8(out, reg->INTP);
+    addU8(out, reg->ACV);
+    addU8(out, reg->INT);
+    addU8(out, reg->BEN);
+}
+
+
+static LC3_Registers readRegisters(const uint8_t *p) {
+    LC3_Registers reg = {0};
+    reg.PC = readU16(p);
+
+    for (int i = 0; i < 8; i++) {
+        reg.reg[i] = readU16(p + 2 + 2 * i);
+    }
+
+    reg.MAR       = readU16(p + 18);
+    reg.MDR       = readU16(p + 20);
+    reg.IR        = readU16(p + 22);
+    reg.PSR       = readU16(p + 24);
+    reg.Table     = p[26];
+    reg.Vector    = p[27];
+    reg.INTV      = p[28];
+    reg.Saved_SSP = readU16(p + 29);
+    reg.Saved_USP = readU16(p + 31);
+    reg.INTP      = p[33];
+    reg.ACV       = p[34];
+    reg.INT       = p[35];
+    reg.BEN       = p[36];
+    return reg;
+}
+
+
+// Memory pages
+static void encodeRuns(ByteArray *out, const uint16_t *words) {
+    for (int i = 0; i < PAGE_WORDS;) {
+        int run = 1;
+        for (; i + run < PAGE_WORDS && run < 128 && words[i + run] == words[i]; run++);
+
+        if (run > 2) {
+            addU8(out, 0x80 | (run - 1));
+            addU16(out, words[i]);
+            i += run;
+            continue;
+        }
+
+        // Literals until the next run of 3 or more
+        int lit = 0;
+        for (; i + lit < PAGE_WORDS && lit < 128; lit++) {
+            if (i + lit + 2 < PAGE_WORDS && words[i + lit] == words[i + lit + 1] && words[i + lit] == words[i + lit + 2]) {
+                break;
+            }
+        }
+
+        addU8(out, lit - 1);
+
+        for (int j = 0; j < lit; j++) {
+            addU16(out, words[i + j]);
+        }
+
+        i += lit;
+    }
+}
+
+
+static void writePage(ByteArray *out, ByteArray *scratch, int page, const uint16_t *words) {
+    uint8_t bitmap[PAGE_WORDS / 8] = {0};
+    int nonzero = 0;
+
+    for (int i = 0; i < PAGE_WORDS; i++) {
+        if (words[i]) {
+            bitmap[i / 8] |= 1 << (i % 8);
+            nonzero++;
+        }
+    }
+
+    scratch->sz = 0;
+    encodeRuns(scratch, words);
+
+    size_t bitmapSize = sizeof(bitmap) + 2 * nonzero;
+    size_t rawSize = 2 * PAGE_WORDS;
+    uint8_t encoding = (nonzero == 0) ? PAGE_ZERO : PAGE_RAW;
+
+    if (nonzero > 0 && bitmapSize < rawSize && bitmapSize <= scratch->sz) {
+        encoding = PAGE_BITMAP;
+    } else if (nonzero > 0 && scratch->sz < rawSize) {
+        encoding = PAGE_RUNS;
+    }
+
+    addU8(out, page);
+    addU8(out, encoding);
+
+    switch (encoding) {
+        case PAGE_ZERO:     addU16(out, 0);
+                            break;
+        case PAGE_BITMAP:   addU16(out, bitmapSize);
+                            addBytes(out, bitmap, sizeof(bitmap));
+                            for (int i = 0; i < PAGE_WORDS; i++) {
+                                if (words[i]) {
+                                    addU16(out, words[i]);
+                                }
+                            }
+                            break;
+        case PAGE_RUNS:     addU16(out, scratch->sz);
+                            addBytes(out, scratch->ptr, scratch->sz);
+                            break;
+        case PAGE_RAW:      addU16(out, rawSize);
+                            for (int i = 0; i < PAGE_WORDS; i++) {
+                                addU16(out, words[i]);
+                            }
+                            break;
+    }
+}
+
+
+static int readPage(uint16_t *words, uint8_t encoding, const uint8_t *p, size_t sz) {
+    switch (encoding) {
+        case PAGE_ZERO:
+            memset(words, 0, PAGE_WORDS * sizeof(uint16_t));
+            return 0;
+        case PAGE_BITMAP:
+            CHECK(sz >= PAGE_WORDS / 8, return 1);
+            for (int i = 0, k = PAGE_WORDS / 8; i < PAGE_WORDS; i++) {
+                if (p[i / 8] & (1 << (i % 8))) {
+                    CHECK(k + 2 <= sz, return 1);
+                    words[i] = readU16(p + k);
+                    k += 2;
+                } else {
+                    words[i] = 0;
+                }
+            }
+            return 0;
+        case PAGE_RUNS:
+            for (size_t i = 0, k = 0; i < PAGE_WORDS;) {
+                CHECK(k < sz, return 1);
+                uint8_t h = p[k++];
+                int n = (h & 0x7F) + 1;
+                CHECK(i + n <= PAGE_WORDS, return 1);
+
+                if (h & 0x80) {
+                    CHECK(k + 2 <= sz, return 1);
+                    for (int j = 0; j < n; words[i + j] = readU16(p + k), j++);
+                    k += 2;
+                } else {
+                    CHECK(k + 2 * n <= sz, return 1);
+                    for (int j = 0; j < n; words[i + j] = readU16(p + k + 2 * j), j++);
+                    k += 2 * n;
+                }
+
+                i += n;
+            }
+            return 0;
+        case PAGE_RAW:
+            CHECK(sz >= 2 * PAGE_WORDS, return 1);
+            for (int i = 0; i < PAGE_WORDS; words[i] = readU16(p + 2 * i), i++);
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+
+// Write the selected pages
+static void writeMemoryPages(SnapWriter *w, const LC3_SimInstance *sim, const bool *pages) {
+    ByteArray scratch = newByteArray();
+    uint16_t words[PAGE_WORDS];
+    uint32_t count = 0;
+
+    for (int page = 0; page < PAGE_COUNT; count += pages[page], page++);
+
+    beginSection(w, TAG('M', 'E', 'M', 'P'));
+    addU32(&w->body, count);
+
+    for (int page = 0; page < PAGE_COUNT; page++) {
+        if (!pages[page]) {
+            continue;
+        }
+
+        for (int i = 0; i < PAGE_WORDS; i++) {
+            words[i] = sim->memory[page * PAGE_WORDS + i].value;
+        }
+
+        writePage(&w->body, &scratch, page, words);
+    }
+
+    endSection(w);
+    lc_free(scratch.ptr);
+}
+
+
+static int readMemoryPages(LC3_SimInstance *sim, const uint8_t *p, size_t sz) {
+    uint16_t words[PAGE_WORDS];
+    CHECK(sz >= 4, return 1);
+
+    uint32_t count = readU32(p);
+    size_t k = 4;
+
+    for (uint32_t i = 0; i < count; i++) {
+        CHECK(k + 4 <= sz, return 1);
+        uint8_t page = p[k], encoding = p[k + 1];
+        uint16_t len = readU16(p + k + 2);
+        k += 4;
+
+        CHECK(k + len <= sz, return 1);
+        CHECK(readPage(words, encoding, p + k, len) == 0, return 1);
+        k += len;
+
+        LC3_MemoryCell *cells = sim->memory + page * PAGE_WORDS;
+
+        for (int j = 0; j < PAGE_WORDS; j++) {
+            cells[j].value = words[j];
+        }
+    }
+
+    return 0;
+}
+
+
+// Breakpoints
+static void writeBreakpoints(SnapWriter *w, const LC3_SimInstance *sim) {
+    uint32_t count = 0;
+
+    for (int i = 0; i < LC3_MEM_SIZE; count += sim->memory[i].breakpoint, i++);
+
+    beginSection(w, TAG('B', 'R', 'K', 'P'));
+    addU32(&w->body, count);
+
+    for (int i = 0; i < LC3_MEM_SIZE; i++) {
+        if (sim->memory[i].breakpoint) {
+            addU16(&w->body, i);
+        }
+    }
+
+    endSection(w);
+}
+
+
+static int readBreakpoints(LC3_SimInstance *sim, const uint8_t *p, size_t sz) {
+    CHECK(sz >= 4, return 1);
+    uint32_t count = readU32(p);
+    CHECK(4 + (uint64_t)count * 2 <= sz, return 1);
+
+    for (int i = 0; i < LC3_MEM_SIZE; sim->memory[i].breakpoint = false, i++);
+
+    for (uint32_t i = 0; i < count; i++) {
+        sim->memory[readU16(p + 4 + 2 * i)].breakpoint = true;
+    }
+
+    return 0;
+}
+
+
+// Debug strings, stored as one arena of null-terminated strings
+static void writeDebug(SnapWriter *w, const LC3_SimInstance *sim) {
+    uint32_t arena = 0, mapped = 0;
+
+    for (size_t i = 0; i < sim->debug.sz; arena += sim->debug.ptr[i].sz + 1, i++);
+    for (int i = 0; i < LC3_MEM_SIZE; mapped += sim->memory[i].hasDebug, i++);
+
+    beginSection(w, TAG('D', 'B', 'U', 'G'));
+    addU32(&w->body, sim->debug.sz);
+    addU32(&w->body, arena);
+
+    for (size_t i = 0; i < sim->debug.sz; i++) {
+        addBytes(&w->body, sim->debug.ptr[i].ptr, sim->debug.ptr[i].sz + 1);
+    }
+
+    addU32(&w->body, mapped);
+
+    for (int i = 0; i < LC3_MEM_SIZE; i++) {
+        if (sim->memory[i].hasDebug) {
+            addU16(&w->body, i);
+            addU16(&w->body, sim->memory[i].debugIndex);
+        }
+    }
+
+    endSection(w);
+}
+
+
+static int readDebug(LC3_SimInstance *sim, const uint8_t *p, size_t sz) {
+    CHECK(sz >= 8, return 1);
+    uint32_t count = readU32(p), arena = readU32(p + 4);
+    CHECK(8 + (uint64_t)arena + 4 <= sz, return 1);
+
+    const uint8_t *str = p + 8, *end = str + arena;
+
+    freeStringArray(sim->debug);
+    sim->debug = newStringArray();
+
+    for (int i = 0; i < LC3_MEM_SIZE; i++) {
+        sim->memory[i].hasDebug   = false;
+        sim->memory[i].debugIndex = 0;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        const uint8_t *nul = memchr(str, '\0', end - str);
+        CHECK(nul != NULL, return 1);
+
+        String debug = {
+            .ptr = lc_malloc(nul - str + 1),
+            .sz  = nul - str,
+            .cap = nul - str + 1,
+        };
+
+        memcpy(debug.ptr, str, debug.cap);
+        addString(&sim->debug, debug);
+        str = nul + 1;
+    }
+
+    uint32_t mapped = readU32(end);
+    CHECK(8 + (uint64_t)arena + 4 + (uint64_t)mapped * 4 <= sz, return 1);
+
+    for (uint32_t i = 0; i < mapped; i++) {
+        uint16_t addr = readU16(end + 4 + 4 * i);
+        uint16_t idx  = readU16(end + 6 + 4 * i);
+        CHECK(idx < sim->debug.sz, return 1);
+
+        sim->memory[addr].hasDebug   = true;
+        sim->memory[addr].debugIndex = idx;
+    }
+
+    return 0;
+}
+
+
+// Input queue and output
+static void writeIO(SnapWriter *w, const LC3_SimInstance *sim) {
+    beginSection(w, TAG('I', 'N', 'P', 'Q'));
+    addU32(&w->body, VQ_SZ(sim->inputs));
+
+    for (size_t i = 0; i < VQ_SZ(sim->inputs); i++) {
+        addU8(&w->body, VQ_EL(sim->inputs, i));
+    }
+
+    endSection(w);
+
+    beginSection(w, TAG('O', 'U', 'T', 'P'));
+    addU32(&w->body, sim->output.sz);
+    addBytes(&w->body, sim->output.ptr, sim->output.sz);
+    endSection(w);
+}
+
+
+static int readInputs(LC3_SimInstance *sim, const uint8_t *p, size_t sz) {
+    CHECK(sz >= 4 && 4 + (uint64_t)readU32(p) <= sz, return 1);
+    sim->inputs.hd = sim->inputs.tl = 0;
+
+    for (uint32_t i = 0, len = readU32(p); i < len; i++) {
+        LC3_QueueInput(&sim->inputs, p[4 + i]);
+    }
+
+    return 0;
+}
+
+
+static int readOutput(LC3_SimInstance *sim, const uint8_t *p, size_t sz) {
+    CHECK(sz >= 4 && 4 + (uint64_t)readU32(p) <= sz, return 1);
+    sim->output.sz = 0;
+    sim->output.ptr[0] = '\0';
+
+    for (uint32_t i = 0, len = readU32(p); i < len; i++) {
+        addchar(&sim->output, p[4 + i]);
+    }
+
+    return 0;
+}
+
+
+// Instruction history
+static void writeHistory(SnapWriter *w, const LC3_SimInstance *sim) {
+    beginSection(w, TAG('H', 'I', 'S', 'T'));
+    addU32(&w->body, sim->history.sz);
+
+    for (size_t i = 0; i < sim->history.sz; i++) {
+        writeRegisters(&w->body, &sim->history.ptr[i].reg);
+        addU16(&w->body, sim->history.ptr[i].memoryLocation);
+        addU16(&w->body, sim->history.ptr[i].memoryValue);
+    }
+
+    endSection(w);
+}
+
+
+static int readHistory(LC3_SimInstance *sim, const uint8_t *p, size_t sz) {
+    const size_t entry = SNAP_REG_SIZE + 4;
+    CHECK(sz >= 4, return 1);
+    uint32_t count = readU32(p);
+    CHECK(4 + (uint64_t)count * entry <= sz, return 1);
+
+    sim->history.sz = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        const uint8_t *e = p + 4 + i * entry;
+
+        if (sim->history.sz >= sim->history.cap) {
+            sim->history.cap *= 2;
+            sim->history.ptr = lc_realloc(sim->history.ptr, sim->history.cap * sizeof(LC3_PrevState));
+        }
+
+        sim->history.ptr[sim->history.sz].reg            = readRegisters(e);
+        sim->history.ptr[sim->history.sz].memoryLocation = readU16(e + SNAP_REG_SIZE);
+        sim->history.ptr[sim->history.sz].memoryValue    = readU16(e + SNAP_REG_SIZE + 2);
+        sim->history.sz++;
+    }
+
+    return 0;
+}
+
+
+// Read the identifier of a snapshot file, 0 if it is not a snapshot
+static uint64_t readSnapshotId(const char *filename) {
+    FILE *fp = fopen(filename, "rb");
+    uint8_t header[SNAP_HEADER_SIZE];
+
+    if (fp == NULL) {
+        return 0;
+    }
+
+    bool ok = (fread(header, 1, sizeof(header), fp) == sizeof(header)) && memcmp(header, SNAP_MAGIC, 4) == 0;
+    fclose(fp);
+    return ok ? readU64(header + 16) : 0;
+}
+
+
+// Base paths are tried relative to the directory of the snapshot referring to them first
+static void resolveBase(const char *filename, const char *base, char *out, size_t n) {
+    const char *slash = strrchr(filename, '/');
+    snprintf(out, n, "%s", base);
+
+    if (base[0] == '/' || slash == NULL) {
+        return;
+    }
+
+    snprintf(out, n, "%.*s/%s", (int)(slash - filename), filename, base);
+
+    if (access(out, R_OK) != 0) {
+        snprintf(out, n, "%s", base);
+    }
+}
+
+
+// Select pages and debug strings that differ from the state stored in base
+static int diffAgainstBase(const LC3_SimInstance *sim, const char *base, bool *pages, bool *debug) {
+    LC3_SimInstance old = LC3_CreateSimInstance();
+
+    if (LC3_LoadSnapshot(&old, base) != 0) {
+        LC3_DestroySimInstance(old);
+        return 1;
+    }
+
+    (*debug) = (old.debug.sz != sim->debug.sz);
+
+    for (size_t i = 0; !(*debug) && i < sim->debug.sz; i++) {
+        (*debug) = strcmp(old.debug.ptr[i].ptr, sim->debug.ptr[i].ptr) != 0;
+    }
+
+    for (int i = 0; i < LC3_MEM_SIZE; i++) {
+        pages[i / PAGE_WORDS] |= (old.memory[i].value != sim->memory[i].value);
+        (*debug) |= (old.memory[i].hasDebug != sim->memory[i].hasDebug) || (old.memory[i].debugIndex != sim->memory[i].debugIndex);
+    }
+
+    LC3_DestroySimInstance(old);
+    return 0;
+}
+
+
+bool LC3_IsSnapshotFile(const char *filename) {
+    FILE *fp = fopen(filename, "rb");
+    char magic[4] = {0};
+
+    if (fp == NULL) {
+        return false;
+    }
+
+    bool ret = (fread(magic, 1, 4, fp) == 4) && memcmp(magic, SNAP_MAGIC, 4) == 0;
+    fclose(fp);
+    return ret;
+}
+
+
+// Append a complete snapshot file to out, only the selected pages are stored and debug strings if debug is set
+static void encodeSnapshot(const LC3_SimInstance *sim, const bool *pages, bool debug, const char *base, uint64_t id, uint64_t baseId, ByteArray *out) {
+    SnapWriter w = {.body = newByteArray(), .count = 0};
+
+    if (base != NULL) {
+        beginSection(&w, TAG('B', 'A', 'S', 'E'));
+        addBytes(&w.body, base, strlen(base) + 1);
+        endSection(&w);
+    }
+
+    beginSection(&w, TAG('R', 'E', 'G', 'S'));
+    writeRegisters(&w.body, &sim->reg);
+    endSection(&w);
+
+    beginSection(&w, TAG('C', 'N', 'T', 'R'));
+    addU32(&w.body, sim->flags);
+    addU32(&w.body, 0);
+    addU64(&w.body, sim->counter);
+    addU64(&w.body, sim->c2);
+    endSection(&w);
+
+    writeMemoryPages(&w, sim, pages);
+    writeBreakpoints(&w, sim);
+
+    if (debug) {
+        writeDebug(&w, sim);
+    }
+
+    writeIO(&w, sim);
+    writeHistory(&w, sim);
+
+    // Header and section table, section offsets are relative to the start of the file
+    size_t start = out->sz;
+    uint64_t offset = SNAP_HEADER_SIZE + w.count * SNAP_ENTRY_SIZE;
+    offset += (8 - offset % 8) % 8;
+
+    addBytes(out, SNAP_MAGIC, 4);
+    addU16(out, LC3_SNAP_VERSION);
+    addU16(out, (base != NULL) ? SNAP_DELTA : SNAP_FULL);
+    addU32(out, w.count);
+    addU32(out, 0);
+    addU64(out, id);
+    addU64(out, baseId);
+
+    for (int i = 0; i < w.count; i++) {
+        addU32(out, w.sections[i].tag);
+        addU32(out, 0);
+        addU64(out, offset + w.sections[i].offset);
+        addU64(out, w.sections[i].size);
+    }
+
+    while (out->sz - start < offset) {
+        addU8(out, 0);
+    }
+
+    addBytes(out, w.body.ptr, w.body.sz);
+    lc_free(w.body.ptr);
+}
+
+
+int LC3_SaveSnapshot(LC3_SimInstance *sim, const char *filename, const char *base) {
+    bool pages[PAGE_COUNT] = {0};
+    bool debug = true;
+    uint64_t id = newSnapshotId(), baseId = 0;
+
+    if (base == NULL) {
+        for (int i = 0; i < LC3_MEM_SIZE; pages[i / PAGE_WORDS] |= (sim->memory[i].value != 0), i++);
+    } else if ((baseId = readSnapshotId(base)) == 0) {
+        return 1;
+    } else if (baseId == sim->snapId) {
+        // Base is the last snapshot, so the page epochs tell exactly what changed
+        for (int i = 0; i < PAGE_COUNT; pages[i] = LC3_IsDirty(sim, i, sim->snapMark), i++);
+        debug = (sim->debugEpoch >= sim->snapMark);
+    } else if (diffAgainstBase(sim, base, pages, &debug) != 0) {
+        return 1;
+    }
+
+    ByteArray data = newByteArray();
+    encodeSnapshot(sim, pages, debug, base, id, baseId, &data);
+
+    FILE *fp = fopen(filename, "wb");
+    int ret = 1;
+
+    if (fp != NULL) {
+        ret  = fwrite(data.ptr, 1, data.sz, fp) != data.sz;
+        ret |= fclose(fp) != 0;
+    }
+
+    if (ret == 0) {
+        sim->snapId   = id;
+        sim->snapMark = LC3_NewEpoch(sim);
+    }
+
+    lc_free(data.ptr);
+    return ret;
+}
+
+
+void LC3_EncodeSnapshot(const LC3_SimInstance *sim, ByteArray *out) {
+    bool pages[PAGE_COUNT] = {0};
+    for (int i = 0; i < LC3_MEM_SIZE; pages[i / PAGE_WORDS] |= (sim->memory[i].value != 0), i++);
+    encodeSnapshot(sim, pages, true, NULL, newSnapshotId(), 0, out);
+}
+
+
+// Find section in table, returns its payload or NULL
+static const uint8_t *findSection(const uint8_t *file, size_t fsz, uint32_t tag, size_t *sz) {
+    uint32_t count = readU32(file + 8);
+
+    for (uint32_t i = 0; i < count; i++) {
+        const uint8_t *e = file + SNAP_HEADER_SIZE + i * SNAP_ENTRY_SIZE;
+        uint64_t offset = readU64(e + 8), size = readU64(e + 16);
+
+        if (readU32(e) == tag && offset <= fsz && size <= fsz - offset) {
+            (*sz) = size;
+            return file + offset;
+        }
+    }
+
+    return NULL;
+}
+
+
+// Loads the base of a delta snapshot
+static int loadSnapshot(LC3_SimInstance *sim, const char *filename, int depth);
+
+
+// Load the snapshot in file, filename is where its base is looked for, or NULL if deltas are not accepted
+static int decodeSnapshot(LC3_SimInstance *sim, const uint8_t *file, size_t fsz, const char *filename, int depth) {
+    size_t sz = 0;
+    const uint8_t *p = NULL;
+    char path[PATH_MAX];
+
+    CHECK(file != NULL && depth < SNAP_MAX_DEPTH, return 1);
+    CHECK(fsz >= SNAP_HEADER_SIZE && memcmp(file, SNAP_MAGIC, 4) == 0, return 1);
+    CHECK(readU16(file + 4) == LC3_SNAP_VERSION, return 1);
+    CHECK(SNAP_HEADER_SIZE + (uint64_t)readU32(file + 8) * SNAP_ENTRY_SIZE <= fsz, return 1);
+
+    if (readU16(file + 6) == SNAP_DELTA) {
+        // Reconstruct the base first, it has to be the exact snapshot this delta was made against
+        CHECK(filename != NULL, return 1);
+        CHECK((p = findSection(file, fsz, TAG('B', 'A', 'S', 'E'), &sz)) && sz > 0 && p[sz - 1] == '\0', return 1);
+        resolveBase(filename, (const char *)p, path, sizeof(path));
+        CHECK(loadSnapshot(sim, path, depth + 1) == 0 && sim->snapId == readU64(file + 24), return 1);
+    } else {
+        CHECK(readU16(file + 6) == SNAP_FULL, return 1);
+        memset(sim->memory, 0, LC3_MEM_SIZE * sizeof(LC3_MemoryCell));
+        freeStringArray(sim->debug);
+        sim->debug = newStringArray();
+    }
+
+    // Registers and counters are required
+    CHECK((p = findSection(file, fsz, TAG('R', 'E', 'G', 'S'), &sz)) && sz >= SNAP_REG_SIZE, return 1);
+    sim->reg = readRegisters(p);
+
+    CHECK((p = findSection(file, fsz, TAG('C', 'N', 'T', 'R'), &sz)) && sz >= 24, return 1);
+    sim->flags   = readU32(p);
+    sim->counter = readU64(p + 8);
+    sim->c2      = readU64(p + 16);
+
+    CHECK((p = findSection(file, fsz, TAG('M', 'E', 'M', 'P'), &sz)) && readMemoryPages(sim, p, sz) == 0, return 1);
+    CHECK(!(p = findSection(file, fsz, TAG('B', 'R', 'K', 'P'), &sz)) || readBreakpoints(sim, p, sz) == 0, return 1);
+    CHECK(!(p = findSection(file, fsz, TAG('D', 'B', 'U', 'G'), &sz)) || readDebug(sim, p, sz) == 0, return 1);
+    CHECK(!(p = findSection(file, fsz, TAG('I', 'N', 'P', 'Q'), &sz)) || readInputs(sim, p, sz) == 0, return 1);
+    CHECK(!(p = findSection(file, fsz, TAG('O', 'U', 'T', 'P'), &sz)) || readOutput(sim, p, sz) == 0, return 1);
+    CHECK(!(p = findSection(file, fsz, TAG('H', 'I', 'S', 'T'), &sz)) || readHistory(sim, p, sz) == 0, return 1);
+
+    sim->snapId = readU64(file + 16);
+    return 0;
+}
+
+
+static int loadSnapshot(LC3_SimInstance *sim, const char *filename, int depth) {
+    size_t fsz = 0;
+    const uint8_t *file = mapFile(filename, &fsz);
+    int ret = decodeSnapshot(sim, file, fsz, filename, depth);
+    unmapFile(file, fsz);
+    return ret;
+}
+
+
+// Keep a decoded state, which went into a copy of sim so failing halfway through leaves sim untouched
+static void applyDecoded(LC3_SimInstance *sim, LC3_SimInstance *decoded) {
+    LC3_CountBreakpoints(decoded);
+    LC3_CopySimState(sim, decoded, 0);
+    LC3_MarkAllDirty(sim);
+    LC3_CountBreakpoints(sim);
+    sim->snapMark = LC3_NewEpoch(sim);
+}
+
+
+int LC3_LoadSnapshot(LC3_SimInstance *sim, const char *filename) {
+    LC3_SimInstance decoded = LC3_CreateSimInstance();
+    LC3_CopySimState(&decoded, sim, 0);
+    int ret = loadSnapshot(&decoded, filename, 0);
+
+    if (ret == 0) {
+        applyDecoded(sim, &decoded);
+    }
+
+    LC3_DestroySimInstance(decoded);
+    return ret;
+}
+
+
+int LC3_DecodeSnapshot(LC3_SimInstance *sim, const uint8_t *data, size_t size) {
+    LC3_SimInstance decoded = LC3_CreateSimInstance();
+    LC3_CopySimState(&decoded, sim, 0);
+    int ret = decodeSnapshot(&decoded, data, size, NULL, 0);
+
+    // Not a file, so it cannot be the base of a delta
+    if (ret == 0) {
+        decoded.snapId = 0;
+        applyDecoded(sim, &decoded);
+    }
+
+    LC3_DestroySimInstance(decoded);
+    return ret;
+}
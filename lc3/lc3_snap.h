@@ -0,0 +1,60 @@
+#pragma once
+#include "lc3_sim.h"
+
+/*
+ * Simulator snapshot file format (version 2)
+ *
+ * All values are stored little-endian, independent of the host
+ * The file starts with a header and a section table, followed by the section payloads:
+ *
+ *      header   | "LC3S", u16 version, u16 kind (full/delta), u32 section count, u32 reserved, u64 id, u64 base id
+ *      table    | (u32 tag, u32 reserved, u64 offset, u64 size) for every section
+ *      sections | payloads, each aligned to 8 bytes
+ *
+ * Sections:
+ *      BASE     | Path of the base snapshot (delta snapshots only)
+ *      REGS     | Registers
+ *      CNTR     | Simulator flags and instruction counters
+ *      MEMP     | Memory pages, every page compressed separately (zero/bitmap/runs/raw)
+ *      BRKP     | Breakpoint addresses
+ *      DBUG     | Debug string arena and the addresses referring to it
+ *      INPQ     | Queued input
+ *      OUTP     | Simulator output
+ *      HIST     | Instruction history
+ *
+ * A delta snapshot only stores the memory pages (and debug strings) changed since its base snapshot,
+ * loading it loads the chain of base snapshots first
+ */
+
+#define LC3_SNAP_VERSION (2)
+
+/*
+ * Check whether the provided file starts with the snapshot magic number
+ */
+bool LC3_IsSnapshotFile(const char *filename);
+
+/*
+ * Write a snapshot of the simulator to filename
+ * If base is not NULL, a delta snapshot against the snapshot file base is written
+ * Returns 0 on success
+ */
+int LC3_SaveSnapshot(LC3_SimInstance *sim, const char *filename, const char *base);
+
+/*
+ * Load a snapshot into the simulator, replacing its state
+ * Returns 0 on success, the simulator is left unchanged otherwise
+ */
+int LC3_LoadSnapshot(LC3_SimInstance *sim, const char *filename);
+
+/*
+ * Append a full snapshot of the simulator to out, in the format of a snapshot file
+ * Unlike LC3_SaveSnapshot, it does not become the last snapshot of sim
+ */
+void LC3_EncodeSnapshot(const LC3_SimInstance *sim, ByteArray *out);
+
+/*
+ * Load a full snapshot from memory into the simulator, replacing its state
+ * Returns 0 on success, the simulator is left unchanged otherwise
+ * Delta snapshots are not accepted as they refer to a file
+ */
+int LC3_DecodeSnapshot(LC3_SimInstance *sim, const uint8_t *data, size_t size);
@@ -0,0 +1,309 @@
+#include "lc3_trace.h"
+
+#define TRACE_MAGIC       "LC3T"
+#define TRACE_HEADER_SIZE (36)
+
+// Records are appended to a buffer of this size before it is handed to the writer thread
+#define TRACE_BUF_SIZE    (1 << 16)
+
+// Upper bound on the size of a single record
+#define TRACE_RECORD_MAX  (48)
+
+// Zigzag encoding for 16-bit differences, small negative numbers become small positive numbers
+#define ZIGZAG(d)   ((uint16_t)(((uint16_t)(d) << 1) ^ (uint16_t)((int16_t)(d) >> 15)))
+#define UNZIGZAG(z) ((uint16_t)(((z) >> 1) ^ (uint16_t)(-(int16_t)((z) & 1))))
+
+
+static uint8_t *putVarint(uint8_t *p, uint16_t n) {
+    while (n >= 0x80) {
+        *p++ = (n & 0x7F) | 0x80;
+        n >>= 7;
+    }
+
+    *p++ = n;
+    return p;
+}
+
+
+static uint8_t *putU16(uint8_t *p, uint16_t n) {
+    p[0] = n & 0xFF;
+    p[1] = n >> 8;
+    return p + 2;
+}
+
+
+static void *writerThread(void *arg) {
+    LC3_Tracer *t = arg;
+    pthread_mutex_lock(&t->lock);
+
+    while (true) {
+        while (!t->writing && !t->quit) {
+            pthread_cond_wait(&t->cond, &t->lock);
+        }
+
+        if (!t->writing) {
+            break;
+        }
+
+        // The buffer that is not being filled is ours until writing is cleared
+        ByteArray *buf = &t->buffers[!t->filling];
+        pthread_mutex_unlock(&t->lock);
+        bool ok = fwrite(buf->ptr, 1, buf->sz, t->fp) == buf->sz;
+        pthread_mutex_lock(&t->lock);
+
+        buf->sz = 0;
+        t->failed |= !ok;
+        t->writing = false;
+        pthread_cond_broadcast(&t->cond);
+    }
+
+    pthread_mutex_unlock(&t->lock);
+    return NULL;
+}
+
+
+// Hand the buffer being filled to the writer thread, waiting for it to finish the previous one
+static void swapBuffers(LC3_Tracer *t) {
+    pthread_mutex_lock(&t->lock);
+
+    while (t->writing) {
+        pthread_cond_wait(&t->cond, &t->lock);
+    }
+
+    t->filling = !t->filling;
+    t->writing = true;
+    pthread_cond_broadcast(&t->cond);
+    pthread_mutex_unlock(&t->lock);
+}
+
+
+LC3_Tracer *LC3_StartTrace(LC3_SimInstance *sim, const char *filename) {
+    FILE *fp = fopen(filename, "wb");
+
+    if (fp == NULL) {
+        return NULL;
+    }
+
+    LC3_Tracer *t = lc_calloc(1, sizeof(LC3_Tracer));
+    t->fp = fp;
+    t->nextPC = sim->reg.PC;
+    t->psr = sim->reg.PSR;
+    memcpy(t->reg, sim->reg.reg, sizeof(t->reg));
+
+    for (int i = 0; i < 2; i++) {
+        t->buffers[i].ptr = lc_malloc(TRACE_BUF_SIZE + TRACE_RECORD_MAX);
+        t->buffers[i].sz  = 0;
+        t->buffers[i].cap = TRACE_BUF_SIZE + TRACE_RECORD_MAX;
+    }
+
+    // Header
+    ByteArray *buf = &t->buffers[0];
+    addBytes(buf, TRACE_MAGIC, 4);
+    addU16(buf, LC3_TRACE_VERSION);
+    addU16(buf, 0);
+
+    for (int i = 0; i < 8; addU16(buf, sim->reg.reg[i]), i++);
+
+    addU16(buf, sim->reg.PSR);
+    addU16(buf, sim->reg.PC);
+    addU64(buf, sim->counter);
+
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->cond, NULL);
+
+    // The file is left behind with only the header in it
+    if (pthread_create(&t->thread, NULL, writerThread, t) != 0) {
+        fclose(t->fp);
+        pthread_mutex_destroy(&t->lock);
+        pthread_cond_destroy(&t->cond);
+        lc_free(t->buffers[0].ptr);
+        lc_free(t->buffers[1].ptr);
+        lc_free(t);
+        return NULL;
+    }
+
+    return t;
+}
+
+
+int LC3_StopTrace(LC3_Tracer *t) {
+    if (t->buffers[t->filling].sz > 0) {
+        swapBuffers(t);
+    }
+
+    pthread_mutex_lock(&t->lock);
+    t->quit = true;
+    pthread_cond_broadcast(&t->cond);
+    pthread_mutex_unlock(&t->lock);
+    pthread_join(t->thread, NULL);
+
+    int ret = t->failed || fclose(t->fp) != 0;
+
+    pthread_mutex_destroy(&t->lock);
+    pthread_cond_destroy(&t->cond);
+    lc_free(t->buffers[0].ptr);
+    lc_free(t->buffers[1].ptr);
+    lc_free(t);
+    return ret;
+}
+
+
+void LC3_TraceInstruction(LC3_Tracer *t, const LC3_Registers *before, const LC3_SimInstance *sim, int32_t store) {
+    ByteArray *buf = &t->buffers[t->filling];
+    uint8_t *start = buf->ptr + buf->sz, *p = start + 1;
+    uint8_t flags = (sim->reg.PSR & 0x7) << 4, mask = 0;
+
+    if (before->PC != t->nextPC) {
+        flags |= LC3_TRACE_JUMP;
+        p = putVarint(p, ZIGZAG(before->PC - t->nextPC));
+    }
+
+    p = putU16(p, sim->reg.IR);
+
+    for (int i = 0; i < 8; i++) {
+        mask |= (sim->reg.reg[i] != t->reg[i]) << i;
+    }
+
+    if (mask) {
+        flags |= LC3_TRACE_REGS;
+        *p++ = mask;
+
+        for (int i = 0; i < 8; i++) {
+            if (mask & (1 << i)) {
+                p = putVarint(p, ZIGZAG(sim->reg.reg[i] - t->reg[i]));
+                t->reg[i] = sim->reg.reg[i];
+            }
+        }
+    }
+
+    if (store >= 0) {
+        flags |= LC3_TRACE_MEM;
+        p = putVarint(p, ZIGZAG(store - t->lastAddr));
+        p = putU16(p, sim->memory[store].value);
+        t->lastAddr = store;
+    }
+
+    if ((sim->reg.PSR ^ t->psr) & 0xFFF8) {
+        flags |= LC3_TRACE_PSR;
+        p = putU16(p, sim->reg.PSR);
+    }
+
+    start[0] = flags;
+    t->psr = sim->reg.PSR;
+    t->nextPC = before->PC + 1;
+    buf->sz += p - start;
+
+    if (buf->sz >= TRACE_BUF_SIZE) {
+        swapBuffers(t);
+    }
+}
+
+
+// Reading
+int LC3_OpenTraceReader(LC3_TraceReader *r, const char *filename) {
+    memset(r, 0, sizeof(LC3_TraceReader));
+    r->data = mapFile(filename, &r->size);
+
+    if (r->data == NULL || r->size < TRACE_HEADER_SIZE || memcmp(r->data, TRACE_MAGIC, 4) || readU16(r->data + 4) != LC3_TRACE_VERSION) {
+        LC3_CloseTraceReader(r);
+        return 1;
+    }
+
+    for (int i = 0; i < 8; i++) {
+        r->state.reg[i] = readU16(r->data + 8 + 2 * i);
+    }
+
+    r->state.PSR = readU16(r->data + 24);
+    r->state.PC  = readU16(r->data + 26) - 1;
+    r->counter   = readU64(r->data + 28);
+    r->pos       = TRACE_HEADER_SIZE;
+    return 0;
+}
+
+
+// Returns -1 on truncated input
+static int32_t getVarint(LC3_TraceReader *r) {
+    uint32_t n = 0;
+
+    for (int shift = 0; shift < 21; shift += 7) {
+        if (r->pos >= r->size) {
+            return -1;
+        }
+
+        uint8_t b = r->data[r->pos++];
+        n |= (uint32_t)(b & 0x7F) << shift;
+
+        if (!(b & 0x80)) {
+            return n & 0xFFFF;
+        }
+    }
+
+    return -1;
+}
+
+
+static int32_t getU16(LC3_TraceReader *r) {
+    if (r->pos + 2 > r->size) {
+        return -1;
+    }
+
+    r->pos += 2;
+    return readU16(r->data + r->pos - 2);
+}
+
+
+int LC3_NextTraceRecord(LC3_TraceReader *r) {
+    LC3_TraceRecord *s = &r->state;
+    int32_t n;
+
+    if (r->pos >= r->size) {
+        return 0;
+    }
+
+    s->flags = r->data[r->pos++];
+    s->PC++;
+    s->regMask = 0;
+
+    if (s->flags & LC3_TRACE_JUMP) {
+        if ((n = getVarint(r)) < 0) return -1;
+        s->PC += UNZIGZAG(n);
+    }
+
+    if ((n = getU16(r)) < 0) return -1;
+    s->IR = n;
+
+    if (s->flags & LC3_TRACE_REGS) {
+        if (r->pos >= r->size) return -1;
+        s->regMask = r->data[r->pos++];
+
+        for (int i = 0; i < 8; i++) {
+            if (s->regMask & (1 << i)) {
+                if ((n = getVarint(r)) < 0) return -1;
+                s->reg[i] += UNZIGZAG(n);
+            }
+        }
+    }
+
+    if (s->flags & LC3_TRACE_MEM) {
+        if ((n = getVarint(r)) < 0) return -1;
+        s->addr += UNZIGZAG(n);
+        if ((n = getU16(r)) < 0) return -1;
+        s->value = n;
+    }
+
+    if (s->flags & LC3_TRACE_PSR) {
+        if ((n = getU16(r)) < 0) return -1;
+        s->PSR = n;
+    }
+
+    s->PSR = (s->PSR & 0xFFF8) | ((s->flags >> 4) & 0x7);
+    r->counter++;
+    return 1;
+}
+
+
+void LC3_CloseTraceReader(LC3_TraceReader *r) {
+    unmapFile(r->data, r->size);
+    r->data = NULL;
+    r->size = 0;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <pthread.h>
+#include "lc3_sim.h"
+
+/*
+ * Binary execution trace format
+ *
+ * The file starts with a header: "LC3T", u16 version, u16 reserved, u16 R0-R7, u16 PSR, u16 PC, u64 counter
+ * It is followed by one record per retired instruction:
+ *
+ *      u8 flags        | bit 0: PC is not the previous PC + 1, bit 1: registers written, bit 2: memory written,
+ *                      | bit 3: PSR (other than CC) changed, bits 4-6: condition codes after the instruction
+ *      [varint]        | Zigzag PC offset from the previous PC + 1 (bit 0)
+ *      u16             | IR
+ *      [u8, varint...] | Mask of written registers, zigzag delta to the old value for every register in it (bit 1)
+ *      [varint, u16]   | Zigzag address offset from the previous written address, and the written value (bit 2)
+ *      [u16]           | New PSR (bit 3)
+ *
+ * Multi-byte values are little-endian, varints are LEB128
+ */
+
+#define LC3_TRACE_VERSION (1)
+
+enum LC3_TraceFlag {
+    LC3_TRACE_JUMP = 0x01,
+    LC3_TRACE_REGS = 0x02,
+    LC3_TRACE_MEM  = 0x04,
+    LC3_TRACE_PSR  = 0x08,
+};
+
+
+// Records traces, file writes are done on a separate thread
+typedef struct LC3_Tracer {
+    FILE *fp;                       // Output file
+    pthread_t thread;               // Writer thread
+    pthread_mutex_t lock;           // Protects the buffers while switching
+    pthread_cond_t cond;            // Signals full and written buffers
+    ByteArray buffers[2];           // Buffer being filled and buffer being written
+    int filling;                    // Index of the buffer being filled
+    bool writing;                   // Whether the other buffer is being written
+    bool quit;                      // Tells the writer thread to exit
+    bool failed;                    // Whether a write failed
+    uint16_t nextPC;                // Previous PC + 1
+    uint16_t lastAddr;              // Previous written address
+    uint16_t psr;                   // PSR after the previous instruction
+    int16_t reg[8];                 // Registers after the previous instruction
+} LC3_Tracer;
+
+
+// A decoded trace record
+typedef struct LC3_TraceRecord {
+    uint16_t PC;                    // Address of the instruction
+    uint16_t IR;                    // Instruction
+    uint8_t flags;                  // Combination of LC3_TraceFlags
+    uint8_t regMask;                // Written registers
+    int16_t reg[8];                 // Registers after the instruction
+    uint16_t addr;                  // Written address
+    uint16_t value;                 // Written value
+    uint16_t PSR;                   // PSR after the instruction
+} LC3_TraceRecord;
+
+
+// Sequential trace file reader
+typedef struct LC3_TraceReader {
+    const uint8_t *data;            // Mapped file
+    size_t size, pos;               // File size and read position
+    uint64_t counter;               // Instruction counter of the next record
+    LC3_TraceRecord state;          // Last decoded record
+} LC3_TraceReader;
+
+
+/*
+ * Start recording into filename, starting from the current state of sim
+ * Returns NULL if the file could not be opened or the writer thread could not be started
+ * Should be stopped with LC3_StopTrace
+ */
+LC3_Tracer *LC3_StartTrace(LC3_SimInstance *sim, const char *filename);
+
+/*
+ * Flush remaining records, close the file and deallocate the tracer
+ * Returns 0 if all records were written
+ */
+int LC3_StopTrace(LC3_Tracer *tracer);
+
+/*
+ * Record a retired instruction, called by the executor
+ * before holds the registers before the instruction, store the address written by it (or -1)
+ */
+void LC3_TraceInstruction(LC3_Tracer *tracer, const LC3_Registers *before, const LC3_SimInstance *sim, int32_t store);
+
+/*
+ * Open trace file for reading, returns 0 on success
+ * Should be closed with LC3_CloseTraceReader
+ */
+int LC3_OpenTraceReader(LC3_TraceReader *reader, const char *filename);
+
+/*
+ * Decode the next record into reader->state
+ * Returns 1 if a record was decoded, 0 at the end of the trace and -1 if the trace is corrupt
+ */
+int LC3_NextTraceRecord(LC3_TraceReader *reader);
+
+/*
+ * Close trace file
+ */
+void LC3_CloseTraceReader(LC3_TraceReader *reader);
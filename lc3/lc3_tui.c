@@ -1,11 +1,34 @@
 #include "lc3_tui.h"
 #include "lc3_cmd.h"
 #include "lib/cmdarg/cmdarg.h"
-#include <sys/time.h>
 #include "lib/leakcheck/lc.h"
-
-#define CMD_LEN_MAX (256)
-#define RUNSTEP_US  (100000)
+#include <inttypes.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+#define free_nn(x) if (x != NULL) { lc_free(x); }
+
+// Redraw interval while the simulator runs
+#define FRAME_MS    (33)
+
+// Size of the stdout buffer in headless mode
+#define HEADLESS_OUT_BUFFER (65536)
+
+// Descriptors polled by the main loop
+enum {
+    EVENT_INPUT,
+    EVENT_FRAME,
+    EVENT_RESIZE,
+    EVENT_WORKER,
+    EVENT_RELOAD,
+    EVENT_COUNT,
+};
 
 
 String copyString(String str) {
@@ -46,6 +69,12 @@ void stringDelete(String *str, int idx) {
 }
 
 
+// Snapshot list functions
+vaAllocFunction(LC3_NamedImages, LC3_NamedImage, newNamedImages, ;, ;)
+vaAppendFunction(LC3_NamedImages, LC3_NamedImage, addNamedImage, ;, ;)
+vaFreeFunction(LC3_NamedImages, LC3_NamedImage, freeNamedImages, lc_free(el.name.ptr); LC3_DestroyImage(*el.image); lc_free(el.image), ;, ;)
+
+
 LC3_TermInterface LC3_CreateTermInterface(LC3_SimInstance *sim, int argc, char **argv) {
     LC3_TermInterface ret = {
         .sim = sim,
@@ -59,10 +88,29 @@ LC3_TermInterface LC3_CreateTermInterface(LC3_SimInstance *sim, int argc, char *
         .inViewBox  = NULL,
         .outViewBox = NULL,
         .commands = newStringArray(),
-        .delay = 100,
         .numDisplay = LC3_NDISPLAY_HEX,
+        .render = {
+            .valid   = false,
+            .rows    = NULL,
+            .inputs  = newString(),
+            .output  = newString(),
+        },
+        .disasm = LC3_CreateDisasmCache(),
+        .search = NULL,
+        .assembly = NULL,
+        .checkpoint = NULL,
+        .image = NULL,
+        .reloader = NULL,
+        .snapshots = newNamedImages(),
+        .worker = NULL,
+        .view = NULL,
         .running = false,
         .headless = false,
+        .json = NULL,
+        .grade = NULL,
+        .fuzz = NULL,
+        .serve = NULL,
+        .jobs = 1,
     };
 
     // Handle flag(s)
@@ -72,9 +120,74 @@ LC3_TermInterface LC3_CreateTermInterface(LC3_SimInstance *sim, int argc, char *
 
     ca_config *config = ca_alloc_config();
     ca_bind_flag(config, "--headless", HEADLESS);
+    ca_set_hasv(config, "--grade");
+    ca_set_hasv(config, "--budget");
+    ca_set_hasv(config, "--jobs");
+    ca_set_hasv(config, "--fuzz");
+    ca_set_hasv(config, "--seeds");
+    ca_set_hasv(config, "--seconds");
+    ca_set_hasv(config, "--serve");
 
     ca_info *info = ca_parse(config, argc, argv);
     uint64_t flags = ca_flags(info);
+    const char *jobs = ca_flag_value(info, "--jobs");
+
+    ret.jobs = (jobs != NULL) ? atoi(jobs) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    ret.jobs = (ret.jobs > 0) ? ret.jobs : 1;
+
+    // Grading runs headless, on the executable given as the first literal
+    if (ca_is_set(info, "--grade")) {
+        size_t count = 0;
+        const char **literals = ca_literals(info, &count);
+        const char *budget = ca_flag_value(info, "--budget");
+
+        ret.grade = lc_malloc(sizeof(LC3_GradeConfig));
+        ret.grade->dir = copyCString(ca_flag_value(info, "--grade"));
+        ret.grade->executable = (count > 0) ? copyCString(literals[0]) : NULL;
+        ret.grade->budget = (budget != NULL) ? strtoll(budget, NULL, 0) : LC3_GRADE_BUDGET;
+        ret.grade->jobs = ret.jobs;
+        flags |= HEADLESS;
+    }
+
+    // Fuzzing as well, with the budget shared with grading
+    if (ca_is_set(info, "--fuzz")) {
+        size_t count = 0;
+        const char **literals = ca_literals(info, &count);
+        const char *budget = ca_flag_value(info, "--budget");
+        const char *seconds = ca_flag_value(info, "--seconds");
+        const char *seeds = ca_flag_value(info, "--seeds");
+
+        ret.fuzz = lc_malloc(sizeof(LC3_FuzzConfig));
+        ret.fuzz->dir = copyCString(ca_flag_value(info, "--fuzz"));
+        ret.fuzz->executable = (count > 0) ? copyCString(literals[0]) : NULL;
+        ret.fuzz->seeds = (seeds != NULL) ? copyCString(seeds) : NULL;
+        ret.fuzz->budget = (budget != NULL) ? strtoll(budget, NULL, 0) : LC3_FUZZ_BUDGET;
+        ret.fuzz->seconds = (seconds != NULL) ? strtoll(seconds, NULL, 0) : LC3_FUZZ_SECONDS;
+        ret.fuzz->jobs = ret.jobs;
+        flags |= HEADLESS;
+    }
+
+    // Serving runs headless as well
+    if (ca_is_set(info, "--serve")) {
+        const char *socket = ca_flag_value(info, "--serve");
+        ret.serve = copyCString((socket != NULL) ? socket : "");
+        flags |= HEADLESS;
+    }
+
+    // Flags without values still keep the part after =
+    const char *format = ca_flag_value(info, "--headless");
+
+    if (format != NULL && strcmp(format, "json") == 0 && !ret.grade && !ret.fuzz && !ret.serve) {
+        ret.json = lc_malloc(sizeof(LC3_JsonResponse));
+        ret.json->id = 0;
+        ret.json->messages = newStringArray();
+        ret.json->error = false;
+        ret.json->memCount = 0;
+        ret.json->outputBuf = NULL;
+        ret.json->outputSz = 0;
+        ret.json->outputSent = 0;
+        ret.json->output = open_memstream(&ret.json->outputBuf, &ret.json->outputSz);
+    }
 
     ca_free_config(config);
     ca_free_info(info);
@@ -86,7 +199,6 @@ LC3_TermInterface LC3_CreateTermInterface(LC3_SimInstance *sim, int argc, char *
     // ncurses setup
     initscr();
     keypad(stdscr, true);
-    halfdelay(ret.delay);
     noecho();
     use_default_colors();
     start_color();
@@ -119,6 +231,43 @@ static void destroyWindow(WINDOW *win) {
 
 void LC3_DestroyTermInterface(LC3_TermInterface tui) {
     freeStringArray(tui.commands);
+    free_nn(tui.render.rows);
+    lc_free(tui.render.inputs.ptr);
+    lc_free(tui.render.output.ptr);
+    lc_free(tui.disasm);
+    free_nn(tui.search);
+    LC3_DestroyAssembly(tui.assembly);
+    LC3_DestroyCheckpointer(tui.checkpoint);
+    LC3_DestroyReloader(tui.reloader);
+
+    if (tui.image) {
+        LC3_DestroyImage(*tui.image);
+        lc_free(tui.image);
+    }
+
+    freeNamedImages(tui.snapshots);
+
+    if (tui.grade) {
+        free_nn(tui.grade->dir);
+        free_nn(tui.grade->executable);
+        lc_free(tui.grade);
+    }
+
+    if (tui.fuzz) {
+        free_nn(tui.fuzz->dir);
+        free_nn(tui.fuzz->executable);
+        free_nn(tui.fuzz->seeds);
+        lc_free(tui.fuzz);
+    }
+
+    free_nn(tui.serve);
+
+    if (tui.json) {
+        fclose(tui.json->output);
+        free(tui.json->outputBuf);
+        freeStringArray(tui.json->messages);
+        lc_free(tui.json);
+    }
 
     if (tui.headless) {
         return;
@@ -217,6 +366,14 @@ static void resizeCheck(LC3_TermInterface *tui) {
         OUT_VIEW_W() + BOX_PAD,
         OUT_VIEW_H() + BOX_PAD
     );
+
+    // Output is appended to the window, scrolling it once full
+    scrollok(tui->outView, true);
+
+    // New windows are empty
+    tui->render.valid = false;
+    tui->render.rowCount = MEM_VIEW_H();
+    tui->render.rows = lc_realloc(tui->render.rows, tui->render.rowCount * sizeof(LC3_RowCache));
 }
 
 
@@ -289,12 +446,100 @@ int loopAround(int i, int mod) {
 }
 
 
+static void displaySimulator(LC3_TermInterface *tui);
+
+
+// Search memory on every keystroke, the memory view shows the first hit from where it was
+static void incrementalSearch(LC3_TermInterface *tui) {
+    String pattern = newString();
+    String cmd = newString();
+    int origin = tui->memViewStart;
+    int c, idx = 0;
+
+    cbreak();
+    curs_set(1);
+
+    while (true) {
+        mvaddch(tui->rows - 1, 0, '/');
+        clrtoeol();
+        addstr(pattern.ptr);
+
+        if (pattern.sz > 0 && tui->search != NULL) {
+            printw("   (%zu)", tui->search->hitCount);
+        }
+
+        move(tui->rows - 1, idx + 1);
+        c = getch();
+
+        if (c == '\n' || c == 27) {
+            break;
+        }
+
+        switch (c) {
+            case KEY_BACKSPACE: stringDelete(&pattern, idx - 1);
+                                idx = clamp(idx - 1, 0, pattern.sz);
+                                break;
+            case KEY_LEFT:      idx = clamp(idx - 1, 0, pattern.sz);
+                                continue;
+            case KEY_RIGHT:     idx = clamp(idx + 1, 0, pattern.sz);
+                                continue;
+            default:            stringInsert(&pattern, c, idx);
+                                idx++;
+                                break;
+        }
+
+        tui->memViewStart = origin;
+
+        if (pattern.sz > 0) {
+            clearString(&cmd);
+            for (const char *str = "find "; *str; addchar(&cmd, *str), str++);
+            for (size_t i = 0; i < pattern.sz; addchar(&cmd, pattern.ptr[i]), i++);
+            LC3_ExecuteCommand(tui, cmd.ptr);
+        } else if (tui->search != NULL) {
+            tui->search->hitCount = 0;
+        }
+
+        tui->view = (tui->worker) ? LC3_SampleView(tui->worker) : tui->view;
+        displaySimulator(tui);
+    }
+
+    // Cancelled searches go back to where they started
+    if (c == 27) {
+        tui->memViewStart = origin;
+    }
+
+    move(tui->rows - 1, 0);
+    clrtoeol();
+    curs_set(0);
+    lc_free(pattern.ptr);
+    lc_free(cmd.ptr);
+}
+
+
+// Move the memory view to the next or previous hit of the last search
+static void jumpToHit(LC3_TermInterface *tui, bool backwards) {
+    int32_t hit = (tui->search != NULL) ? LC3_NextHit(tui->search, tui->memViewStart, backwards) : -1;
+
+    if (hit < 0) {
+        LC3_ShowMessage(tui, "no search hits", true);
+        return;
+    }
+
+    tui->memViewStart = hit;
+}
+
+
 static void handleInput(LC3_TermInterface *tui) {
     int ch;
-    halfdelay(tui->delay);
     String cmd;
 
-    if ((ch = getch()) != ERR) {
+    // Only called when stdin is readable, take every key that arrived
+    timeout(0);
+
+    while (tui->running && (ch = getch()) != ERR) {
+        // Commands wait for their own input
+        timeout(-1);
+
         switch (ch) {
             case KEY_DOWN:  tui->memViewStart = loopAround(tui->memViewStart + 1, LC3_MEM_SIZE); 
                             break;
@@ -304,23 +549,40 @@ static void handleInput(LC3_TermInterface *tui) {
                             break;
             case ':':       cmd = getCommand(tui);
                             LC3_ExecuteCommand(tui, cmd.ptr);
-                            halfdelay(tui->delay);
                             break;
-            case '\n':      tui->sim->flags &= ~LC3_SIM_HALTED;
-                            LC3_ExecuteInstruction(tui->sim);
-                            tui->sim->flags |= LC3_SIM_HALTED;
-                            if (!LC3_IsAddrDisplayed(tui, tui->sim->reg.PC)) {
-                                tui->memViewStart = tui->sim->reg.PC;
-                            }
+            case '\n':      LC3_ExecuteCommand(tui, "step");
                             break;
             case 'u':       LC3_ExecuteCommand(tui, "u");
+                            break;
+            case '/':       incrementalSearch(tui);
+                            break;
+            case 'n':       jumpToHit(tui, false);
+                            break;
+            case 'N':       jumpToHit(tui, true);
+                            break;
         }
+
+        timeout(0);
     }
+
+    timeout(-1);
+}
+
+
+// Keep a line for the response to the current command in JSON mode
+static void addJsonMessage(LC3_TermInterface *tui, const char *msg) {
+    String line = newString();
+    for (; *msg; addchar(&line, *msg), msg++);
+    addString(&tui->json->messages, line);
 }
 
 
 void LC3_ShowMessage(LC3_TermInterface *tui, const char *msg, bool isError) {
-    if (tui->headless) {
+    if (tui->json) {
+        addJsonMessage(tui, msg);
+        tui->json->error |= isError;
+        return;
+    } else if (tui->headless) {
         printf("%s\n", msg);
         return;
     }
@@ -336,7 +598,7 @@ void LC3_ShowMessage(LC3_TermInterface *tui, const char *msg, bool isError) {
 }
 
 
-#define CC_CHAR(n, t, f) ((((sim->reg.PSR & 7) & n) != 0) ? t : f)
+#define CC_CHAR(n, t, f) ((((reg->PSR & 7) & n) != 0) ? t : f)
 #define FMT_STR_LEN (20)
 
 
@@ -355,86 +617,198 @@ static void printValue(LC3_TermInterface *tui, WINDOW *win, uint16_t value) {
 }
 
 
-static void displaySimulator(LC3_TermInterface *tui) {
+static void drawMemoryRow(LC3_TermInterface *tui, int y, const LC3_RowCache *row) {
     LC3_SimInstance *sim = tui->sim;
-    resizeCheck(tui);
+    int max = MEM_VIEW_W() - FMT_STR_LEN;
 
-    // Draw memory view
-    box(tui->memView, 0, 0);
+    if (row->breakpoint) {
+        wattron(tui->memView, COLOR_PAIR(1));
+    }
 
-    for (int i = tui->memViewStart, y = 1; y <= MEM_VIEW_H() ; i = loopAround(i + 1, LC3_MEM_SIZE), y++) {
-        int max = MEM_VIEW_W() - FMT_STR_LEN;
+    if (row->isPC) {
+        wattron(tui->memView, COLOR_PAIR(2));
+    }
 
-        if (sim->memory[i].breakpoint) {
-            wattron(tui->memView, COLOR_PAIR(1));
-        }
+    mvwprintw(tui->memView, y, 2, "%cx%04X | ", row->isPC ? '>' : ' ', row->addr);
+    printValue(tui, tui->memView, row->value);
+    wprintw(tui->memView, " | ");
+
+    for (int i = 0; i < max; waddch(tui->memView, ' '), i++);
+
+    // Debug strings and symbols are only changed while the worker is paused, so they can be read directly
+    // Without a debug string, the value is disassembled instead
+    const char *text = (row->hasDebug && row->debugIndex < sim->debug.sz)
+                     ? sim->debug.ptr[row->debugIndex].ptr
+                     : LC3_DisassembleCached(tui->disasm, sim, row->addr, row->value);
+
+    wmove(tui->memView, y, FMT_STR_LEN);
+
+    if (strlen(text) <= max) {
+        wprintw(tui->memView, "%s", text);
+    } else {
+        wprintw(tui->memView, "%.*s..", max - 2, text);
+    }
 
-        if (i == sim->reg.PC) {
-            wattron(tui->memView, COLOR_PAIR(2));
+    wattroff(tui->memView, COLOR_PAIR(1));
+    wattroff(tui->memView, COLOR_PAIR(2));
+}
+
+
+// Redraw rows whose address, cell, highlight or debug text changed
+static void drawMemoryView(LC3_TermInterface *tui, const LC3_SimView *view, bool all) {
+    LC3_RenderCache *render = &tui->render;
+
+    // Debug strings can be replaced in place without their index changing, and symbols change disassembly
+    bool debugChanged = render->debugEpoch != view->debugEpoch;
+
+    for (int i = tui->memViewStart, y = 0; y < render->rowCount; i = loopAround(i + 1, LC3_MEM_SIZE), y++) {
+        LC3_RowCache row = {
+            .addr       = i,
+            .value      = view->memory[i].value,
+            .debugIndex = view->memory[i].hasDebug ? view->memory[i].debugIndex : 0,
+            .hasDebug   = view->memory[i].hasDebug,
+            .breakpoint = view->memory[i].breakpoint,
+            .isPC       = (i == view->reg.PC),
+        };
+
+        LC3_RowCache *old = &render->rows[y];
+        bool changed = all || debugChanged || old->addr != row.addr || old->value != row.value;
+        changed = changed || old->hasDebug != row.hasDebug || old->debugIndex != row.debugIndex;
+        changed = changed || old->breakpoint != row.breakpoint || old->isPC != row.isPC;
+
+        if (changed) {
+            (*old) = row;
+            drawMemoryRow(tui, y + 1, old);
         }
+    }
 
-        mvwprintw(tui->memView, y, 2, "%cx%04X | ", (i == sim->reg.PC) ? '>' : ' ', (uint16_t)i);
-        printValue(tui, tui->memView, sim->memory[i].value);
-        wprintw(tui->memView, " | ");
+    render->debugEpoch = view->debugEpoch;
+}
 
-        for (int i = 0; i < max; waddch(tui->memView, ' '), i++);
 
-        if (sim->memory[i].hasDebug) {
-            wmove(tui->memView, y, FMT_STR_LEN);
-            String debug = sim->debug.ptr[sim->memory[i].debugIndex];
+// Redraw registers whose value changed
+static void drawRegisterView(LC3_TermInterface *tui, const LC3_SimView *view, bool all) {
+    const LC3_Registers *reg = &view->reg;
+    LC3_Registers *old = &tui->render.reg;
 
-            if (debug.sz <= max) {
-                wprintw(tui->memView, "%s", debug.ptr);
-            } else {
-                char tmp = debug.ptr[max - 2];
-                debug.ptr[max - 2] = '\0';
-                wprintw(tui->memView, "%s..", debug.ptr);
-                debug.ptr[max - 2] = tmp;
-            }
+    for (int i = 0; i < 8; i++) {
+        if (all || old->reg[i] != reg->reg[i]) {
+            mvwprintw(tui->regView, i + 1, 1, " R%1i | ", i);
+            printValue(tui, tui->regView, reg->reg[i]);
         }
+    }
 
-        wattroff(tui->memView, COLOR_PAIR(1));
-        wattroff(tui->memView, COLOR_PAIR(2));
+    if (all || old->PSR != reg->PSR) {
+        mvwprintw(tui->regView,  9, 1, "PSR | 0x%04X", reg->PSR);
+        mvwprintw(tui->regView, 10, 1, " CC | %c %c %c ", CC_CHAR(0x4, 'N', '.'), CC_CHAR(0x2, 'Z', '.'), CC_CHAR(0x1, 'P', '.'));
     }
 
-    // Draw register view
-    box(tui->regView, 0, 0);
+    if (all || old->PC != reg->PC) {
+        mvwprintw(tui->regView, 11, 1, " PC | 0x%04X", reg->PC);
+    }
 
-    for (int i = 0; i < 8; i++) {
-        mvwprintw(tui->regView, i + 1, 1, " R%1i | ", i);
-        printValue(tui, tui->regView, sim->reg.reg[i]);
+    if (all || old->MAR != reg->MAR) {
+        mvwprintw(tui->regView, 12, 1, "MAR | 0x%04X", reg->MAR);
     }
 
-    mvwprintw(tui->regView,  9, 1, "PSR | 0x%04X", sim->reg.PSR);
-    mvwprintw(tui->regView, 10, 1, " CC | %c %c %c ", CC_CHAR(0x4, 'N', '.'), CC_CHAR(0x2, 'Z', '.'), CC_CHAR(0x1, 'P', '.'));
+    if (all || old->MDR != reg->MDR) {
+        mvwprintw(tui->regView, 13, 1, "MDR | 0x%04X", (uint16_t)reg->MDR);
+    }
+
+    (*old) = (*reg);
+}
+
 
-    mvwprintw(tui->regView, 11, 1, " PC | 0x%04X", sim->reg.PC);
-    mvwprintw(tui->regView, 12, 1, "MAR | 0x%04X", sim->reg.MAR);
-    mvwprintw(tui->regView, 13, 1, "MDR | 0x%04X", (uint16_t)sim->reg.MDR);
+// Redraw the input queue if it changed
+static void drawInputView(LC3_TermInterface *tui, const LC3_SimView *view, bool all) {
+    String *old = &tui->render.inputs;
+    bool changed = all || old->sz != view->inputs.sz || memcmp(old->ptr, view->inputs.ptr, old->sz) != 0;
 
-    // Draw input view
+    if (!changed) {
+        return;
+    }
+
+    clearString(old);
     werase(tui->inView);
-    box(tui->inViewBox, 0, 0);
     wattron(tui->inView, COLOR_PAIR(4));
     wmove(tui->inView, 0, 0);
 
-    for (int i = 0; i < VQ_SZ(sim->inputs); i++) {
-        waddstr(tui->inView, charString(VQ_EL(sim->inputs, i)));
+    for (int i = 0; i < view->inputs.sz; i++) {
+        addchar(old, view->inputs.ptr[i]);
+        waddstr(tui->inView, charString(view->inputs.ptr[i]));
     }
 
     wattroff(tui->inView, COLOR_PAIR(4));
+}
+
+
+// Append new output to the output window, or redraw it if the output was cleared or cropped
+static void drawOutputView(LC3_TermInterface *tui, const LC3_SimView *view, bool all) {
+    LC3_RenderCache *render = &tui->render;
+    size_t capacity = OUT_VIEW_W() * OUT_VIEW_H() - 1, start;
+
+    // The view only holds the end of the output, starting at this offset
+    size_t base = view->outputSz - view->output.sz;
+    size_t drawnStart = render->outputSz - render->output.sz;
+
+    // The drawn tail is still in place if nothing was removed from the output
+    bool appended = !all && view->outputSz >= render->outputSz && drawnStart >= base;
+    appended = appended && memcmp(view->output.ptr + (drawnStart - base), render->output.ptr, render->output.sz) == 0;
+
+    if (appended) {
+        start = render->outputSz;
+    } else {
+        start = (view->outputSz > capacity) ? (view->outputSz - capacity) : 0;
+        start = (start < base) ? base : start;
+        werase(tui->outView);
+    }
+
+    if (appended && start == view->outputSz) {
+        return;
+    }
+
+    for (size_t i = start; i < view->outputSz; i++) {
+        waddch(tui->outView, view->output.ptr[i - base]);
+    }
+
+    // Remember what is visible
+    size_t tail = (view->output.sz > capacity) ? capacity : view->output.sz;
+    clearString(&render->output);
 
-    // Draw output view
-    box(tui->outViewBox, 0, 0);
-    int i = sim->output.sz - (OUT_VIEW_W() * OUT_VIEW_H());
-    wmove(tui->outView, 0, 0);
+    for (size_t i = view->output.sz - tail; i < view->output.sz; i++) {
+        addchar(&render->output, view->output.ptr[i]);
+    }
+
+    render->outputSz = view->outputSz;
+}
 
-    for (i = (i < 0) ? 0 : i; i < sim->output.sz; i++) {
-        waddch(tui->outView, sim->output.ptr[i]);
+
+static void displaySimulator(LC3_TermInterface *tui) {
+    const LC3_SimView *view = tui->view;
+
+    // Everything is drawn after the windows are created, or when the number format changes
+    bool all = !tui->render.valid;
+
+    if (all) {
+        box(tui->memView, 0, 0);
+        box(tui->regView, 0, 0);
+        box(tui->inViewBox, 0, 0);
+        box(tui->outViewBox, 0, 0);
+        wnoutrefresh(tui->inViewBox);
+        wnoutrefresh(tui->outViewBox);
     }
 
-    // State indicator
-    if (sim->flags & LC3_SIM_HALTED ) {
+    bool format = all || tui->render.numDisplay != tui->numDisplay;
+    tui->render.numDisplay = tui->numDisplay;
+    tui->render.valid = true;
+
+    drawMemoryView(tui, view, format);
+    drawRegisterView(tui, view, format);
+    drawInputView(tui, view, all);
+    drawOutputView(tui, view, all);
+
+    // State indicator, messages on the bottom row may have erased it
+    if (view->flags & LC3_SIM_HALTED ) {
         attron(COLOR_PAIR(1));
         mvaddch(tui->rows - 1, tui->cols - 1, 'H');
         attroff(COLOR_PAIR(1));
@@ -444,47 +818,336 @@ static void displaySimulator(LC3_TermInterface *tui) {
         attroff(COLOR_PAIR(3));
     }
 
-    refresh();
-    wrefresh(tui->memView);
-    wrefresh(tui->regView);
-    wrefresh(tui->inViewBox);
-    wrefresh(tui->inView);
-    wrefresh(tui->outViewBox);
-    wrefresh(tui->outView);
+    // Single update for all windows, only changed cells are sent to the terminal
+    wnoutrefresh(stdscr);
+    wnoutrefresh(tui->memView);
+    wnoutrefresh(tui->regView);
+    wnoutrefresh(tui->inView);
+    wnoutrefresh(tui->outView);
+    doupdate();
+}
+
+
+// Arm the frame timer, or disarm it when ms is 0
+static void setFrameTimer(int fd, int ms) {
+    struct itimerspec spec = {
+        .it_interval = {ms / 1000, (ms % 1000) * 1000000L},
+        .it_value    = {ms / 1000, (ms % 1000) * 1000000L},
+    };
+
+    timerfd_settime(fd, 0, &spec, NULL);
+}
+
+
+// Consume the pending value of an eventfd, timerfd or signalfd
+static void drainEvent(int fd, size_t size) {
+    char buf[sizeof(struct signalfd_siginfo)];
+
+    while (read(fd, buf, size) == (ssize_t)size);
 }
 
 
-// Main loop for TUI mode
-static void runTermInterfaceDefault(LC3_TermInterface *tui) {
+// Resize the screen to the terminal, and rebuild the windows
+static void handleResize(LC3_TermInterface *tui) {
+    struct winsize ws;
+
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0) {
+        resizeterm(ws.ws_row, ws.ws_col);
+    }
+
+    resizeCheck(tui);
+}
+
+
+// Main loop for TUI mode, returns 1 if the simulator thread could not be started
+static int runTermInterfaceDefault(LC3_TermInterface *tui) {
+    // SIGWINCH is read through a signalfd, threads started from here on inherit the mask
+    sigset_t winch, oldMask;
+    sigemptyset(&winch);
+    sigaddset(&winch, SIGWINCH);
+    pthread_sigmask(SIG_BLOCK, &winch, &oldMask);
+
+    struct pollfd events[EVENT_COUNT] = {
+        [EVENT_INPUT]  = {STDIN_FILENO, POLLIN, 0},
+        [EVENT_FRAME]  = {timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC), POLLIN, 0},
+        [EVENT_RESIZE] = {signalfd(-1, &winch, SFD_NONBLOCK | SFD_CLOEXEC), POLLIN, 0},
+        [EVENT_WORKER] = {eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC), POLLIN, 0},
+        [EVENT_RELOAD] = {-1, POLLIN, 0},
+    };
+
     tui->running = true;
+    tui->worker = LC3_StartWorker(tui->sim, events[EVENT_WORKER].fd);
+
+    if (tui->worker == NULL) {
+        for (int i = EVENT_FRAME; i <= EVENT_WORKER; close(events[i].fd), i++);
+        pthread_sigmask(SIG_SETMASK, &oldMask, NULL);
+        endwin();
+        fprintf(stderr, "failed to start simulator thread\n");
+        return 1;
+    }
+
+    tui->worker->checkpoint = tui->checkpoint;
+
+    uint16_t lastPC = tui->sim->reg.PC;
+    bool ticking = false;
+    resizeCheck(tui);
 
     while (tui->running) {
+        if (LC3_CheckpointResult(tui->checkpoint) != 0) {
+            LC3_ShowMessage(tui, "failed to write checkpoint", true);
+        }
+
+        // A worker that is not busy has published its final view already
+        bool busy = LC3_WorkerBusy(tui->worker);
+        tui->view = LC3_SampleView(tui->worker);
+
+        // Follow the PC while it moves
+        if (tui->view->reg.PC != lastPC && !LC3_IsAddrDisplayed(tui, tui->view->reg.PC)) {
+            tui->memViewStart = tui->view->reg.PC;
+        }
+
+        lastPC = tui->view->reg.PC;
         displaySimulator(tui);
-        handleInput(tui);
-
-        // Simulation
-        if (!(tui->sim->flags & LC3_SIM_HALTED)) {
-            tui->delay = 1;
-
-            struct timeval start, current;
-            gettimeofday(&start, NULL);
-
-            for (int elapsed = 0; !(tui->sim->flags & LC3_SIM_HALTED) && elapsed < RUNSTEP_US;) {
-                LC3_UntilBreakpoint(tui->sim, 64);
-                gettimeofday(&current, NULL);
-                elapsed = (((current.tv_sec - start.tv_sec) * 1000000) + current.tv_usec - start.tv_usec);
-            }
-
-            if (!LC3_IsAddrDisplayed(tui, tui->sim->reg.PC)) {
-                tui->memViewStart = tui->sim->reg.PC;
-            }
-        } else {
-            tui->delay = 250;
+
+        // Frames are only needed while the simulator runs, the worker wakes us once it goes idle
+        bool tick = busy || !(tui->view->flags & LC3_SIM_HALTED);
+
+        if (tick != ticking) {
+            setFrameTimer(events[EVENT_FRAME].fd, tick ? FRAME_MS : 0);
+            ticking = tick;
+        }
+
+        // The reloader only exists after the first read
+        events[EVENT_RELOAD].fd = (tui->reloader != NULL) ? tui->reloader->readyFd : -1;
+
+        if (poll(events, EVENT_COUNT, -1) < 0) {
+            continue;
+        }
+
+        if (events[EVENT_FRAME].revents & POLLIN) {
+            drainEvent(events[EVENT_FRAME].fd, sizeof(uint64_t));
+        }
+
+        if (events[EVENT_WORKER].revents & POLLIN) {
+            drainEvent(events[EVENT_WORKER].fd, sizeof(uint64_t));
+        }
+
+        if (events[EVENT_RESIZE].revents & POLLIN) {
+            drainEvent(events[EVENT_RESIZE].fd, sizeof(struct signalfd_siginfo));
+            handleResize(tui);
+        }
+
+        if (events[EVENT_RELOAD].revents & POLLIN) {
+            drainEvent(events[EVENT_RELOAD].fd, sizeof(uint64_t));
+            LC3_CheckReload(tui);
+        }
+
+        if (events[EVENT_INPUT].revents & (POLLIN | POLLHUP)) {
+            handleInput(tui);
+        }
+
+        // Stdin closed, nothing can stop the loop anymore
+        if (events[EVENT_INPUT].revents & (POLLHUP | POLLERR | POLLNVAL)) {
+            tui->running = false;
         }
     }
 
+    LC3_StopWorker(tui->worker);
+    tui->worker = NULL;
+    tui->view = NULL;
+
+    // The reload eventfd belongs to the reloader
+    for (int i = EVENT_FRAME; i <= EVENT_WORKER; i++) {
+        close(events[i].fd);
+    }
+
+    pthread_sigmask(SIG_SETMASK, &oldMask, NULL);
+
     clear();
     refresh();
+    return 0;
+}
+
+
+void LC3_ShowListing(LC3_TermInterface *tui, const StringArray *lines) {
+    if (tui->json) {
+        for (size_t i = 0; i < lines->sz; addJsonMessage(tui, lines->ptr[i].ptr), i++);
+        return;
+    } else if (tui->headless) {
+        for (size_t i = 0; i < lines->sz; i++) {
+            printf("%s\n", lines->ptr[i].ptr);
+        }
+
+        return;
+    }
+
+    int c = -1, y = 0;
+
+    while (c) {
+        clear();
+
+        for (int i = 0; i < tui->rows - 1 && y + i < (int)lines->sz; i++) {
+            mvprintw(i, 0, "%s", lines->ptr[y + i].ptr);
+        }
+
+        mvprintw(tui->rows - 1, 0, "j/k to scroll, any other key to return");
+        refresh();
+        c = getch();
+
+        switch (c) {
+            case 'k':
+            case KEY_UP:    y = (y > 0) ? y - 1 : 0;
+                            break;
+            case 'j':
+            case KEY_DOWN:  y = (y + 1 < (int)lines->sz) ? y + 1 : y;
+                            break;
+            case KEY_RESIZE: break;
+            default: c = 0; break;
+        }
+    }
+
+    clear();
+
+    // The windows were drawn over
+    tui->render.valid = false;
+}
+
+
+void LC3_CheckReload(LC3_TermInterface *tui) {
+    char msg[64];
+
+    if (tui->reloader == NULL || !LC3_ReloadPending(tui->reloader)) {
+        return;
+    }
+
+    if (tui->worker != NULL) {
+        LC3_PauseWorker(tui->worker);
+    }
+
+    int32_t n = LC3_ApplyReload(tui->reloader, tui->sim, (tui->image != NULL) ? &tui->image->state : NULL);
+
+    if (tui->worker != NULL) {
+        LC3_ResumeWorker(tui->worker);
+    }
+
+    if (n < 0) {
+        LC3_ShowMessage(tui, "failed to reload file", true);
+        LC3_ShowMessage(tui, tui->sim->error, true);
+        tui->sim->error = NULL;
+    } else {
+        snprintf(msg, sizeof(msg), "reloaded, %d word%s changed", n, (n == 1) ? "" : "s");
+        LC3_ShowMessage(tui, msg, false);
+    }
+}
+
+
+LC3_SimImage *LC3_FindSnapshot(LC3_TermInterface *tui, const char *name) {
+    for (size_t i = 0; i < tui->snapshots.sz; i++) {
+        if (strcmp(tui->snapshots.ptr[i].name.ptr, name) == 0) {
+            return tui->snapshots.ptr[i].image;
+        }
+    }
+
+    return NULL;
+}
+
+
+void LC3_TakeSnapshot(LC3_TermInterface *tui, const char *name) {
+    LC3_SimImage *image = LC3_FindSnapshot(tui, name);
+
+    if (image == NULL) {
+        LC3_NamedImage snap = {
+            .name  = newString(),
+            .image = lc_malloc(sizeof(LC3_SimImage)),
+        };
+
+        for (; *name; addchar(&snap.name, *name), name++);
+        (*snap.image) = LC3_CreateImage();
+        addNamedImage(&tui->snapshots, snap);
+        image = snap.image;
+    }
+
+    LC3_CaptureImage(image, tui->sim);
+}
+
+
+// Write memory as one run of 4-digit hex words
+static void writeHexWords(FILE *fp, const LC3_SimInstance *sim, uint32_t addr, uint32_t count) {
+    static const char digits[] = "0123456789abcdef";
+    char buf[256 * 4];
+
+    fputc('"', fp);
+
+    while (count > 0) {
+        uint32_t n = (count < 256) ? count : 256;
+
+        for (uint32_t i = 0; i < n; i++) {
+            uint16_t word = sim->memory[addr + i].value;
+            buf[i * 4 + 0] = digits[(word >> 12) & 0xF];
+            buf[i * 4 + 1] = digits[(word >> 8) & 0xF];
+            buf[i * 4 + 2] = digits[(word >> 4) & 0xF];
+            buf[i * 4 + 3] = digits[word & 0xF];
+        }
+
+        fwrite(buf, 4, n, fp);
+        addr += n;
+        count -= n;
+    }
+
+    fputc('"', fp);
+}
+
+
+// Answer the command that just ran with a JSON line, and start the next response
+static void writeJsonResponse(LC3_TermInterface *tui) {
+    LC3_JsonResponse *json = tui->json;
+    const LC3_SimInstance *sim = tui->sim;
+
+    printf("{\"id\":%" PRIu64 ",\"status\":\"%s\",\"counter\":%zu,\"halted\":%s,\"pc\":%u,\"r\":[",
+           json->id, json->error ? "error" : "ok", sim->counter, (sim->flags & LC3_SIM_HALTED) ? "true" : "false", sim->reg.PC);
+
+    for (int i = 0; i < 8; i++) {
+        printf((i > 0) ? ",%u" : "%u", (uint16_t)sim->reg.reg[i]);
+    }
+
+    printf("],\"psr\":%u,\"output\":", sim->reg.PSR);
+
+    // Only the output produced since the last response
+    fflush(json->output);
+    writeJsonString(stdout, json->outputBuf + json->outputSent, json->outputSz - json->outputSent);
+    json->outputSent = json->outputSz;
+
+    printf(",\"messages\":[");
+
+    for (size_t i = 0; i < json->messages.sz; i++) {
+        fputs((i > 0) ? "," : "", stdout);
+        writeJsonString(stdout, json->messages.ptr[i].ptr, json->messages.ptr[i].sz);
+    }
+
+    printf("]");
+
+    if (json->memCount > 0) {
+        printf(",\"memory\":{\"addr\":%u,\"hex\":", json->memAddr);
+        writeHexWords(stdout, sim, json->memAddr, json->memCount);
+        printf("}");
+    }
+
+    printf("}\n");
+
+    freeStringArray(json->messages);
+    json->messages = newStringArray();
+    json->error = false;
+    json->memCount = 0;
+
+    // The sent output is dropped once there is enough of it
+    if (json->outputSent > HEADLESS_OUT_BUFFER) {
+        fclose(json->output);
+        free(json->outputBuf);
+        json->outputBuf = NULL;
+        json->outputSz = json->outputSent = 0;
+        json->output = open_memstream(&json->outputBuf, &json->outputSz);
+        tui->sim->stream = json->output;
+    }
 }
 
 
@@ -492,30 +1155,92 @@ static void runTermInterfaceDefault(LC3_TermInterface *tui) {
 static void runTermInterfaceHeadless(LC3_TermInterface *tui) {
     tui->running = true;
 
-    char cmd[CMD_LEN_MAX + 1] = {0};
-    int ch = 0, i;
+    char *cmd = NULL;
+    size_t cap = 0;
+    ssize_t len = 0;
 
-    while (tui->running) {
-        // Read command input from stdin
-        for (i = 0; (ch = getchar()) != EOF && ch != '\n' && i < CMD_LEN_MAX; i++) {
-            cmd[i] = (char)ch;
-        }
+    // Program output is streamed to stdout as it is produced, between the command output
+    // A full pipe blocks the write, so a slow reader pauses the simulator instead of output piling up
+    // In JSON mode, it is sent in the response to the command that produced it instead
+    setvbuf(stdout, NULL, _IOFBF, HEADLESS_OUT_BUFFER);
+    tui->sim->stream = tui->json ? tui->json->output : stdout;
 
-        if (ch == EOF) {
-            break;
+    // Read command input from stdin, a line at a time into the same buffer
+    while (tui->running && (len = getline(&cmd, &cap, stdin)) >= 0) {
+        cmd[len - (len > 0 && cmd[len - 1] == '\n')] = '\0';
+
+        // Blank lines are no commands, so they get no response either
+        if (tui->json && cmd[strspn(cmd, " \t")] == '\0') {
+            continue;
         }
 
-        cmd[i] = '\0';
+        // Without a main loop to wake up, reloads are applied between commands
+        LC3_CheckReload(tui);
         LC3_ExecuteCommand(tui, cmd);
+
+        if (tui->json) {
+            tui->json->id++;
+            writeJsonResponse(tui);
+        }
+
+        // Whatever the command produced is passed on before waiting for the next one
+        fflush(stdout);
     }
+
+    // Allocated by getline
+    free(cmd);
+    tui->sim->stream = NULL;
+}
+
+
+// Grading mode, runs test cases instead of commands
+static int runTermInterfaceGrade(LC3_TermInterface *tui) {
+    if (tui->grade->executable == NULL || tui->grade->dir == NULL || tui->grade->budget <= 0) {
+        fprintf(stderr, "usage: lc3tui --grade DIR [--budget N] [--jobs N] FILE\n");
+        return 2;
+    }
+
+    // Setting up is told apart from failed cases, like invalid arguments
+    int failed = LC3_Grade(tui->grade, stdout);
+    return (failed < 0) ? 2 : (failed != 0) ? 1 : 0;
+}
+
+
+// Fuzzing mode, tries inputs instead of running commands
+static int runTermInterfaceFuzz(LC3_TermInterface *tui) {
+    if (tui->fuzz->executable == NULL || tui->fuzz->dir == NULL || tui->fuzz->budget <= 0 || tui->fuzz->seconds <= 0) {
+        fprintf(stderr, "usage: lc3tui --fuzz DIR [--seeds DIR] [--budget N] [--seconds N] [--jobs N] FILE\n");
+        return 2;
+    }
+
+    // Setting up is told apart from findings, like invalid arguments
+    int found = LC3_Fuzz(tui->fuzz, stdout);
+    return (found < 0) ? 2 : (found != 0) ? 1 : 0;
+}
+
+
+// Server mode, hosts sessions instead of running commands
+static int runTermInterfaceServe(LC3_TermInterface *tui) {
+    if (tui->serve[0] == '\0') {
+        fprintf(stderr, "usage: lc3tui --serve SOCKET [--jobs N]\n");
+        return 2;
+    }
+
+    return LC3_Serve(tui->serve, tui->jobs);
 }
 
 
 int LC3_RunTermInterface(LC3_TermInterface *tui) {
-    if (tui->headless) {
+    if (tui->grade) {
+        return runTermInterfaceGrade(tui);
+    } else if (tui->fuzz) {
+        return runTermInterfaceFuzz(tui);
+    } else if (tui->serve) {
+        return runTermInterfaceServe(tui);
+    } else if (tui->headless) {
         runTermInterfaceHeadless(tui);
     } else {
-        runTermInterfaceDefault(tui);
+        return runTermInterfaceDefault(tui);
     }
 
     return 0;
@@ -2,6 +2,15 @@
 #include <stdbool.h>
 #include <curses.h>
 #include "lc3_sim.h"
+#include "lc3_asm.h"
+#include "lc3_checkpoint.h"
+#include "lc3_disasm.h"
+#include "lc3_find.h"
+#include "lc3_grade.h"
+#include "lc3_fuzz.h"
+#include "lc3_reload.h"
+#include "lc3_serve.h"
+#include "lc3_worker.h"
 
 
 // Number formats for the TUI
@@ -14,6 +23,54 @@ typedef enum LC3_numDisplay {
 } LC3_numDisplay;
 
 
+// Last drawn contents of a memory view row
+typedef struct LC3_RowCache {
+    uint16_t addr;                  // Displayed address
+    int16_t value;                  // Displayed value
+    uint16_t debugIndex;            // Displayed debug string (if hasDebug)
+    bool hasDebug;                  // Whether debug text is displayed
+    bool breakpoint;                // Whether the breakpoint highlight is displayed
+    bool isPC;                      // Whether the PC highlight is displayed
+} LC3_RowCache;
+
+
+// What is currently on screen, so frames only redraw what changed
+typedef struct LC3_RenderCache {
+    bool valid;                     // Whether the windows were drawn since they were (re)created
+    LC3_RowCache *rows;             // Memory view rows
+    int rowCount;                   // Amount of memory view rows
+    uint32_t debugEpoch;            // Debug string epoch of the simulator when drawn
+    LC3_numDisplay numDisplay;      // Number format when drawn
+    LC3_Registers reg;              // Drawn registers
+    String inputs;                  // Drawn input queue
+    String output;                  // Drawn tail of the output
+    size_t outputSz;                // Output size when drawn
+} LC3_RenderCache;
+
+
+// In-memory snapshot taken with the snap command
+typedef struct LC3_NamedImage {
+    String name;                    // Name of the snapshot
+    LC3_SimImage *image;            // Captured simulator state
+} LC3_NamedImage;
+
+vaTypedef(LC3_NamedImage, LC3_NamedImages);
+
+
+// Response to the current command in JSON mode (--headless=json)
+typedef struct LC3_JsonResponse {
+    uint64_t id;                    // Number of the command, counting from 1
+    StringArray messages;           // Messages and listing lines shown by the command
+    bool error;                     // Whether any of them was an error
+    uint16_t memAddr;               // Start of the memory range requested by the command
+    uint32_t memCount;              // Size of that range, 0 if none was requested
+    FILE *output;                   // Program output, kept in memory until it is sent
+    char *outputBuf;                // Buffer of output
+    size_t outputSz;                // Size of outputBuf
+    size_t outputSent;              // Bytes of outputBuf sent in earlier responses
+} LC3_JsonResponse;
+
+
 // Terminal UI for a sim instance
 typedef struct LC3_TermInterface {
     LC3_SimInstance *sim;           // Simulator reference
@@ -26,10 +83,24 @@ typedef struct LC3_TermInterface {
     WINDOW *inViewBox;              // Input window border
     WINDOW *outViewBox;             // Output window border
     StringArray commands;           // Previously executed commands
-    int delay;                      // Character wait delay
     LC3_numDisplay numDisplay;      // Number display format
+    LC3_RenderCache render;         // Contents of the windows
+    LC3_DisasmCache *disasm;        // Disassembled memory, only used from the UI thread
+    LC3_Search *search;             // Hits of the last find, NULL until first used
+    LC3_Assembly *assembly;         // Source of the last asm, NULL until first used
+    LC3_Checkpointer *checkpoint;   // Background checkpoint writer, NULL until first used
+    LC3_SimImage *image;            // Simulator state right after the last read, NULL until first read
+    LC3_Reloader *reloader;         // Reloads files read with read when they change, NULL until first read
+    LC3_NamedImages snapshots;      // Named in-memory snapshots
+    LC3_SimWorker *worker;          // Runs the simulator while the TUI is shown, NULL in headless mode
+    const LC3_SimView *view;        // Displayed simulator state, taken from the worker every frame
     bool running;                   // TUI exits once this turns false
     bool headless;                  // Whether the TUI is running without graphics output
+    LC3_JsonResponse *json;         // Set by --headless=json, every command is answered with a JSON line
+    LC3_GradeConfig *grade;         // Set by --grade, runs test cases instead of commands
+    LC3_FuzzConfig *fuzz;           // Set by --fuzz, fuzzes the input instead of running commands
+    char *serve;                    // Set by --serve, socket to host sessions on instead of running commands
+    int jobs;                       // Threads used by --grade, --fuzz and --serve
 } LC3_TermInterface;
 
 
@@ -47,6 +118,7 @@ void LC3_DestroyTermInterface(LC3_TermInterface tui);
 
 /*
  * Run terminal UI until exited
+ * Returns the exit status of the program
  */
 int LC3_RunTermInterface(LC3_TermInterface *tui);
 
@@ -61,3 +133,25 @@ bool LC3_IsAddrDisplayed(LC3_TermInterface *tui, uint16_t addr);
  * If isError is true, the message will be printed in red
  */
 void LC3_ShowMessage(LC3_TermInterface *tui, const char *msg, bool isError);
+
+/*
+ * Show lines on a scrollable screen until a key other than j/k is pressed
+ * In headless mode, the lines are printed instead
+ */
+void LC3_ShowListing(LC3_TermInterface *tui, const StringArray *lines);
+
+/*
+ * Patch a pending reload of the files read with read into the simulator, pausing the worker if it runs
+ */
+void LC3_CheckReload(LC3_TermInterface *tui);
+
+/*
+ * Get the in-memory snapshot called name, or NULL if it does not exist
+ */
+LC3_SimImage *LC3_FindSnapshot(LC3_TermInterface *tui, const char *name);
+
+/*
+ * Capture the simulator into the snapshot called name, creating it if it does not exist
+ * Snapshots taken again only copy what changed since the last capture
+ */
+void LC3_TakeSnapshot(LC3_TermInterface *tui, const char *name);
@@ -1,4 +1,20 @@
 #include "lc3_util.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define HOST_BIG_ENDIAN (true)
+#else
+#define HOST_BIG_ENDIAN (false)
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 // String functions
 vaAllocFunction(String, char, newString, ;, va.ptr[0] = '\0')
@@ -18,6 +34,127 @@ vaAllocFunction(StringArray, String, newStringArray, ;, ;)
 vaAppendFunction(StringArray, String, addString, ;, ;)
 vaFreeFunction(StringArray, String, freeStringArray, lc_free(el.ptr), ;, ;)
 
+// Byte array functions
+vaAllocFunction(ByteArray, uint8_t, newByteArray, ;, ;)
+
+
+void addBytes(ByteArray *arr, const void *src, size_t n) {
+    if (arr->sz + n > arr->cap) {
+        for (; arr->sz + n > arr->cap; arr->cap *= 2);
+        arr->ptr = lc_realloc(arr->ptr, arr->cap);
+    }
+
+    memcpy(arr->ptr + arr->sz, src, n);
+    arr->sz += n;
+}
+
+
+void addU8(ByteArray *arr, uint8_t n) {
+    addBytes(arr, &n, 1);
+}
+
+
+void addU16(ByteArray *arr, uint16_t n) {
+    uint8_t buf[2] = {n & 0xFF, n >> 8};
+    addBytes(arr, buf, sizeof(buf));
+}
+
+
+void addU32(ByteArray *arr, uint32_t n) {
+    addU16(arr, n & 0xFFFF);
+    addU16(arr, n >> 16);
+}
+
+
+void addU64(ByteArray *arr, uint64_t n) {
+    addU32(arr, n & 0xFFFFFFFF);
+    addU32(arr, n >> 32);
+}
+
+
+uint16_t readU16(const uint8_t *ptr) {
+    return (uint16_t)(ptr[0] | (ptr[1] << 8));
+}
+
+
+uint32_t readU32(const uint8_t *ptr) {
+    return readU16(ptr) | ((uint32_t)readU16(ptr + 2) << 16);
+}
+
+
+uint64_t readU64(const uint8_t *ptr) {
+    return readU32(ptr) | ((uint64_t)readU32(ptr + 4) << 32);
+}
+
+
+void swapWords(uint16_t *dst, const void *src, size_t n) {
+    const uint8_t *bytes = src;
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    for (; i + 16 <= n; i += 16) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(bytes + 2 * i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_or_si256(_mm256_slli_epi16(v, 8), _mm256_srli_epi16(v, 8)));
+    }
+#elif defined(__SSE2__)
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(bytes + 2 * i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)));
+    }
+#endif
+
+    for (uint16_t word; i < n; i++) {
+        memcpy(&word, bytes + 2 * i, sizeof(word));
+        dst[i] = (uint16_t)((word << 8) | (word >> 8));
+    }
+}
+
+
+void convertWords(uint16_t *dst, const void *src, size_t n, bool bigEndian) {
+    if (bigEndian == HOST_BIG_ENDIAN) {
+        memmove(dst, src, n * sizeof(uint16_t));
+    } else {
+        swapWords(dst, src, n);
+    }
+}
+
+
+char *copyCString(const char *str) {
+    size_t len = strlen(str) + 1;
+    char *ret = lc_malloc(len);
+    memcpy(ret, str, len);
+    return ret;
+}
+
+
+// Map file contents into memory
+const uint8_t *mapFile(const char *filename, size_t *size) {
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    void *ret = NULL;
+    (*size) = 0;
+
+    if (fd < 0) {
+        return NULL;
+    }
+
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        ret = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ret = (ret == MAP_FAILED) ? NULL : ret;
+        (*size) = (ret != NULL) ? st.st_size : 0;
+    }
+
+    close(fd);
+    return ret;
+}
+
+
+void unmapFile(const uint8_t *ptr, size_t size) {
+    if (ptr != NULL) {
+        munmap((void *)ptr, size);
+    }
+}
+
 
 // Strings for escaped characters
 const char *charString(int ch) {
@@ -34,3 +171,29 @@ const char *charString(int ch) {
 
     return ((ch >= 0 && ch < 128) ? map[ch] : "\\?");
 }
+
+
+void writeJsonString(FILE *fp, const char *str, size_t n) {
+    fputc('"', fp);
+
+    for (size_t i = 0; i < n; i++) {
+        uint8_t c = (uint8_t)str[i];
+
+        switch (c) {
+            case '"':   fputs("\\\"", fp); break;
+            case '\\':  fputs("\\\\", fp); break;
+            case '\n':  fputs("\\n", fp); break;
+            case '\r':  fputs("\\r", fp); break;
+            case '\t':  fputs("\\t", fp); break;
+            default:    if (c < 0x20 || c > 0x7E) {
+                            fprintf(fp, "\\u%04x", c);
+                        } else {
+                            fputc(c, fp);
+                        }
+
+                        break;
+        }
+    }
+
+    fputc('"', fp);
+}
@@ -1,4 +1,7 @@
 #pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 #include "lib/leakcheck/lc.h"
 #define VA_MALLOC lc_malloc
 #define VA_REALLOC lc_realloc
@@ -9,16 +12,57 @@
 // Variable-length string(array) type
 vaTypedef(char, String);
 vaTypedef(String, StringArray);
+vaTypedef(uint8_t, ByteArray);
 
 // String functions
 vaAllocFunctionDefine(String, newString);
 vaAppendFunctionDefine(String, char, addchar);
+vaClearFunctionDefine(String, clearString);
 
 // String array functions
 vaAllocFunctionDefine(StringArray, newStringArray);
 vaAppendFunctionDefine(StringArray, String, addString);
 vaFreeFunctionDefine(StringArray, freeStringArray);
 
+// Byte array functions, multi-byte values are always stored little-endian
+vaAllocFunctionDefine(ByteArray, newByteArray);
+void addBytes(ByteArray *arr, const void *src, size_t n);
+void addU8(ByteArray *arr, uint8_t n);
+void addU16(ByteArray *arr, uint16_t n);
+void addU32(ByteArray *arr, uint32_t n);
+void addU64(ByteArray *arr, uint64_t n);
+uint16_t readU16(const uint8_t *ptr);
+uint32_t readU32(const uint8_t *ptr);
+uint64_t readU64(const uint8_t *ptr);
+
+/*
+ * Copy n 16-bit words from src to dst, swapping the bytes of each word
+ * src does not need to be aligned, and may be the same as dst
+ */
+void swapWords(uint16_t *dst, const void *src, size_t n);
+
+/*
+ * Copy n 16-bit words from src to dst, converting them between host byte order and big- or little-endian
+ */
+void convertWords(uint16_t *dst, const void *src, size_t n, bool bigEndian);
+
+/*
+ * Returns an lc_malloc'd copy of str
+ */
+char *copyCString(const char *str);
+
+/*
+ * Map a file into memory (read-only), size is put into the size argument
+ * Returns NULL if the file could not be opened or is empty
+ * Should be released using unmapFile
+ */
+const uint8_t *mapFile(const char *filename, size_t *size);
+
+/*
+ * Release a file mapped by mapFile
+ */
+void unmapFile(const uint8_t *ptr, size_t size);
+
 /*
  * Returns a string representing the inputted character
  * For normal characters, this is just the character
@@ -26,3 +70,9 @@ vaFreeFunctionDefine(StringArray, freeStringArray);
  * Otherwise, the string "\\?" is returned
  */
 const char *charString(int ch);
+
+/*
+ * Write n bytes of str to fp as a quoted JSON string
+ * Control characters and bytes above 127 are escaped, so any bytes give valid JSON (read as Latin-1)
+ */
+void writeJsonString(FILE *fp, const char *str, size_t n);
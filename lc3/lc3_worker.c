@@ -0,0 +1,274 @@
+#include "lc3_worker.h"
+#include <unistd.h>
+
+// Instructions executed between checks for messages, pauses and view requests
+#define WORKER_CHUNK (1 << 16)
+
+// Set in LC3_SimWorker.middle when the exchanged view was not read yet
+#define LC3_VIEW_FRESH (0x4)
+
+#define LOAD(ptr)        __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define STORE(ptr, val)  __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#define EXCHANGE(ptr, v) __atomic_exchange_n((ptr), (v), __ATOMIC_ACQ_REL)
+
+
+static void copyBytes(String *dst, const char *src, size_t n) {
+    if (dst->cap < n + 1) {
+        dst->cap = n + 1;
+        dst->ptr = lc_realloc(dst->ptr, dst->cap);
+    }
+
+    memcpy(dst->ptr, src, n);
+    dst->ptr[n] = '\0';
+    dst->sz = n;
+}
+
+
+// Copy the simulator into the back view and exchange it, the caller must own the simulator
+static void publishView(LC3_SimWorker *w) {
+    LC3_SimInstance *sim = w->sim;
+    LC3_SimView *view = &w->views[w->back];
+
+    for (int page = 0; page < LC3_PAGE_COUNT; page++) {
+        if (view->mark == 0 || LC3_IsDirty(sim, page, view->mark)) {
+            memcpy(view->memory + page * LC3_PAGE_SIZE, sim->memory + page * LC3_PAGE_SIZE, LC3_PAGE_SIZE * sizeof(LC3_MemoryCell));
+        }
+    }
+
+    view->mark       = LC3_NewEpoch(sim);
+    view->reg        = sim->reg;
+    view->flags      = sim->flags;
+    view->counter    = sim->counter;
+    view->debugEpoch = sim->debugEpoch;
+
+    clearString(&view->inputs);
+
+    for (size_t i = 0; i < VQ_SZ(sim->inputs); i++) {
+        addchar(&view->inputs, VQ_EL(sim->inputs, i));
+    }
+
+    size_t tail = (sim->output.sz > LC3_VIEW_OUTPUT) ? LC3_VIEW_OUTPUT : sim->output.sz;
+    copyBytes(&view->output, sim->output.ptr + sim->output.sz - tail, tail);
+    view->outputSz = sim->output.sz;
+
+    w->back = EXCHANGE(&w->middle, (uint32_t)w->back | LC3_VIEW_FRESH) & ~LC3_VIEW_FRESH;
+}
+
+
+// Wake whoever waits on the notification eventfd
+static void notifyIdle(LC3_SimWorker *w) {
+    uint64_t one = 1;
+
+    if (w->notifyFd >= 0 && write(w->notifyFd, &one, sizeof(one)) != sizeof(one)) {
+        // The counter is saturated, which wakes the reader just as well
+    }
+}
+
+
+// Apply queued messages
+static void applyMessages(LC3_SimWorker *w) {
+    LC3_SimInstance *sim = w->sim;
+    uint32_t head = LOAD(&w->head);
+
+    for (; w->tail != head; STORE(&w->tail, w->tail + 1)) {
+        LC3_WorkerMsg msg = w->queue[w->tail % LC3_WORKER_QUEUE];
+        uint16_t addr = (msg.arg < 0) ? sim->reg.PC : (uint16_t)msg.arg;
+
+        switch (msg.op) {
+            case LC3_WORKER_HALT:       sim->flags |= LC3_SIM_HALTED;
+                                        break;
+            case LC3_WORKER_STEP:       sim->flags &= ~LC3_SIM_HALTED;
+                                        w->stepsLeft = msg.arg;
+                                        break;
+            case LC3_WORKER_BREAKPOINT: LC3_SetBreakpoint(sim, addr, !sim->memory[addr].breakpoint);
+                                        LC3_MarkDirty(sim, addr);
+                                        break;
+        }
+    }
+}
+
+
+// Execute the next chunk of instructions
+static void runChunk(LC3_SimWorker *w) {
+    LC3_SimInstance *sim = w->sim;
+    size_t before = sim->counter;
+
+    if (w->stepsLeft == 0) {
+        sim->flags |= LC3_SIM_HALTED;
+        return;
+    }
+
+    LC3_UntilBreakpoint(sim, (w->stepsLeft > 0 && w->stepsLeft < WORKER_CHUNK) ? w->stepsLeft : WORKER_CHUNK);
+    LC3_CheckpointTick(w->checkpoint, sim);
+
+    if (w->stepsLeft > 0) {
+        w->stepsLeft -= sim->counter - before;
+        w->stepsLeft = (w->stepsLeft < 0) ? 0 : w->stepsLeft;
+    }
+}
+
+
+static void *workerThread(void *arg) {
+    LC3_SimWorker *w = arg;
+    pthread_mutex_lock(&w->lock);
+
+    while (!w->quit) {
+        applyMessages(w);
+
+        if (w->pauseRequests > 0) {
+            w->paused = true;
+            pthread_cond_broadcast(&w->cond);
+
+            while (w->pauseRequests > 0 && !w->quit) {
+                pthread_cond_wait(&w->cond, &w->lock);
+            }
+
+            w->paused = false;
+            continue;
+        }
+
+        if (w->sim->flags & LC3_SIM_HALTED) {
+            w->stepsLeft = -1;
+
+            // Sleep until there is something to do, messages posted before the wait set busy again
+            if (LOAD(&w->head) == w->tail) {
+                publishView(w);
+                w->busy = false;
+                notifyIdle(w);
+                pthread_cond_wait(&w->cond, &w->lock);
+            }
+
+            continue;
+        }
+
+        pthread_mutex_unlock(&w->lock);
+        runChunk(w);
+
+        if (EXCHANGE(&w->wantView, false)) {
+            publishView(w);
+        }
+
+        pthread_mutex_lock(&w->lock);
+    }
+
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+
+// Deallocate w, its thread should not be running
+static void freeWorker(LC3_SimWorker *w) {
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->cond);
+
+    for (int i = 0; i < 3; i++) {
+        lc_free(w->views[i].memory);
+        lc_free(w->views[i].inputs.ptr);
+        lc_free(w->views[i].output.ptr);
+    }
+
+    lc_free(w);
+}
+
+
+LC3_SimWorker *LC3_StartWorker(LC3_SimInstance *sim, int notifyFd) {
+    LC3_SimWorker *w = lc_calloc(1, sizeof(LC3_SimWorker));
+    w->sim = sim;
+    w->notifyFd = notifyFd;
+    w->busy = true;
+    w->stepsLeft = -1;
+
+    for (int i = 0; i < 3; i++) {
+        w->views[i].memory = lc_malloc(LC3_MEM_SIZE * sizeof(LC3_MemoryCell));
+        w->views[i].inputs = newString();
+        w->views[i].output = newString();
+    }
+
+    w->back   = 0;
+    w->middle = 1;
+    w->front  = 2;
+    publishView(w);
+
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->cond, NULL);
+
+    if (pthread_create(&w->thread, NULL, workerThread, w) != 0) {
+        freeWorker(w);
+        return NULL;
+    }
+
+    return w;
+}
+
+
+void LC3_StopWorker(LC3_SimWorker *w) {
+    pthread_mutex_lock(&w->lock);
+    w->quit = true;
+    pthread_cond_broadcast(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+    pthread_join(w->thread, NULL);
+    freeWorker(w);
+}
+
+
+bool LC3_PostWorker(LC3_SimWorker *w, LC3_WorkerOp op, int64_t arg) {
+    uint32_t head = w->head;
+
+    if (head - LOAD(&w->tail) >= LC3_WORKER_QUEUE) {
+        return false;
+    }
+
+    w->queue[head % LC3_WORKER_QUEUE] = (LC3_WorkerMsg){op, arg};
+    STORE(&w->head, head + 1);
+
+    // Wake the worker in case it is sleeping
+    pthread_mutex_lock(&w->lock);
+    w->busy = true;
+    pthread_cond_broadcast(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+    return true;
+}
+
+
+void LC3_PauseWorker(LC3_SimWorker *w) {
+    pthread_mutex_lock(&w->lock);
+    w->pauseRequests++;
+    pthread_cond_broadcast(&w->cond);
+
+    while (!w->paused) {
+        pthread_cond_wait(&w->cond, &w->lock);
+    }
+
+    pthread_mutex_unlock(&w->lock);
+}
+
+
+void LC3_ResumeWorker(LC3_SimWorker *w) {
+    // The worker is not touching the views while paused
+    publishView(w);
+
+    pthread_mutex_lock(&w->lock);
+    w->pauseRequests--;
+    w->busy = true;
+    pthread_cond_broadcast(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+}
+
+
+const LC3_SimView *LC3_SampleView(LC3_SimWorker *w) {
+    STORE(&w->wantView, true);
+
+    if (LOAD(&w->middle) & LC3_VIEW_FRESH) {
+        w->front = EXCHANGE(&w->middle, (uint32_t)w->front) & ~LC3_VIEW_FRESH;
+    }
+
+    return &w->views[w->front];
+}
+
+
+bool LC3_WorkerBusy(LC3_SimWorker *w) {
+    pthread_mutex_lock(&w->lock);
+    bool ret = w->busy;
+    pthread_mutex_unlock(&w->lock);
+    return ret;
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <pthread.h>
+#include "lc3_sim.h"
+#include "lc3_checkpoint.h"
+
+// Size of the message queue, must be a power of 2
+#define LC3_WORKER_QUEUE (256)
+
+// Amount of output bytes copied into a view
+#define LC3_VIEW_OUTPUT (16384)
+
+
+// Operations that can be sent to a running worker
+typedef enum LC3_WorkerOp {
+    LC3_WORKER_HALT,                // Halt execution
+    LC3_WORKER_STEP,                // Execute arg instructions, stopping at breakpoints
+    LC3_WORKER_BREAKPOINT,          // Toggle the breakpoint at address arg, or at the PC if arg is negative
+} LC3_WorkerOp;
+
+
+typedef struct LC3_WorkerMsg {
+    LC3_WorkerOp op;
+    int64_t arg;
+} LC3_WorkerMsg;
+
+
+// Copy of the simulator state for display
+typedef struct LC3_SimView {
+    LC3_Registers reg;              // Registers
+    uint32_t flags;                 // Simulator flags
+    size_t counter;                 // Instruction counter
+    LC3_MemoryCell *memory;         // Copy of the memory
+    uint32_t mark;                  // Epoch mark of the simulator when memory was last copied, 0 if never
+    uint32_t debugEpoch;            // Debug string epoch of the simulator
+    String inputs;                  // Queued input
+    String output;                  // Last LC3_VIEW_OUTPUT bytes of the output
+    size_t outputSz;                // Size of the whole output
+} LC3_SimView;
+
+
+/*
+ * Runs the simulator on its own thread
+ *
+ * The simulator belongs to the worker thread while the worker is not paused.
+ * Other threads send it messages through a single-producer queue, and read its state through views,
+ * which are exchanged between three buffers so that neither side ever waits for the other.
+ * Anything else requires pausing the worker first.
+ */
+typedef struct LC3_SimWorker {
+    LC3_SimInstance *sim;           // Simulator
+    LC3_Checkpointer *checkpoint;   // Automatic checkpoints are ticked between chunks, only change while paused
+    pthread_t thread;               // Worker thread
+    pthread_mutex_t lock;           // Protects the fields below, only used for sleeping and pausing
+    pthread_cond_t cond;            // Signals new messages, pauses and quitting
+    int pauseRequests;              // Amount of threads waiting for or holding a pause
+    bool paused;                    // Whether the worker is paused
+    bool busy;                      // Whether the worker has work left, cleared when it goes to sleep
+    bool quit;                      // Tells the worker thread to exit
+    int notifyFd;                   // Eventfd written when the worker goes idle, -1 if unused
+    LC3_WorkerMsg queue[LC3_WORKER_QUEUE];
+    uint32_t head;                  // Next queue slot to write, only written by the sending thread
+    uint32_t tail;                  // Next queue slot to read, only written by the worker
+    int64_t stepsLeft;              // Instructions left in the current step, negative when running freely
+    bool wantView;                  // Set by the reader when it wants a new view while running
+    LC3_SimView views[3];           // Written view, exchanged view and read view
+    uint32_t middle;                // Index of the exchanged view, LC3_VIEW_FRESH is set if it is unread
+    int back;                       // Index of the view being written
+    int front;                      // Index of the view being read
+} LC3_SimWorker;
+
+
+/*
+ * Start running sim on a worker thread, and publish the first view
+ * notifyFd is an eventfd that is written every time the worker goes idle, or -1
+ * From now on, sim should only be accessed through the worker
+ * Returns NULL if the thread could not be started
+ * Should be stopped using LC3_StopWorker
+ */
+LC3_SimWorker *LC3_StartWorker(LC3_SimInstance *sim, int notifyFd);
+
+/*
+ * Stop the worker thread and deallocate the worker, the simulator is left as is
+ */
+void LC3_StopWorker(LC3_SimWorker *worker);
+
+/*
+ * Send an operation to the worker, it is applied before the next chunk of instructions
+ * Should only be called from a single thread, returns false if the queue is full
+ */
+bool LC3_PostWorker(LC3_SimWorker *worker, LC3_WorkerOp op, int64_t arg);
+
+/*
+ * Wait until the worker is at an instruction boundary and stop it there
+ * While paused, the simulator may be accessed directly
+ */
+void LC3_PauseWorker(LC3_SimWorker *worker);
+
+/*
+ * Publish a view of the (possibly changed) simulator and let the worker continue
+ */
+void LC3_ResumeWorker(LC3_SimWorker *worker);
+
+/*
+ * Get the most recent view, it stays valid until the next call
+ * Should only be called from a single thread
+ */
+const LC3_SimView *LC3_SampleView(LC3_SimWorker *worker);
+
+/*
+ * Check whether the worker is running or still processing messages
+ */
+bool LC3_WorkerBusy(LC3_SimWorker *worker);
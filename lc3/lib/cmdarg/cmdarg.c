@@ -206,7 +206,7 @@ ca_info *ca_parse(ca_config *cfg, int argc, char **argv) {
         // Potentially get value
         if (val_str == NULL && cfg->entries.ptr[idx].un.st.expects_value) {
             i++;
-            tmp.un.val = strdup((i == argc) ? NULL : argv[i]);
+            tmp.un.val = (i == argc) ? NULL : strdup(argv[i]);
         }
 
         _ca_fe_arr_add(&ret->flags, tmp);
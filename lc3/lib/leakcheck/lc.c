@@ -1,4 +1,5 @@
 #include "lc.h"
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -19,12 +20,17 @@ static lc_block_ptr head = NULL;
 static size_t allocs = 0, frees = 0;
 static size_t current = 0, max = 0, total = 0;
 
+// Protects the block list and counters, simulator, writer and server threads allocate at the same time
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
 
 void lc_summary(void) {
+    pthread_mutex_lock(&lock);
     printf("Leak summary: (%ld allocs, %ld frees, %ld bytes max, %ld bytes total)\n", allocs, frees, max, total);
 
     if (!head) {
         printf("\tNo leaks detected.\n");
+        pthread_mutex_unlock(&lock);
         return;
     }
 
@@ -32,6 +38,8 @@ void lc_summary(void) {
         printf("\t%ld bytes at (%p), allocated at %s:%ld\n", head->size, (void *)(head + 1), head->file, head->line);
         head = head->prev;
     }
+
+    pthread_mutex_unlock(&lock);
 }
 
 
@@ -45,6 +53,8 @@ void *_lc_alloc_internal(size_t size, int reset, const char *file, size_t line)
     bl->size = size;
     bl->file = file;
     bl->line = line;
+
+    pthread_mutex_lock(&lock);
     bl->prev = head;
     bl->next = NULL;
 
@@ -58,6 +68,7 @@ void *_lc_alloc_internal(size_t size, int reset, const char *file, size_t line)
     total += size;
     current += size;
     max = (current > max) ? current : max;
+    pthread_mutex_unlock(&lock);
 
     return (bl + 1);
 }
@@ -66,6 +77,7 @@ void *_lc_alloc_internal(size_t size, int reset, const char *file, size_t line)
 
 void _lc_free_internal(void *ptr, const char *file, size_t line) {
     lc_block_ptr bl = ((lc_block_ptr)ptr) - 1;
+    pthread_mutex_lock(&lock);
 
     if (bl->next) {
         bl->next->prev = bl->prev;
@@ -80,6 +92,7 @@ void _lc_free_internal(void *ptr, const char *file, size_t line) {
 
     frees++;
     current -= bl->size;
+    pthread_mutex_unlock(&lock);
 
     free(bl);
 }
@@ -87,6 +100,11 @@ void _lc_free_internal(void *ptr, const char *file, size_t line) {
 
 
 void *_lc_realloc_internal(void *ptr, size_t size, const char *file, size_t line) {
+    // Like realloc, NULL is a new allocation
+    if (ptr == NULL) {
+        return _lc_alloc_internal(size, 0, file, line);
+    }
+
     lc_block_ptr bl = ((lc_block_ptr)ptr) - 1;
 
     if (bl->size >= size) {
@@ -0,0 +1,147 @@
+#include <stdlib.h>
+#include "lc3/config.h"
+#include "lc3/lc3_trace.h"
+#include "lc3/lib/cmdarg/cmdarg.h"
+
+#define SUMMARY  (0x1)
+#define HOT_PCS  (10)
+
+static const char *OPCODES[16] = {
+    "BR", "ADD", "LD", "ST", "JSR", "AND", "LDR", "STR", "RTI", "NOT", "LDI", "STI", "JMP", "RES", "LEA", "TRAP",
+};
+
+
+// Parse address as x3000, 0x3000 or decimal, returns -1 if invalid
+static int32_t parseAddress(const char *str) {
+    char *end;
+    long ret = (str[0] == 'x' || str[0] == 'X') ? strtol(str + 1, &end, 16) : strtol(str, &end, 0);
+    return (end == str || *end != '\0' || ret < 0 || ret > 0xFFFF) ? -1 : ret;
+}
+
+
+static void printRecord(const LC3_TraceReader *r) {
+    const LC3_TraceRecord *s = &r->state;
+    printf("%10zu  x%04X  x%04X  %-4s %c%c%c", (size_t)r->counter - 1, s->PC, s->IR, OPCODES[s->IR >> 12],
+        (s->PSR & 4) ? 'N' : '-', (s->PSR & 2) ? 'Z' : '-', (s->PSR & 1) ? 'P' : '-');
+
+    for (int i = 0; i < 8; i++) {
+        if (s->regMask & (1 << i)) {
+            printf("  R%d=x%04X", i, (uint16_t)s->reg[i]);
+        }
+    }
+
+    if (s->flags & LC3_TRACE_MEM) {
+        printf("  [x%04X]=x%04X", s->addr, s->value);
+    }
+
+    if (s->flags & LC3_TRACE_PSR) {
+        printf("  PSR=x%04X", s->PSR);
+    }
+
+    putchar('\n');
+}
+
+
+// qsort has no context argument
+static const uint64_t *sortCounts;
+
+// Sort addresses by descending execution count
+static int compareHot(const void *a, const void *b) {
+    uint64_t ca = sortCounts[*(const uint16_t *)a], cb = sortCounts[*(const uint16_t *)b];
+    return (ca < cb) - (ca > cb);
+}
+
+
+static void printSummary(uint64_t total, const uint64_t *opcodes, uint64_t jumps, uint64_t writes, uint64_t *pcCounts) {
+    printf("instructions  %lu\njumps         %lu\nmemory writes %lu\n\n", (unsigned long)total, (unsigned long)jumps, (unsigned long)writes);
+
+    for (int i = 0; i < 16; i++) {
+        if (opcodes[i]) {
+            printf("%-4s %12lu  %5.1f%%\n", OPCODES[i], (unsigned long)opcodes[i], 100.0 * opcodes[i] / total);
+        }
+    }
+
+    uint16_t *order = lc_malloc(LC3_MEM_SIZE * sizeof(uint16_t));
+
+    for (int i = 0; i < LC3_MEM_SIZE; order[i] = i, i++);
+
+    sortCounts = pcCounts;
+    qsort(order, LC3_MEM_SIZE, sizeof(uint16_t), compareHot);
+    printf("\nhottest addresses\n");
+
+    for (int i = 0; i < HOT_PCS && pcCounts[order[i]]; i++) {
+        printf("x%04X %12lu  %5.1f%%\n", order[i], (unsigned long)pcCounts[order[i]], 100.0 * pcCounts[order[i]] / total);
+    }
+
+    lc_free(order);
+}
+
+
+int main(int argc, char **argv) {
+    ca_config *config = ca_alloc_config();
+    ca_bind_flag(config, "--summary", SUMMARY);
+    ca_set_hasv(config, "--from");
+    ca_set_hasv(config, "--to");
+
+    ca_info *info = ca_parse(config, argc - 1, argv + 1);
+    size_t count;
+    const char **files = ca_literals(info, &count);
+    int32_t from = ca_is_set(info, "--from") ? parseAddress(ca_flag_value(info, "--from")) : 0;
+    int32_t to   = ca_is_set(info, "--to")   ? parseAddress(ca_flag_value(info, "--to"))   : 0xFFFF;
+    bool summary = ca_flags(info) & SUMMARY;
+    int ret = 0;
+
+    LC3_TraceReader reader;
+
+    if (count != 1 || from < 0 || to < 0) {
+        fprintf(stderr, "usage: %s [--from ADDR] [--to ADDR] [--summary] FILE\n", argv[0]);
+        ret = 2;
+    } else if (LC3_OpenTraceReader(&reader, files[0]) != 0) {
+        fprintf(stderr, "%s: not a trace file\n", files[0]);
+        ret = 1;
+    } else {
+        uint64_t *pcCounts = summary ? lc_calloc(LC3_MEM_SIZE, sizeof(uint64_t)) : NULL;
+        uint64_t opcodes[16] = {0}, total = 0, jumps = 0, writes = 0;
+        int status;
+
+        while ((status = LC3_NextTraceRecord(&reader)) > 0) {
+            const LC3_TraceRecord *s = &reader.state;
+
+            if (s->PC < from || s->PC > to) {
+                continue;
+            }
+
+            if (!summary) {
+                printRecord(&reader);
+                continue;
+            }
+
+            total++;
+            opcodes[s->IR >> 12]++;
+            pcCounts[s->PC]++;
+            jumps  += (s->flags & LC3_TRACE_JUMP) != 0;
+            writes += (s->flags & LC3_TRACE_MEM) != 0;
+        }
+
+        if (status < 0) {
+            fprintf(stderr, "%s: trace is truncated\n", files[0]);
+            ret = 1;
+        }
+
+        if (summary) {
+            printSummary(total, opcodes, jumps, writes, pcCounts);
+            lc_free(pcCounts);
+        }
+
+        LC3_CloseTraceReader(&reader);
+    }
+
+    ca_free_config(config);
+    ca_free_info(info);
+
+    #if DO_LEAK_CHECK
+    lc_summary();
+    #endif
+
+    return ret;
+}
@@ -1,19 +1,28 @@
 #include "lc3/config.h"
+#include "lc3/lc3_run.h"
 #include "lc3/lc3_tui.h"
 
 
 int main(int argc, char **argv) {
     LC3_SimInstance sim = LC3_CreateSimInstance();
-    LC3_TermInterface tui = LC3_CreateTermInterface(&sim, argc - 1, argv + 1);
+    LC3_RunConfig *run = LC3_ParseRunConfig(argc - 1, argv + 1);
+    int ret = 0;
 
-    LC3_RunTermInterface(&tui);
+    // One-shot runs skip the TUI entirely
+    if (run != NULL) {
+        ret = LC3_RunOnce(run, &sim);
+        LC3_DestroyRunConfig(run);
+    } else {
+        LC3_TermInterface tui = LC3_CreateTermInterface(&sim, argc - 1, argv + 1);
+        ret = LC3_RunTermInterface(&tui);
+        LC3_DestroyTermInterface(tui);
+    }
 
-    LC3_DestroyTermInterface(tui);
     LC3_DestroySimInstance(sim);
 
     #if DO_LEAK_CHECK
     lc_summary();
     #endif
 
-    return 0;
+    return ret;
 }